@@ -0,0 +1,127 @@
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <algorithm>
+
+#include "BarcodeIndex.h"
+
+
+// Decimal digits of the largest barcode number. Product codes are stored as signed 64 bit integers.
+static const int maxDigits = 19;
+
+
+/**
+ * @brief In-memory index to complete partially typed barcode numbers.
+ * @details The index is the sorted array of the barcodes of all products, 8 bytes per product. The
+ *   barcodes starting with given digits form one contiguous range per barcode length (see
+ *   prefixRanges()), so completing takes one binary search per length, then the results are read
+ *   in sequence. That is a few microseconds even with tens of millions of products.
+ */
+BarcodeIndex::BarcodeIndex() { }
+
+
+/**
+ * @brief Build the index from the products in the given database.
+ * @param database  An open database connection, to be used from the calling thread.
+ * @return true if the index could be built, false otherwise. The index is left empty on failure.
+ */
+bool BarcodeIndex::build(QSqlDatabase database) {
+    QElapsedTimer timer;
+    timer.start();
+
+    m_codes.clear();
+
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    if (query.exec("SELECT COUNT(*) FROM products") && query.next())
+        m_codes.reserve(query.value(0).toInt());
+
+    // Reading in the order of the code index mostly saves sorting, and reads the index only.
+    if (!query.exec("SELECT code FROM products ORDER BY code")) {
+        qWarning() << "BarcodeIndex::build: ERROR: " << query.lastError().text();
+        m_codes.clear();
+        return false;
+    }
+    while (query.next()) {
+        qint64 code = query.value(0).toLongLong();
+        if (code > 0)
+            m_codes << quint64(code);
+    }
+
+    // Codes stored as text would not be in numeric order. Duplicates would be listed twice as completions.
+    if (!std::is_sorted(m_codes.constBegin(), m_codes.constEnd()))
+        std::sort(m_codes.begin(), m_codes.end());
+    m_codes.erase(std::unique(m_codes.begin(), m_codes.end()), m_codes.end());
+    m_codes.squeeze();
+
+    qDebug() << "BarcodeIndex::build: Indexed" << m_codes.size() << "barcodes in" << timer.elapsed() << "ms.";
+    return true;
+}
+
+
+/**
+ * @brief Find the barcodes starting with the given digits.
+ * @param digits  The start of a barcode number, as typed.
+ * @param limit  Maximum number of results.
+ * @return The barcodes, shortest first, and each length in ascending order.
+ */
+QVector<quint64> BarcodeIndex::complete(QString digits, int limit) const {
+    QVector<quint64> results;
+    for (const QPair<quint64, quint64>& range : prefixRanges(digits)) {
+        auto code = std::lower_bound(m_codes.constBegin(), m_codes.constEnd(), range.first);
+        for (; code != m_codes.constEnd() && *code < range.second; ++code) {
+            if (results.size() >= limit)
+                return results;
+            results << *code;
+        }
+    }
+    return results;
+}
+
+
+/** @brief Determine if the index is unusable, because it has not been built successfully. */
+bool BarcodeIndex::isEmpty() const {
+    return m_codes.isEmpty();
+}
+
+
+/** @brief Number of barcodes in the index. */
+int BarcodeIndex::size() const {
+    return m_codes.size();
+}
+
+
+/** @brief Approximate heap memory used by the index, in bytes. */
+qint64 BarcodeIndex::memoryUsage() const {
+    return qint64(m_codes.capacity()) * sizeof(quint64);
+}
+
+
+/**
+ * @brief The ranges of barcode numbers whose decimal representation starts with the given digits.
+ * @details There is one range per number length, from the length of the digits to the maximum
+ *   length. For example, "40" gives [40, 41), [400, 410), [4000, 4100) and so on. Leading zeros are
+ *   ignored, as barcodes are stored as numbers.
+ * @param digits  The start of a barcode number. Anything but digits results in no ranges.
+ * @return The ranges as pairs of the first number and the number after the last, shortest first.
+ */
+QVector<QPair<quint64, quint64>> BarcodeIndex::prefixRanges(QString digits) {
+    QVector<QPair<quint64, quint64>> ranges;
+
+    while (digits.startsWith('0'))
+        digits.remove(0, 1);
+    bool isNumber;
+    quint64 prefix = digits.toULongLong(&isNumber);
+    if (digits.isEmpty() || !isNumber || digits.size() > maxDigits)
+        return ranges;
+
+    quint64 scale = 1;
+    for (int length = digits.size(); length <= maxDigits; length++) {
+        ranges << qMakePair(prefix * scale, (prefix + 1) * scale);
+        scale *= 10;
+    }
+    return ranges;
+}
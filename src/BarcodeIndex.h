@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+#include <QPair>
+
+class BarcodeIndex {
+
+public:
+    BarcodeIndex();
+
+    bool build(QSqlDatabase database);
+
+    QVector<quint64> complete(QString digits, int limit) const;
+
+    bool isEmpty() const;
+
+    int size() const;
+
+    qint64 memoryUsage() const;
+
+    static QVector<QPair<quint64, quint64>> prefixRanges(QString digits);
+
+private:
+    QVector<quint64> m_codes; // Sorted barcodes of all products.
+};
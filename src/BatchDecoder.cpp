@@ -0,0 +1,329 @@
+#include <QObject>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include "BatchDecoder.h"
+#include "ContentDatabase.h"
+#include "MemoryBudget.h"
+#include "ZXingQtReader.h"
+
+
+/**
+ * @brief Decoding job for a single image file, executed on a worker thread of the global QThreadPool.
+ */
+class BatchDecodeTask : public QRunnable {
+
+    BatchDecoder* m_decoder;
+    QString m_fileName;
+    ZXing::DecodeHints m_hints;
+    int m_cost;
+
+public:
+    BatchDecodeTask(BatchDecoder* decoder, QString fileName, const ZXing::DecodeHints& hints, int cost)
+        : m_decoder(decoder), m_fileName(fileName), m_hints(hints), m_cost(cost) { }
+
+    void run() override {
+        BatchDecodeResult result;
+        result.fileName = m_fileName;
+
+        // Scoped so that the decoded image is freed before its share of the memory budget is returned.
+        {
+            QImage image(m_fileName);
+            if (image.isNull())
+                qWarning() << "BatchDecoder: WARNING: Could not load image" << m_fileName;
+            else {
+                QElapsedTimer timer;
+                timer.start();
+                ZXingQt::Result barcode = ZXingQt::ReadBarcode(image, m_hints);
+                result.decodeTime = timer.elapsed();
+
+                result.isValid = barcode.isValid();
+                if (barcode.isValid()) {
+                    const ZXingQt::Position& pos = barcode.position();
+                    result.text = barcode.text();
+                    result.formatName = barcode.formatName();
+                    result.position = QString("%1,%2 %3,%4 %5,%6 %7,%8")
+                        .arg(pos.topLeft().x()).arg(pos.topLeft().y())
+                        .arg(pos.topRight().x()).arg(pos.topRight().y())
+                        .arg(pos.bottomRight().x()).arg(pos.bottomRight().y())
+                        .arg(pos.bottomLeft().x()).arg(pos.bottomLeft().y());
+                }
+            }
+        }
+
+        m_decoder->releaseImageMemory(m_cost);
+        m_decoder->enqueueResult(result);
+    }
+};
+
+
+/**
+ * @brief Decoder that reads barcodes from all image files in a directory, such as shelf or
+ *   receipt photos collected by volunteers, and writes one result line per image.
+ * @details Images are decoded in parallel, one job per image, on Qt's global thread pool. Idle
+ *   worker threads take the next job from the pool's shared queue, so slow images do not hold
+ *   up the others. To keep the memory use bounded independent of the directory size, each image
+ *   holds a share of the application's MemoryBudget (estimated from its dimensions) while it is
+ *   loaded and decoded, and no further images are loaded while the budget is exhausted. The images
+ *   are reported to the MemoryBudget, so caches such as the content database's indexes give way to
+ *   them when they need the budget.
+ */
+BatchDecoder::BatchDecoder(QObject* parent) : QObject(parent), m_format(CSV), m_database(nullptr),
+    m_budgetKiB(0), m_imageKiB(0) {
+
+    // Images being decoded cannot be evicted. Registered with the highest rebuild cost, so that
+    //   everything else is evicted first.
+    m_budgetId = MemoryBudget::instance()->registerCache("BatchDecoder", "images", 10, [](qint64) {
+        return qint64(0);
+    });
+
+    // Same barcode types as the camera scanner (see ScannerPage.qml), plus UPC for US products.
+    m_hints.setFormats(
+        ZXing::BarcodeFormat::EAN13 | ZXing::BarcodeFormat::EAN8 |
+        ZXing::BarcodeFormat::UPCA | ZXing::BarcodeFormat::UPCE
+    );
+    m_hints.setTryRotate(true);
+    m_hints.setTryHarder(true);
+}
+
+
+/** @brief Set the ZXing decoder configuration to use for all images. */
+void BatchDecoder::setHints(const ZXing::DecodeHints& hints) {
+    m_hints = hints;
+}
+
+
+BatchDecoder::~BatchDecoder() {
+    MemoryBudget::instance()->unregisterCache(m_budgetId);
+}
+
+
+/**
+ * @brief Resolve every decoded barcode to its product categories while writing the output.
+ * @param database  A connected content database. Set to nullptr to not resolve barcodes.
+ * @param language  The language for the category names, given as a two-letter language code.
+ */
+void BatchDecoder::setResolver(ContentDatabase* database, QString language) {
+    m_database = database;
+    m_language = language;
+}
+
+
+/**
+ * @brief Decode all images in the given directory and its subdirectories.
+ * @param directory  The directory to search for image files.
+ * @param outputFile  The file to write the results to, or "-" for standard output.
+ * @param format  The output file format.
+ * @return true if all images were processed and the output was written, false otherwise.
+ */
+bool BatchDecoder::run(QString directory, QString outputFile, OutputFormat format) {
+    m_format = format;
+
+    if (!QFileInfo(directory).isDir()) {
+        qWarning() << "BatchDecoder::run: ERROR: Not a directory:" << directory;
+        return false;
+    }
+
+    QFile file;
+    bool isOpen;
+    if (outputFile == "-")
+        isOpen = file.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    else {
+        file.setFileName(outputFile);
+        isOpen = file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate);
+    }
+    if (!isOpen) {
+        qWarning() << "BatchDecoder::run: ERROR: Could not open output file" << outputFile;
+        return false;
+    }
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+
+    // Collect the image file names supported by the installed Qt image format plugins.
+    QStringList nameFilters;
+    for (QByteArray imageFormat : QImageReader::supportedImageFormats())
+        nameFilters << "*." + QString::fromLatin1(imageFormat);
+
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+
+    // Images may take up the whole memory budget. A single image larger than that is still
+    //   decoded, but alone.
+    m_budgetKiB = int(qMax(qint64(1), MemoryBudget::instance()->limit() / 1024));
+    m_budget.release(m_budgetKiB);
+
+    writeHeader(out);
+    bool first = true;
+    int submitted = 0;
+    int written = 0;
+
+    QDirIterator files(directory, nameFilters, QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+    while (files.hasNext()) {
+        QString fileName = files.next();
+
+        // Estimate the decoded memory size from the image header, without loading the image.
+        QSize size = QImageReader(fileName).size();
+        qint64 estimatedKiB = size.isValid() ? qint64(size.width()) * size.height() * 4 / 1024 : 0;
+        int cost = int(qBound(qint64(1), estimatedKiB, qint64(m_budgetKiB)));
+
+        // Wait for budget to become available, writing out finished results meanwhile. Events are
+        //   processed, as the MemoryBudget evicts other caches in queued calls on this thread.
+        QCoreApplication::processEvents();
+        while (!m_budget.tryAcquire(cost, 20)) {
+            QCoreApplication::processEvents();
+            written += drainResults(out, first);
+        }
+        reserveImageMemory(cost);
+
+        QThreadPool::globalInstance()->start(new BatchDecodeTask(this, fileName, m_hints, cost));
+        submitted++;
+        written += drainResults(out, first);
+    }
+
+    // Wait for the remaining jobs, writing out their results as they arrive.
+    while (written < submitted) {
+        QThread::msleep(20);
+        written += drainResults(out, first);
+    }
+
+    // All jobs returned their budget share before reporting their result. So the full budget can be
+    // taken back now, leaving the semaphore ready for another run().
+    m_budget.acquire(m_budgetKiB);
+
+    writeFooter(out);
+    out.flush();
+
+    qDebug().noquote()
+        << QString("BatchDecoder::run: Decoded %1 images in %2 ms using %3 threads.")
+           .arg(submitted).arg(totalTimer.elapsed()).arg(QThreadPool::globalInstance()->maxThreadCount());
+
+    // Such as when the disk is full or the reading end of a pipe was closed.
+    if (!file.flush() || out.status() != QTextStream::Ok || file.error() != QFileDevice::NoError) {
+        qWarning() << "BatchDecoder::run: ERROR: Could not write output file" << outputFile << ":" << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Account for the memory of an image about to be loaded, in the MemoryBudget.
+ * @details The share of m_budget must have been acquired before.
+ */
+void BatchDecoder::reserveImageMemory(int kib) {
+    QMutexLocker locker(&m_imageMemoryMutex);
+    m_imageKiB += kib;
+    MemoryBudget::instance()->report(m_budgetId, m_imageKiB * 1024);
+}
+
+
+/**
+ * @brief Return the memory of an image that is decoded and freed to the budget. Thread-safe.
+ */
+void BatchDecoder::releaseImageMemory(int kib) {
+    QMutexLocker locker(&m_imageMemoryMutex);
+    m_imageKiB -= kib;
+    MemoryBudget::instance()->report(m_budgetId, m_imageKiB * 1024);
+    m_budget.release(kib);
+}
+
+
+/**
+ * @brief Accept a finished decoding result for writing out. Thread-safe.
+ */
+void BatchDecoder::enqueueResult(const BatchDecodeResult& result) {
+    QMutexLocker locker(&m_resultsMutex);
+    m_results.enqueue(result);
+}
+
+
+/**
+ * @brief Write all finished decoding results collected so far to the output.
+ * @return The number of results written.
+ */
+int BatchDecoder::drainResults(QTextStream& out, bool& first) {
+    QQueue<BatchDecodeResult> results;
+    {
+        QMutexLocker locker(&m_resultsMutex);
+        results.swap(m_results);
+    }
+
+    for (const BatchDecodeResult& result : results) {
+        writeResult(out, result, first);
+        first = false;
+    }
+
+    return results.size();
+}
+
+
+void BatchDecoder::writeHeader(QTextStream& out) {
+    if (m_format == JSON)
+        out << "[\n";
+    else {
+        out << "file,barcode,format,position,decode_ms";
+        if (m_database)
+            out << ",categories";
+        out << "\n";
+    }
+}
+
+
+/**
+ * @brief Write one output record, resolving the barcode through the content database if configured.
+ * @details Resolution happens here on the calling thread, as it uses the calling thread's database
+ *   connection. It overlaps with the decoding of further images on the worker threads.
+ */
+void BatchDecoder::writeResult(QTextStream& out, const BatchDecodeResult& result, bool first) {
+    QStringList categories;
+    if (m_database && result.isValid)
+        categories = m_database->productCategories(result.text, m_language);
+
+    if (m_format == JSON) {
+        QJsonObject record;
+        record["file"] = result.fileName;
+        record["barcode"] = result.isValid ? QJsonValue(result.text) : QJsonValue();
+        record["format"] = result.isValid ? QJsonValue(result.formatName) : QJsonValue();
+        record["position"] = result.isValid ? QJsonValue(result.position) : QJsonValue();
+        record["decode_ms"] = result.decodeTime;
+        if (m_database)
+            record["categories"] = QJsonArray::fromStringList(categories);
+
+        if (!first)
+            out << ",\n";
+        out << "  " << QString::fromUtf8(QJsonDocument(record).toJson(QJsonDocument::Compact));
+    }
+    else {
+        // Quote every text field as per RFC 4180, doubling any contained quotes.
+        auto quoted = [](QString field) { return "\"" + field.replace("\"", "\"\"") + "\""; };
+
+        out << quoted(result.fileName) << ","
+            << quoted(result.text) << ","
+            << quoted(result.formatName) << ","
+            << quoted(result.position) << ","
+            << result.decodeTime;
+        if (m_database)
+            out << "," << quoted(categories.join("; "));
+        out << "\n";
+    }
+}
+
+
+void BatchDecoder::writeFooter(QTextStream& out) {
+    if (m_format == JSON)
+        out << "\n]\n";
+}
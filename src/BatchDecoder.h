@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+#include <QQueue>
+#include <QSemaphore>
+#include <QTextStream>
+
+#include <ZXing/DecodeHints.h>
+
+class ContentDatabase;
+
+/**
+ * @brief One line of batch decoding output, describing the barcode found in one image file.
+ */
+struct BatchDecodeResult {
+    QString fileName;
+    bool isValid = false;
+    QString text;
+    QString formatName;
+    QString position;
+    qint64 decodeTime = 0; // Milliseconds.
+};
+
+class BatchDecoder : public QObject {
+
+    Q_OBJECT
+
+public:
+    enum OutputFormat {CSV, JSON};
+
+    explicit BatchDecoder(QObject* parent = 0);
+
+    ~BatchDecoder();
+
+    void setHints(const ZXing::DecodeHints& hints);
+
+    void setResolver(ContentDatabase* database, QString language);
+
+    bool run(QString directory, QString outputFile, OutputFormat format);
+
+    // Called from decoding worker threads. Thread-safe.
+    void enqueueResult(const BatchDecodeResult& result);
+    void releaseImageMemory(int kib);
+
+private:
+    void writeHeader(QTextStream& out);
+    void writeResult(QTextStream& out, const BatchDecodeResult& result, bool first);
+    void writeFooter(QTextStream& out);
+    int drainResults(QTextStream& out, bool& first);
+
+    void reserveImageMemory(int kib);
+
+    ZXing::DecodeHints m_hints;
+    OutputFormat m_format;
+    ContentDatabase* m_database;
+    QString m_language;
+
+    // Memory of the images being loaded and decoded, as a share of the MemoryBudget limit.
+    QSemaphore m_budget;
+    int m_budgetKiB;
+    int m_budgetId;
+    QMutex m_imageMemoryMutex;
+    qint64 m_imageKiB;
+    QMutex m_resultsMutex;
+    QQueue<BatchDecodeResult> m_results;
+};
@@ -0,0 +1,140 @@
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+#include "CategoryBrowserModel.h"
+
+
+// Number of categories fetched at a time. About two screens full on a mobile device.
+static const int pageSize = 50;
+
+
+/**
+ * @brief List model of the child categories of one category, for browsing the category hierarchy.
+ * @details Categories are fetched page by page in the background, each page when a view scrolls
+ *   to the end of the rows fetched so far (see fetchMore()). So showing a category with thousands
+ *   of children reads only the first page, and the user interface never waits for the database.
+ *   The pages come from ContentDatabase::categoryChildren(), which finds a page by the last
+ *   category of the previous one, so fetching later pages does not get slower.
+ *
+ *   A new browse() supersedes all background work of the previous one, whose results are discarded.
+ */
+CategoryBrowserModel::CategoryBrowserModel(ContentDatabase* database, QObject* parent) : QAbstractListModel(parent),
+    m_database(database), m_parentId(-1), m_complete(true), m_generation(0), m_loading(false) { }
+
+
+int CategoryBrowserModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+
+QVariant CategoryBrowserModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= m_rows.size())
+        return QVariant();
+
+    const CategoryEntry& row = m_rows.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:
+        return row.name;
+    case IdRole:
+        return row.id;
+    case ChildCountRole:
+        return row.childCount;
+    case TopicCountRole:
+        return row.topicCount;
+    default:
+        return QVariant();
+    }
+}
+
+
+QHash<int, QByteArray> CategoryBrowserModel::roleNames() const {
+    QHash<int, QByteArray> roles = QAbstractListModel::roleNames();
+    roles[IdRole] = "categoryId";
+    roles[NameRole] = "name";
+    roles[ChildCountRole] = "childCount";
+    roles[TopicCountRole] = "topicCount";
+    return roles;
+}
+
+
+/** @brief If there are more categories to fetch. False while a page is being fetched. */
+bool CategoryBrowserModel::canFetchMore(const QModelIndex& parent) const {
+    return !parent.isValid() && !m_complete && !m_loading;
+}
+
+
+/**
+ * @brief Start fetching the next page of categories in the background. They are appended as rows
+ *   when available.
+ */
+void CategoryBrowserModel::fetchMore(const QModelIndex& parent) {
+    if (!canFetchMore(parent))
+        return;
+
+    int generation = m_generation;
+    m_loading = true;
+    loadingChanged();
+
+    QFutureWatcher<QVector<CategoryEntry>>* watcher = new QFutureWatcher<QVector<CategoryEntry>>(this);
+
+    QObject::connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation]() {
+        watcher->deleteLater();
+        if (generation != m_generation)
+            return;
+
+        QVector<CategoryEntry> categories = watcher->result();
+        m_complete = categories.size() < pageSize;
+
+        if (!categories.isEmpty()) {
+            beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size() + categories.size() - 1);
+            m_rows << categories;
+            endInsertRows();
+            countChanged();
+        }
+
+        m_loading = false;
+        loadingChanged();
+    });
+
+    ContentDatabase* database = m_database;
+    qint64 parentId = m_parentId;
+    QString language = m_language;
+    CategoryEntry after = m_rows.isEmpty() ? CategoryEntry() : m_rows.last();
+    watcher->setFuture(QtConcurrent::run([database, parentId, language, after]() {
+        return database->categoryChildren(parentId, language, after, pageSize);
+    }));
+}
+
+
+/** @brief Number of categories fetched so far. */
+int CategoryBrowserModel::count() const {
+    return m_rows.size();
+}
+
+
+/** @brief If a page of categories is being fetched. */
+bool CategoryBrowserModel::loading() const {
+    return m_loading;
+}
+
+
+/**
+ * @brief Show the child categories of a category, starting with fetching their first page.
+ * @param parentId  The category to show the children of, or -1 to show the categories without a parent.
+ * @param language  The language of the category names, given as a two-letter language code.
+ */
+void CategoryBrowserModel::browse(qint64 parentId, QString language) {
+    m_generation++;
+
+    beginResetModel();
+    m_rows.clear();
+    m_parentId = parentId;
+    m_language = language;
+    m_complete = false;
+    m_loading = false;
+    endResetModel();
+    countChanged();
+
+    fetchMore(QModelIndex());
+}
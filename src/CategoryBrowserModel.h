@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QVector>
+
+#include "ContentDatabase.h"
+
+class CategoryBrowserModel : public QAbstractListModel {
+
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
+
+public:
+    enum Roles {
+        IdRole = Qt::UserRole + 1,
+        NameRole,
+        ChildCountRole,
+        TopicCountRole
+    };
+
+    explicit CategoryBrowserModel(ContentDatabase* database, QObject* parent = 0);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    QHash<int, QByteArray> roleNames() const override;
+
+    bool canFetchMore(const QModelIndex& parent) const override;
+
+    void fetchMore(const QModelIndex& parent) override;
+
+    int count() const;
+
+    bool loading() const;
+
+    Q_INVOKABLE // Allows to invoke this method from QML.
+    void browse(qint64 parentId, QString language);
+
+signals:
+    void countChanged();
+    void loadingChanged();
+
+private:
+    ContentDatabase* m_database;
+    qint64 m_parentId;
+    QString m_language;
+    QVector<CategoryEntry> m_rows;
+    bool m_complete; // If all children of the category have been fetched.
+    int m_generation;
+    bool m_loading;
+};
@@ -0,0 +1,247 @@
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <vector>
+
+#include "CategoryNameIndex.h"
+
+
+/**
+ * @brief In-memory index to resolve exact, case-insensitive category names to category IDs.
+ * @details The index is a minimal perfect hash over the case-folded (language, name) pairs of table
+ *   category_names, built with the "hash and displace" technique: keys are distributed to small
+ *   buckets, and for every bucket a "pilot" value is searched that moves all its keys into
+ *   slots not yet taken. A lookup then needs two hash computations and a single string comparison,
+ *   independent of the number of names. In contrast, "name = :name COLLATE NOCASE" in SQL cannot
+ *   use a plain index and scans the whole table.
+ *
+ *   Case folding is done with QString::toCaseFolded(), so it also works for non-ASCII letters, unlike
+ *   SQLite's NOCASE collation.
+ */
+CategoryNameIndex::CategoryNameIndex() : m_seed(0) { }
+
+
+/**
+ * @brief Build the index from the category names of one language in the given database.
+ * @details Only one language is indexed, so that memory usage does not grow with the number of
+ *   languages in the database. Names in other languages are not found in this index.
+ * @param database  An open database connection, to be used from the calling thread.
+ * @param language  The language to index, given as a two-letter language code.
+ * @return true if the index could be built, false otherwise. The index is left empty on failure.
+ */
+bool CategoryNameIndex::build(QSqlDatabase database, QString language) {
+    QElapsedTimer timer;
+    timer.start();
+
+    m_language = language.left(2);
+    m_pilots.clear();
+    m_keys.clear();
+    m_categoryIds.clear();
+
+    // Ordering by category ID makes the choice deterministic for names used by multiple categories.
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    query.prepare(
+        "SELECT lang, name, category_id FROM category_names "
+        "WHERE lang LIKE :languageTerm "
+        "ORDER BY category_id"
+    );
+    query.bindValue(":languageTerm", m_language + "%");
+    if (!query.exec()) {
+        qWarning() << "CategoryNameIndex::build: ERROR: " << query.lastError().text();
+        return false;
+    }
+
+    QVector<QString> keys;
+    QVector<qint64> categoryIds;
+    QSet<QString> seen;
+    while (query.next()) {
+        QString k = key(query.value(0).toString(), query.value(1).toString());
+        if (seen.contains(k))
+            continue;
+        seen.insert(k);
+        keys << k;
+        categoryIds << query.value(2).toLongLong();
+    }
+
+    if (keys.isEmpty())
+        return false;
+
+    // A full 64 bit hash collision between two keys makes any seed fail, so retry with others.
+    for (quint64 attempt = 1; attempt <= 8; attempt++) {
+        if (place(keys, attempt * 0x9E3779B97F4A7C15ULL)) {
+            // Reorder keys and values from input order to slot order.
+            m_keys.resize(keys.size());
+            m_categoryIds.resize(keys.size());
+            for (int i = 0; i < keys.size(); i++) {
+                quint64 h = hash(keys[i], m_seed);
+                int s = slot(h, m_pilots[bucket(h)]);
+                m_keys[s] = keys[i];
+                m_categoryIds[s] = categoryIds[i];
+            }
+
+            qDebug() << "CategoryNameIndex::build: Indexed" << keys.size() << "names of language"
+                << m_language << "in" << timer.elapsed() << "ms.";
+            return true;
+        }
+    }
+
+    qWarning() << "CategoryNameIndex::build: ERROR: Could not find a perfect hash function.";
+    m_pilots.clear();
+    return false;
+}
+
+
+/**
+ * @brief Search the pilot values that place every key into its own slot, using the given seed.
+ * @return true on success, with m_seed and m_pilots set. false if no solution was found.
+ */
+bool CategoryNameIndex::place(const QVector<QString>& keys, quint64 seed) {
+    const int keyCount = keys.size();
+    const int bucketCount = qMax(1, keyCount / 4);
+    const quint32 maxPilot = 1u << 24;
+
+    m_seed = seed;
+    m_pilots.fill(0, bucketCount);
+    m_keys.resize(keyCount); // So that slot() knows the slot count.
+
+    std::vector<quint64> hashes(keyCount);
+    std::vector<std::vector<int>> buckets(bucketCount);
+    for (int i = 0; i < keyCount; i++) {
+        hashes[i] = hash(keys[i], seed);
+        buckets[bucket(hashes[i])].push_back(i);
+    }
+
+    // Place large buckets first, while there are still many free slots.
+    std::vector<int> order(bucketCount);
+    for (int b = 0; b < bucketCount; b++)
+        order[b] = b;
+    std::stable_sort(order.begin(), order.end(), [&buckets](int a, int b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    std::vector<bool> taken(keyCount, false);
+    std::vector<int> slots;
+    for (int b : order) {
+        const std::vector<int>& members = buckets[b];
+        if (members.empty())
+            break;
+
+        bool placed = false;
+        for (quint32 pilot = 0; pilot < maxPilot && !placed; pilot++) {
+            slots.clear();
+            placed = true;
+            for (int i : members) {
+                int s = slot(hashes[i], pilot);
+                if (taken[s] || std::find(slots.begin(), slots.end(), s) != slots.end()) {
+                    placed = false;
+                    break;
+                }
+                slots.push_back(s);
+            }
+            if (placed) {
+                m_pilots[b] = pilot;
+                for (int s : slots)
+                    taken[s] = true;
+            }
+        }
+
+        if (!placed)
+            return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Resolve a category name to its category ID.
+ * @param language  The language of the name, given as a two-letter language code.
+ * @param name  The category name, matched case-insensitively.
+ * @return The category ID, or -1 if there is no category with this name in this language.
+ */
+qint64 CategoryNameIndex::categoryId(QString language, QString name) const {
+    if (isEmpty())
+        return -1;
+
+    QString k = key(language, name);
+    quint64 h = hash(k, m_seed);
+    int s = slot(h, m_pilots[bucket(h)]);
+
+    return m_keys[s] == k ? m_categoryIds[s] : -1;
+}
+
+
+/** @brief The language of the indexed names, as a two-letter language code. */
+QString CategoryNameIndex::language() const {
+    return m_language;
+}
+
+
+/** @brief Determine if the index is unusable, because it has not been built successfully. */
+bool CategoryNameIndex::isEmpty() const {
+    return m_pilots.isEmpty();
+}
+
+
+/** @brief Number of (language, name) pairs in the index. */
+int CategoryNameIndex::size() const {
+    return isEmpty() ? 0 : m_keys.size();
+}
+
+
+/** @brief Approximate heap memory used by the index, in bytes. */
+qint64 CategoryNameIndex::memoryUsage() const {
+    qint64 bytes = m_pilots.capacity() * sizeof(quint32) + m_categoryIds.capacity() * sizeof(qint64)
+        + m_keys.capacity() * sizeof(QString);
+    for (const QString& key : m_keys)
+        bytes += key.capacity() * 2;
+    return bytes;
+}
+
+
+/**
+ * @brief Create the lookup key for a category name.
+ * @details Only the two-letter language part is used, as the application does not distinguish
+ *   regional language variants (see also ContentDatabase::updateCompletions()).
+ */
+QString CategoryNameIndex::key(QString language, QString name) {
+    return language.left(2).toCaseFolded() + QChar(0x1F) + name.toCaseFolded();
+}
+
+
+/** @brief Seeded 64 bit FNV-1a hash over the UTF-16 code units of a key. */
+quint64 CategoryNameIndex::hash(const QString& key, quint64 seed) {
+    quint64 h = 0xCBF29CE484222325ULL ^ seed;
+    for (QChar c : key) {
+        h ^= c.unicode();
+        h *= 0x100000001B3ULL;
+    }
+    return mix(h);
+}
+
+
+/** @brief The SplitMix64 finalizer, to spread all input bits over all output bits. */
+quint64 CategoryNameIndex::mix(quint64 value) {
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ULL;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBULL;
+    value ^= value >> 31;
+    return value;
+}
+
+
+int CategoryNameIndex::bucket(quint64 keyHash) const {
+    return int((keyHash >> 32) % quint64(m_pilots.size()));
+}
+
+
+int CategoryNameIndex::slot(quint64 keyHash, quint32 pilot) const {
+    return int(mix(keyHash ^ (quint64(pilot) * 0xC2B2AE3D27D4EB4FULL)) % quint64(m_keys.size()));
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+
+class CategoryNameIndex {
+
+public:
+    CategoryNameIndex();
+
+    bool build(QSqlDatabase database, QString language);
+
+    QString language() const;
+
+    qint64 categoryId(QString language, QString name) const;
+
+    bool isEmpty() const;
+
+    int size() const;
+
+    qint64 memoryUsage() const;
+
+private:
+    static QString key(QString language, QString name);
+    static quint64 hash(const QString& key, quint64 seed);
+    static quint64 mix(quint64 value);
+    int slot(quint64 keyHash, quint32 pilot) const;
+    int bucket(quint64 keyHash) const;
+
+    bool place(const QVector<QString>& keys, quint64 seed);
+
+    QString m_language;
+    quint64 m_seed;
+    QVector<quint32> m_pilots;   // Per bucket: the pilot value that places all of the bucket's keys.
+    QVector<QString> m_keys;     // Per slot: the case-folded key, to reject names not in the index.
+    QVector<qint64> m_categoryIds; // Per slot: the category ID to resolve to.
+};
@@ -0,0 +1,258 @@
+#include <QSet>
+#include <QDebug>
+
+#include "CompletionModel.h"
+
+
+/**
+ * @brief List model of the current auto-completions, for use in QML views.
+ * @details Replacing the completions with a new set only notifies views of the rows that were
+ *   actually removed, moved or inserted, so views keep the delegates of all other rows. Each row
+ *   provides the completion text (role "display"), the positions of the matched input fragments
+ *   (role "matchOffsets"), an optional description such as the category of a completed barcode
+ *   (role "detail") and the completion with its completed parts in bold and its description in
+ *   gray as HTML (role "highlightedText"), so that views do not have to compute these themselves.
+ */
+CompletionModel::CompletionModel(QObject* parent) : QAbstractListModel(parent) { }
+
+
+int CompletionModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : m_entries.size();
+}
+
+
+QVariant CompletionModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= m_entries.size())
+        return QVariant();
+
+    const Entry& e = m_entries.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return e.text;
+    case HighlightedTextRole:
+        return e.highlighted;
+    case DetailRole:
+        return e.detail;
+    case MatchOffsetsRole: {
+        QVariantList offsets;
+        for (int offset : e.offsets)
+            offsets << offset;
+        return offsets;
+    }
+    default:
+        return QVariant();
+    }
+}
+
+
+QHash<int, QByteArray> CompletionModel::roleNames() const {
+    QHash<int, QByteArray> roles = QAbstractListModel::roleNames();
+    roles[HighlightedTextRole] = "highlightedText";
+    roles[MatchOffsetsRole] = "matchOffsets";
+    roles[DetailRole] = "detail";
+    return roles;
+}
+
+
+/** @brief Number of completions. Provided as a property so QML can bind to it. */
+int CompletionModel::count() const {
+    return m_entries.size();
+}
+
+
+/** @brief The completion text in the given row, or "" if there is no such row. */
+QString CompletionModel::text(int row) const {
+    return (row >= 0 && row < m_entries.size()) ? m_entries.at(row).text : QString();
+}
+
+
+/**
+ * @brief Replace the completions with a new set, notifying views with minimal changes.
+ * @details Rows whose text is no longer present are removed first. Then the remaining rows are
+ *   brought into the new order by moving them, and new completions are inserted where needed. Rows
+ *   that are kept but match the new fragments differently get a dataChanged() notification only.
+ *   All steps are linear in the number of completions times the number of moved rows, which is
+ *   negligible for the few completions shown at a time.
+ * @param completions  The new completions, in display order.
+ * @param fragments  The space separated input fragments the completions were found for.
+ * @param details  Per completion, a description to show with it. Optional.
+ */
+void CompletionModel::setCompletions(const QStringList& completions, const QString& fragments,
+                                     const QStringList& details) {
+    int oldCount = m_entries.size();
+    m_fragments = fragments.split(" ", QString::SkipEmptyParts);
+
+    // Remove rows with texts that are not part of the new completions, from the back so that
+    // the row numbers still to process stay valid.
+    QSet<QString> wanted = completions.toSet();
+    for (int last = m_entries.size() - 1; last >= 0; ) {
+        if (wanted.contains(m_entries.at(last).text)) {
+            last--;
+            continue;
+        }
+        int first = last;
+        while (first > 0 && !wanted.contains(m_entries.at(first - 1).text))
+            first--;
+
+        beginRemoveRows(QModelIndex(), first, last);
+        for (int row = last; row >= first; row--)
+            m_entries.removeAt(row);
+        endRemoveRows();
+
+        last = first - 1;
+    }
+
+    // Establish the new order row by row, moving kept rows up and inserting new ones.
+    for (int row = 0; row < completions.size(); row++) {
+        const QString& text = completions.at(row);
+        const QString detail = details.value(row);
+
+        if (row < m_entries.size() && m_entries.at(row).text == text) {
+            Entry updated = entry(text, detail);
+            if (updated.offsets != m_entries.at(row).offsets || updated.detail != m_entries.at(row).detail) {
+                m_entries[row] = updated;
+                QModelIndex changed = index(row);
+                dataChanged(changed, changed, {HighlightedTextRole, MatchOffsetsRole, DetailRole});
+            }
+            continue;
+        }
+
+        int from = -1;
+        for (int i = row + 1; i < m_entries.size(); i++) {
+            if (m_entries.at(i).text == text) {
+                from = i;
+                break;
+            }
+        }
+
+        if (from >= 0) {
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), row);
+            m_entries.move(from, row);
+            endMoveRows();
+
+            Entry updated = entry(text, detail);
+            if (updated.offsets != m_entries.at(row).offsets || updated.detail != m_entries.at(row).detail) {
+                m_entries[row] = updated;
+                QModelIndex changed = index(row);
+                dataChanged(changed, changed, {HighlightedTextRole, MatchOffsetsRole, DetailRole});
+            }
+        }
+        else {
+            beginInsertRows(QModelIndex(), row, row);
+            m_entries.insert(row, entry(text, detail));
+            endInsertRows();
+        }
+    }
+
+    // Remove surplus rows left over from duplicate texts.
+    if (m_entries.size() > completions.size()) {
+        beginRemoveRows(QModelIndex(), completions.size(), m_entries.size() - 1);
+        while (m_entries.size() > completions.size())
+            m_entries.removeLast();
+        endRemoveRows();
+    }
+
+    if (m_entries.size() != oldCount)
+        countChanged();
+}
+
+
+/** @brief Remove all completions. */
+void CompletionModel::clear() {
+    if (m_entries.isEmpty())
+        return;
+
+    beginResetModel();
+    m_entries.clear();
+    endResetModel();
+    countChanged();
+}
+
+
+/**
+ * @brief Convert the ASCII letters of a text to lower case, leaving all other characters as they are.
+ * @details This is the case folding of SQLite's LIKE operator (without the ICU extension), so
+ *   comparing folded texts treats case the same as the database does. The length of the text
+ *   does not change, so offsets into the folded text apply to the original.
+ */
+QString CompletionModel::foldCase(const QString& text) {
+    QString folded = text;
+    for (QChar& c : folded)
+        if (c >= QLatin1Char('A') && c <= QLatin1Char('Z'))
+            c = QChar(c.unicode() + ('a' - 'A'));
+    return folded;
+}
+
+
+/**
+ * @brief Determine if the given fragments occur in the given order in a text, case-insensitively.
+ *   This is the in-memory equivalent of the SQL LIKE pattern used in
+ *   ContentDatabase::updateCompletions(). Like that, it ignores the case of ASCII letters only,
+ *   see foldCase().
+ * @param offsets  If given, receives the start and length of every fragment found, as consecutive
+ *   pairs. A fragment not found is skipped, and the search continues with the next one.
+ * @return true if all fragments were found, false otherwise.
+ */
+bool CompletionModel::match(const QString& text, const QStringList& fragments, QVector<int>* offsets) {
+    bool matched = true;
+    int position = 0;
+
+    if (offsets)
+        offsets->clear();
+
+    const QString foldedText = foldCase(text);
+    for (const QString& fragment : fragments) {
+        int start = foldedText.indexOf(foldCase(fragment), position);
+        if (start < 0) {
+            if (!offsets)
+                return false;
+            matched = false;
+            continue;
+        }
+
+        if (offsets)
+            *offsets << start << fragment.length();
+        position = start + fragment.length();
+    }
+
+    return matched;
+}
+
+
+CompletionModel::Entry CompletionModel::entry(const QString& text, const QString& detail) const {
+    Entry e;
+    e.text = text;
+    e.detail = detail;
+    match(text, m_fragments, &e.offsets);
+    e.highlighted = highlight(text, e.offsets, detail);
+    return e;
+}
+
+
+/**
+ * @brief Highlight the auto-completed parts of a completion using HTML, similar to a Google Search.
+ * @details The parts the user typed are shown normally, all other parts in bold. A description, if
+ *   any, follows in gray. All text is HTML-escaped, so completions containing "<" or "&" are shown
+ *   literally.
+ */
+QString CompletionModel::highlight(const QString& text, const QVector<int>& offsets, const QString& detail) {
+    QString result;
+    int position = 0;
+
+    auto appendBold = [&result, &text](int start, int end) {
+        if (end > start)
+            result += "<b>" + text.mid(start, end - start).toHtmlEscaped() + "</b>";
+    };
+
+    for (int i = 0; i + 1 < offsets.size(); i += 2) {
+        appendBold(position, offsets[i]);
+        result += text.mid(offsets[i], offsets[i + 1]).toHtmlEscaped();
+        position = offsets[i] + offsets[i + 1];
+    }
+    appendBold(position, text.length());
+
+    if (!detail.isEmpty())
+        result += " &nbsp;<font color=\"gray\">" + detail.toHtmlEscaped() + "</font>";
+
+    return result;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class CompletionModel : public QAbstractListModel {
+
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    enum Roles {
+        HighlightedTextRole = Qt::UserRole + 1,
+        MatchOffsetsRole,
+        DetailRole
+    };
+
+    explicit CompletionModel(QObject* parent = 0);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    QHash<int, QByteArray> roleNames() const override;
+
+    int count() const;
+
+    Q_INVOKABLE
+    QString text(int row) const;
+
+    void setCompletions(const QStringList& completions, const QString& fragments,
+                        const QStringList& details = QStringList());
+
+    void clear();
+
+    static QString foldCase(const QString& text);
+
+    static bool match(const QString& text, const QStringList& fragments, QVector<int>* offsets = nullptr);
+
+signals:
+    void countChanged();
+
+private:
+    struct Entry {
+        QString text;
+        QVector<int> offsets;  // Pairs of (start, length) of the matched fragments in text.
+        QString detail;
+        QString highlighted;
+    };
+
+    Entry entry(const QString& text, const QString& detail) const;
+
+    static QString highlight(const QString& text, const QVector<int>& offsets, const QString& detail);
+
+    QList<Entry> m_entries;
+    QStringList m_fragments;
+};
@@ -7,24 +7,440 @@
 #include <QObject>
 #include <QString>
 #include <QRegularExpression>
+#include <QXmlStreamReader>
+#include <QSet>
+#include <QHash>
 #include <QVariant>
 #include <QDebug>
 
 #include <QFile>
 #include <QFileInfo>
 #include <QStandardPaths>
+#include <QCoreApplication>
+#include <QThread>
+#include <QThreadStorage>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+
+#include <algorithm>
+#include <limits>
 
 #include "ContentDatabase.h"
+#include "ContentPack.h"
+#include "ContentUpdater.h"
+#include "MemoryBudget.h"
 #include "utilities.h"
 
 
+// Path of the database file in use, as set by ContentDatabase::connect() and switchDatabase().
+//   Read by all threads, so guarded by databasePathMutex. Every switch increments
+//   databaseGeneration, which makes threads reopen their connections (see connection()).
+static QString databasePath;
+static QMutex databasePathMutex;
+static QAtomicInt databaseGeneration;
+
+// The in-memory indexes of one language, as built together in the background by setLanguage().
+struct LanguageIndexes {
+    QSharedPointer<const CategoryNameIndex> categoryIndex;
+    QSharedPointer<const FuzzyIndex> fuzzyIndex;
+};
+
+// How many more completion candidates to fetch than requested, for refining them while typing.
+static const int completionSurplusFactor = 10;
+
+// Number of searches whose topics are memoized by topics().
+static const int topicsCacheSize = 4;
+
+// Maximum size of the rendered topics kept by renderTopic(), in bytes.
+static const int renderCacheBytes = 4 * 1024 * 1024;
+
+// Maximum size of the rendered HTML kept on disk across restarts, see RenderCache.
+static const qint64 diskCacheBytes = 32 * 1024 * 1024;
+
+// Number of topics rendered ahead per search term by prefetch(). These are the ones visible first.
+static const int prefetchedTopics = 3;
+
+// Content sections in display order. Must be the same order as in qrc:/docbook-to-qthtml.xsl.
+static const char* const sectionOrder[] = {
+    "assessment", "pantry_storage", "refrigerator_storage", "freezer_storage", "other_storage",
+    "commercial_storage", "risks", "symptoms", "donation_options", "post_spoilage", "edible_parts",
+    "preservation", "preparation", "utilization", "unliked_food", "residual_food",
+    "reuse_and_recycling", "production_waste", "packaging_waste"
+};
+
+
+// SQL statements of the queries. Kept together here, as statements() provides them for checking
+//   their query plans (see DatabaseValidator::checkQueryPlans()).
+
+// Category names containing the given fragments, for completion.
+//   TODO Use a full-text index in this search for speed.
+static const char* const completionsSql =
+    "SELECT name "
+    "FROM category_names "
+    "WHERE lang LIKE :languageTerm AND name LIKE :searchTerm ESCAPE '\\' "
+    "ORDER BY LENGTH(name) "
+    "LIMIT :limit";
+
+// Topics are found in two phases: first the IDs of the topics, deduplicated, and then their content,
+//   reading every topic once by its ID. Deduplicating only IDs is cheap, while deduplicating whole
+//   rows would compare the long content of a topic once per category path leading to it.
+
+// IDs of the topics for a product barcode.
+//   The query uses a recursive SQLite Common Table Expression (see https://sqlite.org/lang_with.html )
+//   to collect topics for a product based on both the directly assigned categories and the ancestor
+//   categories of those. UNION instead of UNION ALL expands every ancestor only once, even if
+//   reachable via multiple categories.
+static const char* const barcodeTopicIdsSql =
+    "WITH RECURSIVE all_product_categories (category_id) AS ( "
+    //   -- Add the product's directly assigned categories to seed the recursion.
+    "    SELECT product_categories.category_id "
+    "        FROM product_categories "
+    "            INNER JOIN products ON products.id = product_categories.product_id "
+    "        WHERE products.code = :code "
+    "    UNION "
+    //   -- Recursively add all the product's categories assigned indirectly via ancestry relations.
+    "    SELECT category_structure.parent_id "
+    "        FROM all_product_categories "
+    "            INNER JOIN category_structure ON all_product_categories.category_id = category_structure.category_id "
+    ") "
+    "SELECT DISTINCT topic_categories.topic_id "
+    "FROM all_product_categories "
+    "    INNER JOIN topic_categories ON all_product_categories.category_id = topic_categories.category_id "
+    "ORDER BY topic_categories.topic_id";
+
+// The ID of a category, given its name. Requires a table scan because of the case-insensitive comparison.
+static const char* const categoryIdSql =
+    "SELECT category_id FROM category_names "
+    "WHERE name = :name COLLATE NOCASE AND lang LIKE :languageTerm LIMIT 1";
+
+/**
+ * @brief The SQL statement finding the IDs of the topics for a category.
+ * @details As above, the query uses a recursive CTE (see https://sqlite.org/lang_with.html ). It first
+ *   builds up a table category_ancestry containing the category in question and all its ancestors,
+ *   and then uses that in the main SELECT at the end to find topics connected to any of these
+ *   ancestor categories.
+ * @param categoryIdSelect  A SELECT statement providing the category's ID.
+ */
+static QString categoryTopicIdsSql(QString categoryIdSelect) {
+    return
+        "WITH RECURSIVE "
+        //   -- Defining a reusable 'variable' var_1.category_id, as seen at https://stackoverflow.com/a/56179189
+        "    var_1 (category_id) AS (" + categoryIdSelect + "), "
+        "    "
+        "    category_ancestry (category_id) AS ( "
+        //       -- Add the search term category as the root of its ancestry.
+        "        SELECT var_1.category_id FROM var_1 "
+        "        UNION "
+        //       -- Recursively add all ancestors of the search term category.
+        "        SELECT category_structure.parent_id "
+        "            FROM category_ancestry "
+        "                INNER JOIN category_structure ON category_ancestry.category_id = category_structure.category_id "
+        "    ) "
+        "SELECT DISTINCT topic_categories.topic_id "
+        "FROM category_ancestry "
+        "    INNER JOIN topic_categories ON category_ancestry.category_id = topic_categories.category_id "
+        "ORDER BY topic_categories.topic_id";
+}
+
+/**
+ * @brief The SQL statement reading the content of topics, given their IDs.
+ * @param count  Number of topics. Their IDs are bound to placeholders :id0, :id1 etc..
+ */
+static QString topicsByIdSql(int count) {
+    QStringList placeholders;
+    for (int i = 0; i < count; i++)
+        placeholders << QString(":id%1").arg(i);
+
+    return
+        "SELECT topics.id, topic_contents.title, topics.section, topics.version, topic_contents.content "
+        "FROM topics "
+        "    INNER JOIN topic_contents ON topic_contents.topic_id = topics.id "
+        "WHERE "
+        "    topics.id IN (" + placeholders.join(", ") + ") AND "
+        "    topic_contents.lang = :lang "
+        "ORDER BY topics.id";
+}
+
+// Maximum number of topics read by one statement. SQLite limits the number of placeholders.
+static const int topicsPerStatement = 500;
+
+// Names of the categories directly assigned to a product.
+static const char* const productCategoriesSql =
+    "SELECT category_names.name "
+    "FROM products "
+    "    INNER JOIN product_categories ON products.id = product_categories.product_id "
+    "    INNER JOIN category_names ON product_categories.category_id = category_names.category_id "
+    "WHERE "
+    "    products.code = :code AND "
+    "    category_names.lang = :lang";
+
+// The most specific category of a product: one of its categories that is no parent of another one.
+static const char* const topCategorySql =
+    "SELECT category_names.name "
+    "FROM products "
+    "    INNER JOIN product_categories ON products.id = product_categories.product_id "
+    "    INNER JOIN category_names ON product_categories.category_id = category_names.category_id "
+    "WHERE "
+    "    products.code = :code AND "
+    "    category_names.lang = :lang AND "
+    "    NOT EXISTS ( "
+    "        SELECT 1 FROM product_categories AS other "
+    "            INNER JOIN category_structure ON other.category_id = category_structure.category_id "
+    "        WHERE other.product_id = products.id AND category_structure.parent_id = product_categories.category_id "
+    "    ) "
+    "LIMIT 1";
+
+// Barcodes in a range of numbers, for completing barcodes while the barcode index is not available.
+static const char* const barcodeRangeSql =
+    "SELECT code FROM products WHERE code >= :low AND code < :high ORDER BY code LIMIT :limit";
+
+/**
+ * @brief The SQL statement finding the names of the categories directly assigned to many products.
+ * @param count  Number of products. Their barcodes are bound to placeholders :code0, :code1 etc..
+ */
+static QString lookupBatchSql(int count) {
+    QStringList placeholders;
+    for (int i = 0; i < count; i++)
+        placeholders << QString(":code%1").arg(i);
+
+    return
+        "SELECT products.code, category_names.name "
+        "FROM products "
+        "    INNER JOIN product_categories ON products.id = product_categories.product_id "
+        "    INNER JOIN category_names ON product_categories.category_id = category_names.category_id "
+        "WHERE "
+        "    products.code IN (" + placeholders.join(", ") + ") AND "
+        "    category_names.lang = :lang";
+}
+
+// Maximum number of products looked up by one statement. SQLite limits the number of placeholders.
+static const int productsPerStatement = 500;
+
+/**
+ * @brief The SQL statement reading one page of the child categories of a category, for browsing.
+ * @details Pages use keyset pagination: a page starts after the name and ID of the last category of
+ *   the previous page, bound to :afterName and :afterId. Categories without a name in the given
+ *   language are left out, as they could not be shown.
+ *
+ *   Root categories are read along the index on category_names (lang, name, category_id): a page
+ *   seeks to its first category with the row value comparison and stops after :limit categories, so
+ *   it never reads the categories of the previous pages again. It does pass over the names of the
+ *   non-root categories in between, each checked with one index lookup. The children of a category are read
+ *   with the index on category_structure.parent_id and then sorted, so every page of them costs
+ *   time in proportion to the number of children of that category, but not to the page position.
+ *   Going through the name index there instead would pass over the names of all other categories,
+ *   so CROSS JOIN makes SQLite keep that join order, and the unary "+" keeps it from looking up the
+ *   names of each child in the name index instead of by category ID.
+ *
+ *   The numbers of child categories and topics are only counted for the categories of the page.
+ * @param roots  If to read the categories without a parent instead of the children of :parentId.
+ */
+static QString categoryChildrenSql(bool roots) {
+    QString children = roots ?
+        "        FROM category_names "
+        "        WHERE "
+        "            NOT EXISTS ( "
+        "                SELECT 1 FROM category_structure "
+        "                WHERE category_structure.category_id = category_names.category_id "
+        "            ) AND "
+        "            category_names.lang = :lang AND " :
+        "        FROM category_structure "
+        "            CROSS JOIN category_names ON category_structure.category_id = category_names.category_id "
+        "        WHERE "
+        "            category_structure.parent_id = :parentId AND "
+        "            +category_names.lang = :lang AND ";
+
+    return
+        "SELECT "
+        "    page.category_id, "
+        "    page.name, "
+        "    (SELECT COUNT(*) FROM category_structure WHERE category_structure.parent_id = page.category_id), "
+        "    (SELECT COUNT(*) FROM topic_categories WHERE topic_categories.category_id = page.category_id) "
+        "FROM ( "
+        "    SELECT category_names.category_id, category_names.name "
+        + children +
+        "            (category_names.name, category_names.category_id) > (:afterName, :afterId) "
+        "        ORDER BY category_names.name, category_names.category_id "
+        "        LIMIT :limit "
+        ") AS page "
+        "ORDER BY page.name, page.category_id";
+}
+
+// The parent categories of a category, for navigating up while browsing.
+static const char* const parentCategoriesSql =
+    "SELECT category_names.category_id, category_names.name "
+    "FROM category_structure "
+    "    INNER JOIN category_names ON category_structure.parent_id = category_names.category_id "
+    "WHERE "
+    "    category_structure.category_id = :categoryId AND "
+    "    category_names.lang = :lang "
+    "ORDER BY category_names.name";
+
+// Number of topics directly assigned to a category.
+static const char* const topicCountSql =
+    "SELECT COUNT(*) FROM topic_categories WHERE category_id = :categoryId";
+
+
+/**
+ * @brief A read-only database connection owned by one thread other than the main thread.
+ * @details Stored in QThreadStorage, so the connection is closed and removed when its thread ends.
+ */
+struct ThreadConnection {
+    QString name;
+    int generation;
+
+    ThreadConnection(QString path, int generation) : generation(generation) {
+        name = QString("ContentDatabase-%1").arg(quintptr(this));
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY");
+        db.setDatabaseName(path);
+        if (!db.open())
+            qWarning() << "ThreadConnection: ERROR: could not open database" << path << ":" << db.lastError().text();
+    }
+
+    ~ThreadConnection() {
+        // The QSqlDatabase object has to go out of scope before removing its connection.
+        {
+            QSqlDatabase db = QSqlDatabase::database(name, false);
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(name);
+    }
+};
+
+
 /**
  * @brief Interface to a SQLite3 database with e-book like content.
  * @details The difference from typical e-book (such as EPUB) is that the content can be queried
  *   with a database interface. In this implementation (containing food rescue content), content
  *   can be queried based on product barcode or food category.
  */
-ContentDatabase::ContentDatabase (QObject* parent) : QObject(parent) { }
+ContentDatabase::ContentDatabase (QObject* parent) : QObject(parent),
+    m_completionModel(new CompletionModel(this)), m_validator(new DatabaseValidator(this)),
+    m_candidatesComplete(false),
+    m_diskCache(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/rendered", diskCacheBytes) {
+
+    m_renderCache.setMaxCost(renderCacheBytes);
+
+    QObject::connect(m_validator, &DatabaseValidator::failed, this, &ContentDatabase::reportDamage);
+
+    // Prefetching must not compete with work the user waits for, so it uses one low priority thread.
+    m_prefetchPool.setMaxThreadCount(1);
+
+    registerCaches();
+}
+
+
+ContentDatabase::~ContentDatabase() {
+    m_prefetchGeneration.ref();
+    m_prefetchPool.clear();
+    m_prefetchPool.waitForDone();
+
+    MemoryBudget::instance()->unregisterCache(m_renderCacheBudgetId);
+    MemoryBudget::instance()->unregisterCache(m_categoryIndexBudgetId);
+    MemoryBudget::instance()->unregisterCache(m_fuzzyIndexBudgetId);
+    MemoryBudget::instance()->unregisterCache(m_topicsCacheBudgetId);
+    MemoryBudget::instance()->unregisterCache(m_barcodeIndexBudgetId);
+}
+
+
+/** @brief Approximate heap memory used by a list of topics, in bytes. */
+static qint64 memoryUsage(const QVector<ContentTopic>& topics) {
+    qint64 bytes = topics.capacity() * sizeof(ContentTopic);
+    for (const ContentTopic& topic : topics)
+        bytes += (topic.title.size() + topic.section.size() + topic.version.size() + topic.content.size()) * 2;
+    return bytes;
+}
+
+
+/**
+ * @brief Register the in-memory caches and indexes with the application's memory budget.
+ * @details The category name index is expensive to rebuild, but when evicted, category name
+ *   lookups simply fall back to SQL, and it is rebuilt at the next language or database switch.
+ *   Likewise, without the fuzzy index, completion only offers exact matches until then.
+ *   The memoized topics are cheap to evict, as they are only needed again when showing the
+ *   literature of the same search term. Rendered topics cost a transform each to recreate.
+ *
+ *   The indexes can only be evicted as a whole. The memoized and rendered topics are evicted least
+ *   recently used first, only until the requested number of bytes is freed.
+ */
+void ContentDatabase::registerCaches() {
+    m_categoryIndexBudgetId = MemoryBudget::instance()->registerCache(
+        "ContentDatabase", "categoryIndex", 8, [this](qint64) {
+            QSharedPointer<const CategoryNameIndex> index;
+            {
+                QMutexLocker locker(&m_languageDataMutex);
+                index.swap(m_categoryIndex);
+                m_language.clear();
+            }
+            MemoryBudget::instance()->report(m_categoryIndexBudgetId, 0);
+            return index.isNull() ? qint64(0) : index->memoryUsage();
+        }
+    );
+
+    m_fuzzyIndexBudgetId = MemoryBudget::instance()->registerCache(
+        "ContentDatabase", "fuzzyIndex", 6, [this](qint64) {
+            QSharedPointer<const FuzzyIndex> index;
+            {
+                QMutexLocker locker(&m_languageDataMutex);
+                index.swap(m_fuzzyIndex);
+                m_language.clear();
+            }
+            MemoryBudget::instance()->report(m_fuzzyIndexBudgetId, 0);
+            return index.isNull() ? qint64(0) : index->memoryUsage();
+        }
+    );
+
+    m_barcodeIndexBudgetId = MemoryBudget::instance()->registerCache(
+        "ContentDatabase", "barcodeIndex", 7, [this](qint64) {
+            QSharedPointer<const BarcodeIndex> index;
+            {
+                QMutexLocker locker(&m_barcodeIndexMutex);
+                index.swap(m_barcodeIndex);
+            }
+            MemoryBudget::instance()->report(m_barcodeIndexBudgetId, 0);
+            return index.isNull() ? qint64(0) : index->memoryUsage();
+        }
+    );
+
+    m_topicsCacheBudgetId = MemoryBudget::instance()->registerCache(
+        "ContentDatabase", "topicsCache", 2, [this](qint64 bytes) {
+            qint64 freed = 0;
+            qint64 remaining = 0;
+            {
+                QMutexLocker locker(&m_topicsCacheMutex);
+                while (!m_topicsCache.isEmpty() && freed < bytes) {
+                    freed += memoryUsage(m_topicsCache.last().topics);
+                    m_topicsCache.removeLast();
+                }
+                for (const TopicsCacheEntry& entry : m_topicsCache)
+                    remaining += memoryUsage(entry.topics);
+            }
+            MemoryBudget::instance()->report(m_topicsCacheBudgetId, remaining);
+            return freed;
+        }
+    );
+
+    m_renderCacheBudgetId = MemoryBudget::instance()->registerCache(
+        "ContentDatabase", "renderCache", 4, [this](qint64 bytes) {
+            QMutexLocker locker(&m_renderCacheMutex);
+            qint64 before = m_renderCache.totalCost();
+
+            // Lowering the maximum cost makes QCache drop its least recently used entries until the
+            //   rest fits. The maximum is restored afterwards, so the cache can grow again.
+            int maxCost = m_renderCache.maxCost();
+            m_renderCache.setMaxCost(int(qMax(qint64(0), before - bytes)));
+            m_renderCache.setMaxCost(maxCost);
+
+            MemoryBudget::instance()->report(m_renderCacheBudgetId, m_renderCache.totalCost());
+            return before - m_renderCache.totalCost();
+        }
+    );
+}
 
 
 /**
@@ -63,6 +479,10 @@ void ContentDatabase::connect() {
         //   residing inside the installed APK do not have an ordinary path in the underlying file
         //   system. See: https://stackoverflow.com/a/4820905 and https://stackoverflow.com/a/62596863
         dbName = androidAssetToFile(dbName);
+
+        // The content pack is optional, see openPack().
+        if (QFile::exists("assets:/foodrescue-content.frpack"))
+            androidAssetToFile("assets:/foodrescue-content.frpack");
     }
     else {
         // Look through Qt's app data directories from high to low priority and use the first DB file found.
@@ -73,6 +493,9 @@ void ContentDatabase::connect() {
         }
     }
 
+    // Use an updated copy of the database instead, if one is newer (see ContentUpdater).
+    dbName = ContentUpdater::newestDatabase(dbName);
+
     qDebug() << "ContentDatabase::connect: Database path used:" << dbName;
 
     // Make sure the database file exists.
@@ -90,10 +513,26 @@ void ContentDatabase::connect() {
     qDebug() << "ContentDatabase::connect: Going to open database" << dbName;
     if(db.open()) {
         qDebug() << "ContentDatabase::connect: Database opened.";
+        {
+            QMutexLocker locker(&databasePathMutex);
+            databasePath = dbName;
+        }
+        {
+            QMutexLocker locker(&m_renderCacheMutex);
+            m_databaseFingerprint = DatabaseValidator::fingerprint(dbName);
+        }
 
-        // TODO: Throw an error if the database does not have the expected table structure. That helps
-        // to prevent surprises if the database file had been accidentally deleted and then automatically
-        // re-creatd by db.open() above (which is what happens if the file is not found).
+        // Check the database, without delaying the start: only cheap checks are done before using it,
+        //   while the full check of the table structure and file integrity runs in the background.
+        //   The full check is skipped if the same file passed it before. See DatabaseValidator.
+        QString problem = m_validator->check(dbName);
+        if (problem.isEmpty())
+            m_validator->validate(dbName);
+        else
+            reportDamage(dbName, problem);
+
+        openPack();
+        buildBarcodeIndex();
     }
     else {
         // TODO: Rather throw an exception.
@@ -104,6 +543,324 @@ void ContentDatabase::connect() {
 }
 
 
+/**
+ * @brief Provide the database connection to use in the calling thread.
+ * @details A QSqlDatabase connection may only be used by the thread that created it. The main
+ *   thread uses the default connection set up in connect(). Every other thread gets its own
+ *   read-only connection to the same database file when calling this the first time.
+ */
+QSqlDatabase ContentDatabase::connection() {
+    if (QThread::currentThread() == QCoreApplication::instance()->thread())
+        return QSqlDatabase::database();
+
+    // Replacing the local data deletes the previous connection of this thread.
+    static QThreadStorage<ThreadConnection*> threadConnections;
+    int generation = databaseGeneration.load();
+    if (!threadConnections.hasLocalData() || threadConnections.localData()->generation != generation)
+        threadConnections.setLocalData(new ThreadConnection(databaseFile(), generation));
+
+    return QSqlDatabase::database(threadConnections.localData()->name);
+}
+
+
+/** @brief The path of the database file in use. Thread-safe. */
+QString ContentDatabase::databaseFile() {
+    QMutexLocker locker(&databasePathMutex);
+    return databasePath;
+}
+
+
+/**
+ * @brief Switch to another version of the content database, without restarting the application.
+ * @details The default connection is reopened with the new file right away, while other threads
+ *   reopen their connections on their next call of connection(). Everything derived from the
+ *   previous database content is invalidated: completions are cleared and the in-memory indexes are
+ *   rebuilt in the background (until then, queries fall back to SQL as after a language change).
+ *
+ *   Connected to ContentUpdater::updated() in main.cpp.
+ * @param databaseFile  The new database file, typically an updated copy made by ContentUpdater.
+ */
+void ContentDatabase::switchDatabase(QString databaseFile) {
+    QString problem = m_validator->check(databaseFile);
+    if (!problem.isEmpty()) {
+        qWarning() << "ContentDatabase::switchDatabase: ERROR: database" << databaseFile << "is damaged:"
+            << problem << ". Staying with the previous one.";
+        return;
+    }
+
+    {
+        QSqlDatabase db = QSqlDatabase::database();
+        db.close();
+        db.setDatabaseName(databaseFile);
+        if (!db.open()) {
+            qWarning() << "ContentDatabase::switchDatabase: ERROR: could not open database "
+                << databaseFile << ": " << db.lastError().text() << ". Staying with the previous one.";
+            db.setDatabaseName(ContentDatabase::databaseFile());
+            db.open();
+            return;
+        }
+    }
+
+    {
+        QMutexLocker locker(&databasePathMutex);
+        databasePath = databaseFile;
+    }
+    {
+        QMutexLocker locker(&m_renderCacheMutex);
+        m_databaseFingerprint = DatabaseValidator::fingerprint(databaseFile);
+    }
+    databaseGeneration.ref();
+    qDebug() << "ContentDatabase::switchDatabase: Now using database" << databaseFile;
+
+    if (!m_damage.isEmpty()) {
+        m_damage.clear();
+        damageChanged();
+    }
+    m_validator->validate(databaseFile);
+
+    clearCompletions();
+    {
+        QMutexLocker locker(&m_languageDataMutex);
+        m_categoryIndex.reset();
+        m_fuzzyIndex.reset();
+    }
+    MemoryBudget::instance()->report(m_categoryIndexBudgetId, 0);
+    MemoryBudget::instance()->report(m_fuzzyIndexBudgetId, 0);
+    openPack();
+    buildBarcodeIndex();
+    QString language = m_pendingLanguage.isEmpty() ? m_language : m_pendingLanguage;
+    {
+        QMutexLocker locker(&m_languageDataMutex);
+        m_language.clear();
+    }
+    m_pendingLanguage.clear();
+    if (!language.isEmpty())
+        setLanguage(language);
+
+    contentChanged();
+}
+
+
+/**
+ * @brief Switch the in-memory indexes to the given language.
+ * @details Indexes are only kept for one language at a time, the active user interface language.
+ *   So their memory usage does not grow with the number of languages in the database. The indexes
+ *   for the new language are built in the background. Until they are ready, the indexes of the
+ *   previous language stay in use, and queries in the new language fall back to (slower) SQL. Once
+ *   ready, they are swapped in as a whole, so no query ever sees a partially built index.
+ *
+ *   Connected to LocaleChanger::localeChanged() in main.cpp.
+ * @param language  The new language, given as a two-letter language code or as a Qt locale name.
+ */
+void ContentDatabase::setLanguage(QString language) {
+    language = language.left(2);
+
+    // Switching back to the active language discards the build for the language switched to before.
+    if (language == m_language) {
+        m_pendingLanguage.clear();
+        return;
+    }
+    if (language == m_pendingLanguage)
+        return;
+
+    m_pendingLanguage = language;
+    qDebug() << "ContentDatabase::setLanguage: Building indexes for language" << language;
+
+    QFutureWatcher<LanguageIndexes>* watcher = new QFutureWatcher<LanguageIndexes>(this);
+
+    int generation = databaseGeneration.load();
+    QObject::connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, language, generation]() {
+        watcher->deleteLater();
+
+        // Discard the result if another language or database was switched to in the meantime.
+        if (language != m_pendingLanguage || generation != databaseGeneration.load())
+            return;
+
+        LanguageIndexes indexes = watcher->result();
+        {
+            QMutexLocker locker(&m_languageDataMutex);
+            m_categoryIndex = indexes.categoryIndex;
+            m_fuzzyIndex = indexes.fuzzyIndex;
+            m_language = language;
+        }
+        MemoryBudget::instance()->report(m_categoryIndexBudgetId, indexes.categoryIndex->memoryUsage());
+        MemoryBudget::instance()->report(m_fuzzyIndexBudgetId, indexes.fuzzyIndex->memoryUsage());
+        m_pendingLanguage.clear();
+        qDebug() << "ContentDatabase::setLanguage: Indexes for language" << language << "are in use now.";
+
+        languageDataChanged(language);
+    });
+
+    watcher->setFuture(QtConcurrent::run([language]() {
+        QSharedPointer<CategoryNameIndex> categoryIndex(new CategoryNameIndex());
+        categoryIndex->build(ContentDatabase::connection(), language);
+        QSharedPointer<FuzzyIndex> fuzzyIndex(new FuzzyIndex());
+        fuzzyIndex->build(ContentDatabase::connection(), language);
+
+        LanguageIndexes indexes;
+        indexes.categoryIndex = categoryIndex;
+        indexes.fuzzyIndex = fuzzyIndex;
+        return indexes;
+    }));
+}
+
+
+/**
+ * @brief Provide the category name index of the active language. Thread-safe.
+ * @return The index, or an empty index if none was built so far.
+ */
+QSharedPointer<const CategoryNameIndex> ContentDatabase::categoryIndex() const {
+    QMutexLocker locker(&m_languageDataMutex);
+    if (m_categoryIndex.isNull())
+        return QSharedPointer<const CategoryNameIndex>(new CategoryNameIndex());
+    return m_categoryIndex;
+}
+
+
+/**
+ * @brief Provide the fuzzy completion index of the active language. Thread-safe.
+ * @return The index, or an empty index if none was built so far.
+ */
+QSharedPointer<const FuzzyIndex> ContentDatabase::fuzzyIndex() const {
+    QMutexLocker locker(&m_languageDataMutex);
+    if (m_fuzzyIndex.isNull())
+        return QSharedPointer<const FuzzyIndex>(new FuzzyIndex());
+    return m_fuzzyIndex;
+}
+
+
+/**
+ * @brief Provide the barcode index of the database in use. Thread-safe.
+ * @return The index, or an empty index if none was built so far.
+ */
+QSharedPointer<const BarcodeIndex> ContentDatabase::barcodeIndex() const {
+    QMutexLocker locker(&m_barcodeIndexMutex);
+    if (m_barcodeIndex.isNull())
+        return QSharedPointer<const BarcodeIndex>(new BarcodeIndex());
+    return m_barcodeIndex;
+}
+
+
+/**
+ * @brief Build the barcode index of the database in use, in the background.
+ * @details Until it is ready, barcodes are completed with SQL, see completeBarcodes(). The index of
+ *   a previous database is discarded right away, as its barcodes may no longer exist. No index is
+ *   needed when the database has a content pack, as that contains the sorted barcodes already.
+ */
+void ContentDatabase::buildBarcodeIndex() {
+    {
+        QMutexLocker locker(&m_barcodeIndexMutex);
+        m_barcodeIndex.reset();
+    }
+    MemoryBudget::instance()->report(m_barcodeIndexBudgetId, 0);
+    if (!pack().isNull())
+        return;
+
+    QFutureWatcher<QSharedPointer<const BarcodeIndex>>* watcher =
+        new QFutureWatcher<QSharedPointer<const BarcodeIndex>>(this);
+
+    int generation = databaseGeneration.load();
+    QObject::connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation]() {
+        watcher->deleteLater();
+
+        // Discard the result if another database was switched to in the meantime.
+        if (generation != databaseGeneration.load())
+            return;
+
+        QSharedPointer<const BarcodeIndex> index = watcher->result();
+        {
+            QMutexLocker locker(&m_barcodeIndexMutex);
+            m_barcodeIndex = index;
+        }
+        MemoryBudget::instance()->report(m_barcodeIndexBudgetId, index->memoryUsage());
+    });
+
+    watcher->setFuture(QtConcurrent::run([]() {
+        QSharedPointer<BarcodeIndex> index(new BarcodeIndex());
+        index->build(ContentDatabase::connection());
+        return QSharedPointer<const BarcodeIndex>(index);
+    }));
+}
+
+
+/** @brief Provide the content pack of the database in use, or a null pointer if it has none. Thread-safe. */
+QSharedPointer<const ContentPack> ContentDatabase::pack() const {
+    QMutexLocker locker(&m_packMutex);
+    return m_pack;
+}
+
+
+/**
+ * @brief Use the content pack of the database in use, if one was made from this database version.
+ * @details The pack is looked for next to the database file (see ContentPack::packFile()). It
+ *   answers barcode and category lookups from memory-mapped arrays, without SQL. Opening it is
+ *   cheap, so unlike the in-memory indexes it is ready right away. Without a pack, everything is
+ *   looked up with SQL as before. That includes updated databases made by ContentUpdater, as their
+ *   changes are not in the pack of the bundled database.
+ */
+void ContentDatabase::openPack() {
+    QString databaseFile = ContentDatabase::databaseFile();
+    QString packFile = ContentPack::packFile(databaseFile);
+
+    QSharedPointer<ContentPack> pack;
+    if (QFile::exists(packFile)) {
+        pack.reset(new ContentPack());
+        if (!pack->open(packFile, ContentUpdater::userVersion(databaseFile)))
+            pack.reset();
+    }
+
+    QMutexLocker locker(&m_packMutex);
+    m_pack = pack;
+}
+
+
+/** @brief The current auto-completions, as provided by updateCompletions(). */
+CompletionModel* ContentDatabase::completionModel() const {
+    return m_completionModel;
+}
+
+
+/**
+ * @brief A description of the damage found in the database file in use, or "" if none was found.
+ * @details Damage is found by the checks of DatabaseValidator, or by a query reading a damaged part
+ *   of the file, whichever happens first. Queries may fail or return incomplete results then.
+ */
+QString ContentDatabase::damage() const {
+    return m_damage;
+}
+
+
+void ContentDatabase::reportDamage(QString databaseFile, QString problem) {
+    if (databaseFile != ContentDatabase::databaseFile() || !m_damage.isEmpty())
+        return;
+
+    qWarning() << "ContentDatabase::reportDamage: ERROR: Database" << databaseFile << "is damaged:" << problem;
+    m_damage = problem;
+    damageChanged();
+}
+
+
+/**
+ * @brief Report damage of the database file if the given query error was caused by it. Thread-safe.
+ * @details SQLite finds damaged pages when a query reads them. So damage is reported as soon as
+ *   a query hits it, even if the background check did not find it yet. It is then also remembered
+ *   for the next start, see DatabaseValidator::recordFailure().
+ */
+void ContentDatabase::checkForDamage(const QSqlError& error) const {
+    // SQLITE_CORRUPT and SQLITE_NOTADB.
+    if (error.nativeErrorCode() != "11" && error.nativeErrorCode() != "26")
+        return;
+
+    QString file = databaseFile();
+    QString problem = error.databaseText();
+    ContentDatabase* self = const_cast<ContentDatabase*>(this);
+    QMetaObject::invokeMethod(m_validator, [self, file, problem]() {
+        self->m_validator->recordFailure(file, problem);
+        self->reportDamage(file, problem);
+    }, Qt::QueuedConnection);
+}
+
+
 /**
  * @brief Normalize the provided search term.
  * @param searchTerm The raw search term, usually as entered by a user.
@@ -124,43 +881,240 @@ QString ContentDatabase::normalize(QString searchTerm) {
  * @brief Provide search term auto-completion for the given text. Completion is right now done using
  *   only category names, but this may be extended later. Results are provided in member
  *   m_completionModel and to QML as property completionModel.
+ * @details While the user types on, each new input usually extends the previous one, so its results
+ *   are a subset of the previous results. To exploit that, the database search fetches more
+ *   candidates than needed (see completionSurplusFactor). When the new input extends the previous
+ *   one, these candidates are filtered in memory and the database is only queried again once they
+ *   no longer provide enough results. So the cost per keystroke is proportional to the number of
+ *   candidates, not to the size of the database.
  * @param fragments  Space separated parts that must occur in this order as substrings in the
  *   auto-completion results.
  * @param limit  Maximum number of completion results to provide.
  */
 void ContentDatabase::updateCompletions(QString fragments, QString language, int limit) {
-    QSqlQuery query;
-    QString searchTerm =  "%" + fragments.replace(" ", "%") + "%";
-    QString languageTerm = language + "%";
+    // If there is nothing to complete, we're done.
+    if(fragments.isEmpty()) {
+        m_completionModel->clear();
+        completionsChanged();
+        return;
+    }
 
-    // TODO Use a full-text index in this search for speed.
-    query.prepare(
-        "SELECT name "
-        "FROM category_names "
-        "WHERE lang LIKE :languageTerm AND name LIKE :searchTerm "
-        "ORDER BY LENGTH(name) "
-        "LIMIT :limit"
-    );
-    query.bindValue(":languageTerm", languageTerm);
-    query.bindValue(":searchTerm", searchTerm);
-    query.bindValue(":limit", limit);
+    // Complete barcode numbers to the barcodes of products, each shown with its category.
+    //   At least one digit is required, as spaces alone are no barcode.
+    static const QRegularExpression spacedNumber("^[0-9 ]*[0-9][0-9 ]*$");
+    if (spacedNumber.match(fragments).hasMatch()) {
+        QString digits = normalize(fragments);
+        QStringList codes = completeBarcodes(digits, limit);
+        QStringList categories;
+        for (const QString& code : codes)
+            categories << topCategory(code, language);
 
-    m_completionModel.clear();
+        // Name candidates do not apply to later inputs anymore.
+        m_candidates.clear();
+        m_candidatesInput.clear();
+        m_completionModel->setCompletions(codes, digits, categories);
 
-    // If there is nothing to complete, we're done.
-    if(fragments.isEmpty()) {
         completionsChanged();
         return;
     }
 
+    // Refine the previous candidates if possible.
+    //   The comparison ignores case as SQL LIKE does (see CompletionModel::foldCase()), so an extended
+    //   input still selects a subset. Since candidates are ordered by length, the first "limit" matches among them are also
+    //   the first "limit" matches in the database. If there are fewer, the candidates only suffice if
+    //   they were all matches in the database.
+    bool isExtension =
+        !m_candidatesInput.isEmpty() && language == m_candidatesLanguage &&
+        CompletionModel::foldCase(fragments).startsWith(CompletionModel::foldCase(m_candidatesInput));
+    if (isExtension) {
+        QStringList fragmentList = fragments.split(" ", QString::SkipEmptyParts);
+        QStringList remaining;
+        for (const QString& candidate : m_candidates)
+            if (CompletionModel::match(candidate, fragmentList))
+                remaining << candidate;
+
+        if (remaining.size() >= limit || m_candidatesComplete) {
+            m_candidates = remaining;
+            m_candidatesInput = fragments;
+            m_completionModel->setCompletions(
+                addFuzzyCompletions(remaining.mid(0, limit), fragments, language, limit), fragments
+            );
+
+            completionsChanged();
+            return;
+        }
+    }
+
+    // Otherwise search the database, fetching surplus candidates for refinement later.
+    int candidateLimit = limit * completionSurplusFactor;
+    m_candidates = queryCompletions(fragments, language, candidateLimit);
+
+    m_candidatesInput = fragments;
+    m_candidatesLanguage = language;
+    m_candidatesComplete = m_candidates.size() < candidateLimit;
+    m_completionModel->setCompletions(
+        addFuzzyCompletions(m_candidates.mid(0, limit), fragments, language, limit), fragments
+    );
+
+    // Notify QML components and widgets using completionsModel to update their data.
+    completionsChanged();
+}
+
+
+/**
+ * @brief Fill up completions with typo-tolerant matches, if there are fewer than wanted.
+ * @details This is the second tier of completion, after the exact matches. It is only available
+ *   for the active language, using its FuzzyIndex.
+ * @param completions  The exact matches.
+ * @return The exact matches, followed by the fuzzy matches not among them, up to the limit.
+ */
+QStringList ContentDatabase::addFuzzyCompletions(QStringList completions, QString fragments, QString language, int limit) const {
+    if (completions.size() >= limit)
+        return completions;
+
+    QSharedPointer<const FuzzyIndex> index = fuzzyIndex();
+    if (index->isEmpty() || index->language() != language.left(2))
+        return completions;
+
+    for (const QString& name : index->search(fragments, limit)) {
+        if (completions.size() >= limit)
+            break;
+        if (!completions.contains(name))
+            completions << name;
+    }
+    return completions;
+}
+
+
+/**
+ * @brief All SQL statements issued by the queries of this class, for checking their query plans.
+ * @details Statements built for a varying number of values are included once, with a typical
+ *   number. Placeholders are named after the value they stand for, see
+ *   DatabaseValidator::checkQueryPlans().
+ */
+QVector<SqlStatement> ContentDatabase::statements() {
+    return QVector<SqlStatement> {
+        {"completions", completionsSql, {"category_names"}},
+        {"topic IDs by barcode", barcodeTopicIdsSql, {}},
+        {"topic IDs by category, indexed name", categoryTopicIdsSql("SELECT :categoryId"), {}},
+        {"topic IDs by category, unindexed name", categoryTopicIdsSql(categoryIdSql), {"category_names"}},
+        {"topics by ID", topicsByIdSql(8), {}},
+        {"product categories", productCategoriesSql, {}},
+        {"product categories, batch", lookupBatchSql(8), {}},
+        {"product top category", topCategorySql, {}},
+        {"barcode range", barcodeRangeSql, {}},
+        {"child categories", categoryChildrenSql(false), {}},
+        {"root categories", categoryChildrenSql(true), {}},
+        {"parent categories", parentCategoriesSql, {}},
+        {"topic count", topicCountSql, {}}
+    };
+}
+
+
+/**
+ * @brief Search the database for category names to complete the given text to.
+ * @details Thread-safe, as it uses the calling thread's database connection.
+ * @param fragments  Space separated parts that must occur in this order as substrings in the results.
+ * @param language  The language of the category names, given as a two-letter language code.
+ * @param limit  Maximum number of results.
+ * @return The category names, shortest first.
+ */
+QStringList ContentDatabase::queryCompletions(QString fragments, QString language, int limit) {
+    QSqlQuery query(connection());
+
+    // Characters with a meaning in LIKE patterns match literally when typed, see completionsSql.
+    QString literal = fragments;
+    literal.replace("\\", "\\\\").replace("%", "\\%").replace("_", "\\_");
+    QString searchTerm = "%" + literal.replace(" ", "%") + "%";
+    QString languageTerm = language + "%";
+
+    query.prepare(completionsSql);
+    query.bindValue(":languageTerm", languageTerm);
+    query.bindValue(":searchTerm", searchTerm);
+    query.bindValue(":limit", limit);
+
+    QStringList completions;
     if(query.exec())
         while (query.next())
-            m_completionModel << query.value(0).toString();
+            completions << query.value(0).toString();
     else
-        qWarning() << "ContentDatabase::search: ERROR: " << query.lastError().text();
+        qWarning() << "ContentDatabase::queryCompletions: ERROR: " << query.lastError().text();
 
-    // Notify QML components and widgets using completionsModel to update their data.
-    completionsChanged();
+    return completions;
+}
+
+
+/**
+ * @brief Complete the start of a barcode number to the barcodes of products. Thread-safe.
+ * @details Uses the content pack or else the barcode index. While neither is available, a range
+ *   query per barcode length is used instead, which is slower but also uses an index.
+ * @param digits  The start of a barcode number, as typed.
+ * @param limit  Maximum number of results.
+ * @return The barcodes, shortest first, and each length in ascending order.
+ */
+QStringList ContentDatabase::completeBarcodes(QString digits, int limit) const {
+    QStringList codes;
+
+    QSharedPointer<const ContentPack> pack = this->pack();
+    if (!pack.isNull()) {
+        for (quint64 code : pack->completeBarcodes(digits, limit))
+            codes << QString::number(code);
+        return codes;
+    }
+
+    QSharedPointer<const BarcodeIndex> index = barcodeIndex();
+    if (!index->isEmpty()) {
+        for (quint64 code : index->complete(digits, limit))
+            codes << QString::number(code);
+        return codes;
+    }
+
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+    for (const QPair<quint64, quint64>& range : BarcodeIndex::prefixRanges(digits)) {
+        const quint64 maxCode = quint64(std::numeric_limits<qint64>::max());
+        if (codes.size() >= limit || range.first > maxCode)
+            break;
+
+        query.prepare(barcodeRangeSql);
+        query.bindValue(":low", qint64(range.first));
+        query.bindValue(":high", qint64(qMin(range.second, maxCode)));
+        query.bindValue(":limit", limit - codes.size());
+        if (!query.exec()) {
+            qWarning() << "ContentDatabase::completeBarcodes: ERROR: " << query.lastError().text();
+            checkForDamage(query.lastError());
+            break;
+        }
+        while (query.next())
+            codes << query.value(0).toString();
+    }
+    return codes;
+}
+
+
+/**
+ * @brief Determine the most specific category of a product, to describe it in a few words.
+ * @details Thread-safe, as it uses the calling thread's database connection.
+ * @param barcode Text as decoded from a product barcode, in normalized format (see normalize()).
+ * @param language The language of the category name, given as a two-letter language code.
+ * @return The category name, or "" if the product is not in the database or has no category with
+ *   a name in the given language.
+ */
+QString ContentDatabase::topCategory(QString barcode, QString language) const {
+    QSharedPointer<const ContentPack> pack = this->pack();
+    if (!pack.isNull())
+        return pack->topCategory(barcode.toULongLong(), language);
+
+    QSqlQuery query(connection());
+    query.prepare(topCategorySql);
+    query.bindValue(":code", barcode.toLongLong());
+    query.bindValue(":lang", language);
+
+    if (!query.exec()) {
+        qWarning() << "ContentDatabase::topCategory: ERROR: " << query.lastError().text();
+        return QString();
+    }
+    return query.next() ? query.value(0).toString() : QString();
 }
 
 
@@ -168,126 +1122,219 @@ void ContentDatabase::updateCompletions(QString fragments, QString language, int
  * @brief Empty the current list of auto-completions.
  */
 void ContentDatabase::clearCompletions() {
-    m_completionModel.clear();
+    m_completionModel->clear();
+    m_candidates.clear();
+    m_candidatesInput.clear();
     // Notify QML components and widgets using completionsModel to update their data.
     completionsChanged();
 }
 
 
 /**
- * @brief Search the database for a barcode and return associated topics in DocBook XML format.
+ * @brief Search the database for a barcode or category and return the associated topics.
+ * @details Thread-safe, as it uses the calling thread's database connection. So it can also be
+ *   called from worker threads, as done by TopicListModel.
+ *
+ *   The results of the last few searches are memoized, because the same topics are needed for
+ *   showing the content and the literature of a search term, and for showing what prefetch()
+ *   prepared. Finding them involves resolving the whole category ancestry.
  * @param searchTerm Text to use as the search term to find associated content topics in the
  *   database. This can be either text as decoded from a product barcode or a category name. The
  *   search term has to be in normalized format (see ContentDatabase::normalize()).
- * @param searchTerm The language that result topics should have, given as a two-letter language
+ * @param language The language that result topics should have, given as a two-letter language
  *   code.
- * @return The content topics resulting from the database search, combined into a single DocBook
- *   XML document. All topic meta-information about the topics (author, content section,
- *   version date, categories etc.) is rendered into the returned document.
+ * @return The topics, in no particular order. Empty if nothing was found.
  */
-QString ContentDatabase::contentAsDocbook(QString searchTerm, QString language) {
+QVector<ContentTopic> ContentDatabase::topics(QString searchTerm, QString language) const {
+    int generation = databaseGeneration.load();
+    {
+        QMutexLocker locker(&m_topicsCacheMutex);
+        for (int i = 0; i < m_topicsCache.size(); i++) {
+            const TopicsCacheEntry& entry = m_topicsCache[i];
+            if (entry.generation == generation && entry.searchTerm == searchTerm && entry.language == language) {
+                m_topicsCache.move(i, 0);
+                return m_topicsCache.first().topics;
+            }
+        }
+    }
+
+    QVector<ContentTopic> topics = queryTopics(searchTerm, language);
+
+    TopicsCacheEntry entry;
+    entry.generation = generation;
+    entry.searchTerm = searchTerm;
+    entry.language = language;
+    entry.topics = topics;
+
+    QMutexLocker locker(&m_topicsCacheMutex);
+    m_topicsCache.prepend(entry);
+    while (m_topicsCache.size() > topicsCacheSize)
+        m_topicsCache.removeLast();
+
+    qint64 bytes = 0;
+    for (const TopicsCacheEntry& cached : m_topicsCache)
+        bytes += memoryUsage(cached.topics);
+    MemoryBudget::instance()->report(m_topicsCacheBudgetId, bytes);
+
+    return topics;
+}
+
+
+/**
+ * @brief Run the database query for topics(), without memoization.
+ */
+QVector<ContentTopic> ContentDatabase::queryTopics(QString searchTerm, QString language) const {
     QRegExp isNumber("[0-9]*");
-    QSqlQuery query;
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+
+    // With a content pack, topics are collected from its arrays instead. See openPack().
+    QSharedPointer<const ContentPack> pack = this->pack();
 
     if (isNumber.exactMatch(searchTerm)) {
+        if (!pack.isNull())
+            return pack->topicsForBarcode(searchTerm.toULongLong(), language);
+
         // Set up the query for a barcode number.
-        //   The query uses a recursive SQLite Common Table Expression (see https://sqlite.org/lang_with.html )
-        //   to collect topics for a product based on both the directly assigned categories and the ancestor
-        //   categories of those.
-        query.prepare(
-            "WITH RECURSIVE all_product_categories (product_id, category_id) AS ( "
-            //   -- Add the product's directly assigned categories to seed the recursion.
-            "    SELECT product_id, category_id "
-            "        FROM product_categories "
-            "            INNER JOIN products ON products.id = product_categories.product_id "
-            "        WHERE products.code = :code "
-            "    UNION ALL "
-            //   -- Recursively add all the product's categories assigned indirectly via ancestry relations.
-            "    SELECT (SELECT id FROM products WHERE code = :code ), category_structure.parent_id "
-            "        FROM all_product_categories "
-            "            INNER JOIN category_structure ON all_product_categories.category_id = category_structure.category_id "
-            ") "
-            "SELECT DISTINCT topic_contents.title, topics.section, topics.version, topic_contents.content "
-            "FROM products "
-            "    INNER JOIN all_product_categories ON products.id = all_product_categories.product_id "
-            "    INNER JOIN category_names ON all_product_categories.category_id = category_names.category_id "
-            "    INNER JOIN topic_categories ON category_names.category_id = topic_categories.category_id "
-            "    INNER JOIN topics ON topic_categories.topic_id = topics.id "
-            "    INNER JOIN topic_contents ON topics.id = topic_contents.topic_id "
-            "WHERE "
-            "    products.code = :code AND "
-            "    topic_contents.lang = :lang"
-        );
+        query.prepare(barcodeTopicIdsSql);
 
         query.bindValue(":code", searchTerm.toLongLong());
         // TODO: Check if the conversion was successful. See: https://doc.qt.io/qt-5/qstring.html#toLongLong
-        query.bindValue(":lang", language);
 
         qDebug() << "ContentDatabase::search: Value bound to: " << searchTerm.toLongLong();
     }
     else {
         // Set up the query for a category name.
-        //   As above, the query uses a recursive CTE (see https://sqlite.org/lang_with.html ). It first builds
-        //   up a table ancestor_categories containing the category in question and all its ancestors, and then
-        //   uses that in the main SELECT at the end to find topics connected to any of these ancestor categories.
-        //
-        //   TODO: It might be possible to build up the ancestor_categories table with just a single column.
-        //
-        //   ######### IMPORTANT ######### IMPORTANT ######### IMPORTANT ######### IMPORTANT ######### IMPORTANT
-        //   TODO: Fill var_1.category_id by searching also for the category's language.
-        //   ######### IMPORTANT ######### IMPORTANT ######### IMPORTANT ######### IMPORTANT ######### IMPORTANT
-        query.prepare(
-            "WITH RECURSIVE "
-            //   -- Defining a reusable 'variable' var_1.category_id, as seen at https://stackoverflow.com/a/56179189
-            "    var_1 (category_id) AS (SELECT category_id FROM category_names WHERE name = :name COLLATE NOCASE LIMIT 1), "
-            "    "
-            "    category_ancestry (category_id, ancestor_category_id) AS ( "
-            //       -- Add the search term category as the root of its ancestry.
-            "        SELECT var_1.category_id, var_1.category_id FROM var_1 "
-            "        UNION ALL "
-            //       -- Recursively add all ancestors of the search term category.
-            "        SELECT category_ancestry.category_id, category_structure.parent_id "
-            "            FROM category_ancestry "
-            "                INNER JOIN category_structure ON category_ancestry.ancestor_category_id = category_structure.category_id "
-            "    ) "
-            "SELECT DISTINCT topic_contents.title, topics.section, topics.version, topic_contents.content "
-            "FROM category_names, var_1 "
-            "    INNER JOIN category_ancestry ON category_ancestry.category_id = category_names.category_id "
-            "    INNER JOIN topic_categories ON category_ancestry.ancestor_category_id = topic_categories.category_id "
-            "    INNER JOIN topics ON topics.id = topic_categories.topic_id "
-            "    INNER JOIN topic_contents ON topic_contents.topic_id = topics.id "
-            "WHERE "
-            "    category_names.category_id = var_1.category_id AND"
-            "    topic_contents.lang = :lang"
-        );
-
-        query.bindValue(":name", searchTerm);
-        query.bindValue(":lang", language);
+        //   The category is resolved in the search term's language. Normally that is done in O(1) via
+        //   the category index of the active language. Only for other languages, or while that index is
+        //   not yet available, the category is looked up in SQL. That requires a table scan because of
+        //   the case-insensitive comparison.
+        QSharedPointer<const CategoryNameIndex> categoryIndex = this->categoryIndex();
+        bool useIndex = !categoryIndex->isEmpty() && categoryIndex->language() == language.left(2);
+
+        QString categoryIdSelect;
+        if (!useIndex)
+            categoryIdSelect = categoryIdSql;
+        else {
+            qint64 categoryId = categoryIndex->categoryId(language, searchTerm);
+            if (categoryId < 0)
+                return QVector<ContentTopic>(); // No category of that name in that language.
+            if (!pack.isNull())
+                return pack->topicsForCategory(categoryId, language);
+            categoryIdSelect = QString("SELECT %1").arg(categoryId);
+        }
+
+        query.prepare(categoryTopicIdsSql(categoryIdSelect));
+
+        if (!useIndex) {
+            query.bindValue(":name", searchTerm);
+            query.bindValue(":languageTerm", language + "%");
+        }
     }
 
-    // Execute the database query.
+    // Phase 1: determine the topics, each once.
     if(!query.exec()) {
         // Return if there is nothing to render.
         qWarning() << "ContentDatabase::search: ERROR: " << query.lastError().text();
-        return "";
+        checkForDamage(query.lastError());
+        return QVector<ContentTopic>();
     }
 
-    // SQLite can't indicate search result size, so checking query.size() here is useless.
+    QVector<qint64> topicIds;
+    while (query.next())
+        topicIds << query.value(0).toLongLong();
+    checkForDamage(query.lastError());
+
+    // Phase 2: read the content of the topics, in the given language.
+    //   SQLite can't indicate search result size, so checking query.size() here is useless.
+    QVector<ContentTopic> topics;
+    for (int first = 0; first < topicIds.size(); first += topicsPerStatement) {
+        int count = qMin(topicsPerStatement, topicIds.size() - first);
+        query.prepare(topicsByIdSql(count));
+        for (int i = 0; i < count; i++)
+            query.bindValue(QString(":id%1").arg(i), topicIds[first + i]);
+        query.bindValue(":lang", language);
+
+        if (!query.exec()) {
+            qWarning() << "ContentDatabase::search: ERROR: " << query.lastError().text();
+            checkForDamage(query.lastError());
+            return QVector<ContentTopic>();
+        }
+        while (query.next()) {
+            ContentTopic topic;
+            topic.id = query.value(0).toLongLong();
+            topic.title = query.value(1).toString();
+            topic.section = query.value(2).toString();
+            topic.version = query.value(3).toString();
+            topic.content = query.value(4).toString();
+            topics << topic;
+        }
+        checkForDamage(query.lastError());
+    }
+
+    return topics;
+}
+
+
+/**
+ * @brief Search the database for a barcode and return associated topics in DocBook XML format.
+ * @param searchTerm Text to use as the search term to find associated content topics in the
+ *   database. This can be either text as decoded from a product barcode or a category name. The
+ *   search term has to be in normalized format (see ContentDatabase::normalize()).
+ * @param searchTerm The language that result topics should have, given as a two-letter language
+ *   code.
+ * @return The content topics resulting from the database search, combined into a single DocBook
+ *   XML document. All topic meta-information about the topics (author, content section,
+ *   version date, categories etc.) is rendered into the returned document.
+ */
+QString ContentDatabase::contentAsDocbook(QString searchTerm, QString language) {
+    return topicsAsDocbook(topics(searchTerm, language));
+}
+
+
+/**
+ * @brief Determine the display position of a content section.
+ * @return The position, where lower values come first. Unknown sections come last.
+ */
+int ContentDatabase::sectionPriority(QString section) {
+    const int sectionCount = sizeof(sectionOrder) / sizeof(sectionOrder[0]);
+    for (int i = 0; i < sectionCount; i++)
+        if (section == QLatin1String(sectionOrder[i]))
+            return i;
+    return sectionCount;
+}
+
 
-    // Render the search results into a simple DocBook "book" document.
-    //   TODO: Also render the OFF category names into here, in the correct language. Their IDs are
-    //   already available via query.value(4)
+/**
+ * @brief Sort topics into display order: by the section order of the stylesheet, and within a
+ *   section by title, so that the order is independent of the database query plan.
+ */
+void ContentDatabase::sortTopics(QVector<ContentTopic>& topics) {
+    std::stable_sort(topics.begin(), topics.end(), [](const ContentTopic& a, const ContentTopic& b) {
+        int priorityA = sectionPriority(a.section);
+        int priorityB = sectionPriority(b.section);
+        return priorityA != priorityB ? priorityA < priorityB : a.title < b.title;
+    });
+}
+
+
+/**
+ * @brief Combine topics into a simple DocBook "book" document.
+ * @return The DocBook XML document, or "" if there are no topics.
+ */
+QString ContentDatabase::topicsAsDocbook(const QVector<ContentTopic>& topics) {
+    //   TODO: Also render the OFF category names into here, in the correct language.
     //   TODO: Also render the author names into here.
     //   TODO: Exchange this with a more readable single HTML string with %1, %2 etc. arguments.
     QString docbook;
-    while (query.next()) {
+    for (const ContentTopic& topic : topics) {
         docbook
-            .append("<topic type=\"").append(query.value(1).toString()).append("\">\n")
+            .append("<topic type=\"").append(topic.section).append("\">\n")
             .append("<info>\n")
-            .append("<title>").append(query.value(0).toString()).append("</title>\n")
-            .append("<edition><date>").append(query.value(2).toString()).append("</date></edition>")
+            .append("<title>").append(topic.title).append("</title>\n")
+            .append("<edition><date>").append(topic.version).append("</date></edition>")
             .append("</info>\n")
-            .append(query.value(3).toString()) // Main content.
+            .append(topic.content) // Main content.
             .append("</topic>\n\n");
     }
     if (docbook.isEmpty())
@@ -312,16 +1359,51 @@ QString ContentDatabase::contentAsDocbook(QString searchTerm, QString language)
  */
 QString ContentDatabase::content(QString searchTerm, QString language, ContentFormat format) {
 
-    // Get the raw database search results.
-    QString docbook = contentAsDocbook(searchTerm, language);
-
     // Deal with the simple cases first.
     if (format == ContentFormat::DOCBOOK)
-        return docbook;
-    else if (docbook.isEmpty())
+        return contentAsDocbook(searchTerm, language);
+
+    // Pages rendered before from the same database are taken from the disk cache.
+    QString diskKey = diskCacheKey(QString("page|%1|%2|%3").arg(databaseFingerprint(), language, searchTerm));
+    QString html = m_diskCache.lookup(diskKey);
+    if (!html.isNull())
+        return html;
+
+    QVector<ContentTopic> topics = this->topics(searchTerm, language);
+    if (topics.isEmpty())
         return "";
 
     // Deal with the remaining case: converting the content to HTML format.
+    sortTopics(topics);
+    html = renderTopicsHtml(topics);
+    m_diskCache.store(diskKey, html);
+
+//    qDebug().noquote()
+//        << "\nContentDatabase::content(QString, ContentFormat): Content in DocBook format:\n\n"
+//        << formatXml(docbook);
+//    qDebug().noquote()
+//        << "\nContentDatabase::content(QString, ContentFormat): Content in HTML format:\n\n"
+//        << formatXml(html);
+
+    // The current locale is accessible as the global default locale by creating a QLocale object
+    // without arguments. See: https://doc.qt.io/qt-5/qlocale.html#setDefault
+    qDebug().noquote()
+        << "Current language: " << QLocale::languageToString(QLocale().language());
+    qDebug().noquote()
+        << "Current locale: " << QLocale().name();
+
+    return html;
+}
+
+
+/**
+ * @brief Convert DocBook content to Qt's rich text HTML subset, using qrc:/docbook-to-qthtml.xsl.
+ * @details Thread-safe, so topics can also be rendered on worker threads (see TopicListModel).
+ * @param docbook  A DocBook document as created by topicsAsDocbook().
+ * @param sectionHeaders  If to render the header of each content section. Set to false when
+ *   rendering a topic that is shown after another one of the same section.
+ */
+QString ContentDatabase::renderHtml(QString docbook, bool sectionHeaders) {
     QString html;
     QXmlQuery query(QXmlQuery::XSLT20);
     query.bindVariable("symptoms-title", QVariant(QObject::tr("Symptoms and causes")));
@@ -343,40 +1425,484 @@ QString ContentDatabase::content(QString searchTerm, QString language, ContentFo
     query.bindVariable("reuse-and-recycling-title", QVariant(QObject::tr("Reuse and recycling ideas")));
     query.bindVariable("production-waste-title", QVariant(QObject::tr("Production waste")));
     query.bindVariable("packaging-waste-title", QVariant(QObject::tr("Packaging waste")));
+    query.bindVariable("section-header", QVariant(QString(sectionHeaders ? "yes" : "no")));
     query.setFocus(docbook);
     query.setQuery(QUrl("qrc:/docbook-to-qthtml.xsl"));
     if (!query.isValid()) {
-        qDebug() << "ContentDatabase::content(QString, ContentFormat): ERROR: "
+        qDebug() << "ContentDatabase::renderHtml: ERROR: "
             << "could not load query from qrc:/docbook-to-qthtml.xsl.";
     }
     query.evaluateTo(&html);
 
-//    qDebug().noquote()
-//        << "\nContentDatabase::content(QString, ContentFormat): Content in DocBook format:\n\n"
-//        << formatXml(docbook);
-//    qDebug().noquote()
-//        << "\nContentDatabase::content(QString, ContentFormat): Content in HTML format:\n\n"
-//        << formatXml(html);
+    return html;
+}
 
-    // The current locale is accessible as the global default locale by creating a QLocale object
-    // without arguments. See: https://doc.qt.io/qt-5/qlocale.html#setDefault
-    qDebug().noquote()
-        << "Current language: " << QLocale::languageToString(QLocale().language());
-    qDebug().noquote()
-        << "Current locale: " << QLocale().name();
+
+/**
+ * @brief Convert topics to one Qt rich text HTML document, rendering each topic in parallel.
+ * @details Topics are independent of each other, so each one is transformed on its own on the
+ *   global thread pool, and the bodies of the results are concatenated in the order of the given
+ *   topics, under the head of the first one. The result is the same as rendering all topics in one
+ *   transform, but a result with many topics is rendered in a fraction of the time on multi-core
+ *   devices.
+ * @param topics  The topics to render, in display order (see sortTopics()).
+ * @return The HTML document, or "" if there are no topics.
+ */
+QString ContentDatabase::renderTopicsHtml(const QVector<ContentTopic>& topics) {
+    if (topics.size() <= 1)
+        return topics.isEmpty() ? "" : renderHtml(topicsAsDocbook(topics));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<QFuture<QString>> documents;
+    for (int i = 0; i < topics.size(); i++) {
+        QVector<ContentTopic> topic(1, topics[i]);
+        bool sectionHeader = i == 0 || topics[i].section != topics[i - 1].section;
+        documents << QtConcurrent::run([topic, sectionHeader]() {
+            return renderHtml(topicsAsDocbook(topic), sectionHeader);
+        });
+    }
+
+    // Waiting for a result runs the task in the current thread if it has not been started yet, so
+    // this also works when called on a thread of the global pool.
+    QString html;
+    QString tail;
+    for (QFuture<QString>& future : documents) {
+        QString document = future.result();
+        int bodyStart = document.indexOf('>', document.indexOf("<body")) + 1;
+        int bodyEnd = document.lastIndexOf("</body>");
+        if (bodyStart <= 0 || bodyEnd < bodyStart) {
+            qWarning() << "ContentDatabase::renderTopicsHtml: ERROR: Rendered topic has no body.";
+            continue;
+        }
+
+        if (html.isEmpty()) {
+            html = document.left(bodyStart);
+            tail = document.mid(bodyEnd);
+        }
+        html.append(document.midRef(bodyStart, bodyEnd - bodyStart));
+    }
+
+    qDebug() << "ContentDatabase::renderTopicsHtml: Rendered" << topics.size() << "topics in"
+             << timer.elapsed() << "ms.";
+    return html.isEmpty() ? "" : html + tail;
+}
+
+
+/**
+ * @brief Render a single topic to Qt rich text HTML, or provide it from the caches of rendered
+ *   topics, in memory and on disk.
+ * @details Thread-safe. Used by TopicListModel to render the topics it shows, and by prefetch() to
+ *   render them before they are shown.
+ * @param topic  The topic to render.
+ * @param sectionHeader  If to render the header of the topic's content section.
+ */
+QString ContentDatabase::renderTopic(const ContentTopic& topic, bool sectionHeader) const {
+    QString key = QString("%1|%2|%3").arg(databaseGeneration.load()).arg(topic.id).arg(sectionHeader);
+    {
+        QMutexLocker locker(&m_renderCacheMutex);
+        if (QString* html = m_renderCache.object(key))
+            return *html;
+    }
+
+    // On disk, topics are identified by their content. So a database update keeps the rendered
+    //   topics it did not change.
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const QString& field : {QString::number(topic.id), topic.title, topic.section, topic.version, topic.content}) {
+        hash.addData(field.toUtf8());
+        hash.addData("\0", 1);
+    }
+    QString diskKey = diskCacheKey(
+        QString("topic|%1|%2").arg(sectionHeader).arg(QString::fromLatin1(hash.result().toHex())));
+
+    QString html = m_diskCache.lookup(diskKey);
+    if (html.isNull()) {
+        html = renderHtml(topicsAsDocbook(QVector<ContentTopic>(1, topic)), sectionHeader);
+        m_diskCache.store(diskKey, html);
+    }
+
+    QMutexLocker locker(&m_renderCacheMutex);
+    m_renderCache.insert(key, new QString(html), html.size() * 2);
+    MemoryBudget::instance()->report(m_renderCacheBudgetId, m_renderCache.totalCost());
 
     return html;
 }
 
 
 /**
- * @brief Search the database for a barcode and return bibliography items associated with any
- *   topic related to this barcode.
- * @param barcode Text as decoded from a barcode.
- * @return TODO
+ * @brief The key of rendered HTML in the disk cache.
+ * @details Besides on what was rendered, the HTML depends on the stylesheet and on the user
+ *   interface language, which section titles are translated to.
+ * @param item  Identifies what was rendered, including the database content it was rendered from.
+ */
+QString ContentDatabase::diskCacheKey(QString item) const {
+    // Identifies the stylesheet's content, so rendered HTML is not reused after changing it.
+    static const QString stylesheetVersion = []() {
+        QFile file(":/docbook-to-qthtml.xsl");
+        file.open(QIODevice::ReadOnly);
+        return QString::fromLatin1(QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha1).toHex());
+    }();
+
+    return QString("%1|%2|%3").arg(stylesheetVersion, QLocale().name(), item);
+}
+
+
+/**
+ * @brief The fingerprint of the database in use, in hex. See DatabaseValidator::fingerprint().
+ * @details Determined when connecting to or switching the database, so this does not read the file.
+ */
+QString ContentDatabase::databaseFingerprint() const {
+    QMutexLocker locker(&m_renderCacheMutex);
+    return QString::fromLatin1(m_databaseFingerprint.toHex());
+}
+
+
+/**
+ * @brief The key of a snapshot of the topics shown for a search, see TopicListModel.
+ * @details Like the pages in the disk cache, a snapshot depends on the database content, the
+ *   stylesheet and the user interface language, so it is only shown again while these are the same.
+ */
+QString ContentDatabase::snapshotKey(QString searchTerm, QString language) const {
+    return diskCacheKey(QString("snapshot|%1|%2|%3").arg(databaseFingerprint(), language, searchTerm));
+}
+
+
+/**
+ * @brief Prepare the content of likely next searches in the background, so it shows without delay.
+ * @details Used with the completion the user has highlighted and with the top completion. The topics
+ *   of each search term are fetched into the cache of topics(), and the topics shown first are
+ *   rendered into the cache of renderTopic(). This runs on a single low priority thread, so it only
+ *   uses otherwise idle time. Every call cancels the prefetching requested by the previous one, as
+ *   the hints have changed.
+ * @param searchTerms  The search terms, most likely first, in normalized format (see normalize()).
+ *   Empty search terms are ignored.
+ * @param language  The language of the content, given as a two-letter language code.
  */
-QString ContentDatabase::literature(QString searchTerm) {
-    // TODO: Implementation. Probably the return type has to be changed to a two-dimensional
-    // array ("table" / "hash").
-    return searchTerm; // Dummy, just to avoid the warnings.
+void ContentDatabase::prefetch(QStringList searchTerms, QString language) {
+    int generation = m_prefetchGeneration.fetchAndAddOrdered(1) + 1;
+    m_prefetchPool.clear();
+
+    searchTerms.removeAll("");
+    searchTerms.removeDuplicates();
+    if (searchTerms.isEmpty())
+        return;
+
+    QtConcurrent::run(&m_prefetchPool, [this, searchTerms, language, generation]() {
+        QThread::currentThread()->setPriority(QThread::LowestPriority);
+        auto cancelled = [this, generation]() { return m_prefetchGeneration.load() != generation; };
+
+        for (const QString& searchTerm : searchTerms) {
+            if (cancelled())
+                return;
+            QVector<ContentTopic> topics = this->topics(searchTerm, language);
+            sortTopics(topics);
+
+            // Same section header use as in TopicListModel, so that the cached renderings are used.
+            for (int i = 0; i < qMin(topics.size(), prefetchedTopics); i++) {
+                if (cancelled())
+                    return;
+                renderTopic(topics[i], i == 0 || topics[i].section != topics[i - 1].section);
+            }
+        }
+        qDebug() << "ContentDatabase::prefetch: Prefetched" << searchTerms;
+    });
+}
+
+
+/**
+ * @brief Determine the names of the categories directly assigned to a product.
+ * @param barcode Text as decoded from a product barcode, in normalized format (see
+ *   ContentDatabase::normalize()).
+ * @param language The language of the category names, given as a two-letter language code.
+ * @return The category names. Empty if the product is not in the database or has no categories
+ *   with a name in the given language.
+ */
+QStringList ContentDatabase::productCategories(QString barcode, QString language) {
+    QSharedPointer<const ContentPack> pack = this->pack();
+    if (!pack.isNull())
+        return pack->productCategories(barcode.toULongLong(), language);
+
+    QSqlQuery query(connection());
+    query.prepare(productCategoriesSql);
+    query.bindValue(":code", barcode.toLongLong());
+    query.bindValue(":lang", language);
+
+    QStringList categories;
+    if (query.exec())
+        while (query.next())
+            categories << query.value(0).toString();
+    else
+        qWarning() << "ContentDatabase::productCategories: ERROR: " << query.lastError().text();
+    checkForDamage(query.lastError());
+
+    return categories;
+}
+
+
+/**
+ * @brief Determine the category names of many products with a single query.
+ * @details Used for the barcodes found by continuous scanning, which arrive in batches, and for the
+ *   lookup requests of QueryServer. One query for the whole batch avoids the per-query overhead of
+ *   calling productCategories() per barcode. Thread-safe, as it uses the calling thread's database
+ *   connection.
+ * @param barcodes Texts as decoded from product barcodes, in normalized format (see normalize()).
+ * @param language The language of the category names, given as a two-letter language code.
+ * @return One map per barcode, in the given order, with keys "barcode" (the barcode as given) and
+ *   "categories" (a list of the names of the categories directly assigned to the product; empty
+ *   if the product is not in the database).
+ */
+QVariantList ContentDatabase::lookupBatch(QStringList barcodes, QString language) {
+    QHash<qint64, QStringList> categories;
+    QSharedPointer<const ContentPack> pack = this->pack();
+
+    if (!pack.isNull()) {
+        for (const QString& barcode : barcodes)
+            categories[barcode.toLongLong()] = pack->productCategories(barcode.toULongLong(), language);
+    }
+    else {
+        QSqlQuery query(connection());
+        query.setForwardOnly(true);
+        for (int first = 0; first < barcodes.size(); first += productsPerStatement) {
+            int count = qMin(productsPerStatement, barcodes.size() - first);
+            query.prepare(lookupBatchSql(count));
+            for (int i = 0; i < count; i++)
+                query.bindValue(QString(":code%1").arg(i), barcodes[first + i].toLongLong());
+            query.bindValue(":lang", language);
+
+            if (!query.exec()) {
+                qWarning() << "ContentDatabase::lookupBatch: ERROR: " << query.lastError().text();
+                checkForDamage(query.lastError());
+                break;
+            }
+            while (query.next())
+                categories[query.value(0).toLongLong()] << query.value(1).toString();
+        }
+    }
+
+    QVariantList results;
+    for (const QString& barcode : barcodes) {
+        QVariantMap result;
+        result["barcode"] = barcode;
+        result["categories"] = categories.value(barcode.toLongLong());
+        results << result;
+    }
+    return results;
+}
+
+
+/**
+ * @brief Read one page of the child categories of a category, sorted by name, for browsing the
+ *   category hierarchy.
+ * @details Thread-safe, as it uses the calling thread's database connection. So it can also be
+ *   called from worker threads, as done by CategoryBrowserModel. Pages are found by the last
+ *   category of the previous page rather than by their position, so later pages are no slower
+ *   than the first one. See categoryChildrenSql() for the cost of a page.
+ * @param parentId  The category to read the children of, or -1 to read the categories without a parent.
+ * @param language  The language of the category names, given as a two-letter language code.
+ * @param after  The last category of the previous page, or a default constructed CategoryEntry
+ *   for the first page.
+ * @param limit  Maximum number of categories in the page.
+ * @return The categories. Fewer than limit if this is the last page.
+ */
+QVector<CategoryEntry> ContentDatabase::categoryChildren(
+    qint64 parentId, QString language, const CategoryEntry& after, int limit) const {
+
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+    query.prepare(categoryChildrenSql(parentId < 0));
+    if (parentId >= 0)
+        query.bindValue(":parentId", parentId);
+    query.bindValue(":lang", language);
+    // Not null, as that would not compare with any name.
+    query.bindValue(":afterName", after.name.isNull() ? QString("") : after.name);
+    query.bindValue(":afterId", after.id);
+    query.bindValue(":limit", limit);
+
+    QVector<CategoryEntry> categories;
+    if (query.exec()) {
+        while (query.next()) {
+            CategoryEntry category;
+            category.id = query.value(0).toLongLong();
+            category.name = query.value(1).toString();
+            category.childCount = query.value(2).toInt();
+            category.topicCount = query.value(3).toInt();
+            categories << category;
+        }
+    }
+    else
+        qWarning() << "ContentDatabase::categoryChildren: ERROR: " << query.lastError().text();
+    checkForDamage(query.lastError());
+
+    return categories;
+}
+
+
+/**
+ * @brief Determine the parent categories of a category, for navigating up while browsing.
+ * @details Thread-safe, as it uses the calling thread's database connection.
+ * @param categoryId  The category's ID, as in CategoryEntry::id.
+ * @param language  The language of the category names, given as a two-letter language code.
+ * @return One map per parent category with a name in the given language, sorted by name, with keys
+ *   "id" and "name". Empty for categories without a parent. A category can have multiple parents.
+ */
+QVariantList ContentDatabase::parentCategories(qint64 categoryId, QString language) const {
+    QSqlQuery query(connection());
+    query.prepare(parentCategoriesSql);
+    query.bindValue(":categoryId", categoryId);
+    query.bindValue(":lang", language);
+
+    QVariantList parents;
+    if (query.exec()) {
+        while (query.next()) {
+            QVariantMap parent;
+            parent["id"] = query.value(0);
+            parent["name"] = query.value(1);
+            parents << parent;
+        }
+    }
+    else
+        qWarning() << "ContentDatabase::parentCategories: ERROR: " << query.lastError().text();
+    checkForDamage(query.lastError());
+
+    return parents;
+}
+
+
+/**
+ * @brief Determine the number of topics directly assigned to a category.
+ * @details Thread-safe, as it uses the calling thread's database connection. Topics of the
+ *   category's ancestors, which are shown for it as well, are not counted.
+ * @param categoryId  The category's ID, as in CategoryEntry::id.
+ * @return The number of topics, or 0 if the query failed.
+ */
+int ContentDatabase::topicCount(qint64 categoryId) const {
+    QSqlQuery query(connection());
+    query.prepare(topicCountSql);
+    query.bindValue(":categoryId", categoryId);
+
+    if (!query.exec()) {
+        qWarning() << "ContentDatabase::topicCount: ERROR: " << query.lastError().text();
+        checkForDamage(query.lastError());
+        return 0;
+    }
+    return query.next() ? query.value(0).toInt() : 0;
+}
+
+
+/**
+ * @brief Search the database for a barcode or category and return the bibliography items cited by
+ *   any of the topics related to it.
+ * @details The items are taken from the DocBook bibliography entries ("biblioentry" and
+ *   "bibliomixed" elements) in the topics' content. So they are fetched together with the topics,
+ *   without a query per topic. As topics() memoizes its results for the last searches, requesting the
+ *   content and then the literature for the same search term runs the topic query only once.
+ * @param searchTerm A barcode or category name, in normalized format (see ContentDatabase::normalize()).
+ * @param language The language of the topics, given as a two-letter language code.
+ * @return One map per bibliography item, with the keys "author", "title", "year" and "url". Values
+ *   not given in the bibliography entry are empty. Items cited by multiple topics are included once.
+ */
+QVariantList ContentDatabase::literature(QString searchTerm, QString language) {
+    QVariantList items;
+    QSet<QString> seen;
+
+    for (const ContentTopic& topic : topics(searchTerm, language)) {
+        for (const QVariant& item : bibliography(topic.content)) {
+            QVariantMap map = item.toMap();
+            QString key = QStringList({
+                map["author"].toString(), map["title"].toString(), map["year"].toString(), map["url"].toString()
+            }).join(QChar(0x1F));
+
+            if (!seen.contains(key)) {
+                seen.insert(key);
+                items << item;
+            }
+        }
+    }
+
+    return items;
+}
+
+
+/**
+ * @brief Extract the bibliography entries from DocBook content.
+ * @details Element names are matched without namespace, so DocBook 4 and 5 content both work.
+ * @param content DocBook content of a topic, possibly with multiple top-level elements.
+ * @return The bibliography items as maps, in document order. See literature().
+ */
+QVariantList ContentDatabase::bibliography(const QString& content) {
+    QVariantList items;
+    if (!content.contains("biblio"))
+        return items;
+
+    // Wrap the content so that it is a well-formed document with the namespaces used in topics.
+    QXmlStreamReader xml(
+        "<topic xmlns=\"http://docbook.org/ns/docbook\" xmlns:xl=\"http://www.w3.org/1999/xlink\">"
+        + content + "</topic>"
+    );
+    QRegularExpression yearPattern("\\b(1[5-9]|20)[0-9]{2}\\b");
+
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (!xml.isStartElement() || (xml.name() != "biblioentry" && xml.name() != "bibliomixed"))
+            continue;
+
+        QStringList authors;
+        QString title, year, url, text;
+        QString entryName = xml.name().toString();
+
+        // Read up to the end of the entry, collecting the fields of interest.
+        while (!xml.atEnd() && !(xml.isEndElement() && xml.name() == entryName)) {
+            xml.readNext();
+            if (xml.isCharacters())
+                text += xml.text();
+            if (!xml.isStartElement())
+                continue;
+
+            QStringRef name = xml.name();
+            QString href = xml.attributes().value("http://www.w3.org/1999/xlink", "href").toString();
+            if (url.isEmpty() && !href.isEmpty())
+                url = href;
+
+            // An author's "personname" is read as part of its "author" element, so it is not seen here.
+            if (name == "author" || name == "editor" || name == "personname" || name == "orgname") {
+                QString author = xml.readElementText(QXmlStreamReader::IncludeChildElements).simplified();
+                text += author;
+                if (!author.isEmpty())
+                    authors << author;
+            }
+            else if (name == "title" && title.isEmpty()) {
+                title = xml.readElementText(QXmlStreamReader::IncludeChildElements).simplified();
+                text += title;
+            }
+            else if ((name == "pubdate" || name == "date" || name == "year") && year.isEmpty()) {
+                QString date = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+                text += date;
+                year = yearPattern.match(date).captured(0);
+            }
+            else if ((name == "uri" || (name == "biblioid" && xml.attributes().value("class") == "uri"))
+                     && url.isEmpty()) {
+                url = xml.readElementText(QXmlStreamReader::IncludeChildElements).trimmed();
+                text += url;
+            }
+        }
+
+        // Unstructured entries have their whole text as the title.
+        if (title.isEmpty())
+            title = text.simplified();
+        if (year.isEmpty())
+            year = yearPattern.match(text).captured(0);
+
+        QVariantMap item;
+        item["author"] = authors.join("; ");
+        item["title"] = title;
+        item["year"] = year;
+        item["url"] = url;
+        items << item;
+    }
+
+    if (xml.hasError())
+        qWarning() << "ContentDatabase::bibliography: ERROR: " << xml.errorString();
+
+    return items;
 }
@@ -6,22 +6,165 @@
 #include <QSqlQuery>
 
 #include <QString>
+#include <QVector>
+#include <QStringList>
+#include <QVariantList>
 #include <QObject>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QCache>
+#include <QThreadPool>
+#include <QAtomicInt>
+
+#include "CategoryNameIndex.h"
+#include "FuzzyIndex.h"
+#include "BarcodeIndex.h"
+#include "CompletionModel.h"
+#include "DatabaseValidator.h"
+#include "RenderCache.h"
 
 enum ContentFormat {DOCBOOK, HTML};
 
+/**
+ * @brief One content topic, as stored in the database in one language.
+ */
+struct ContentTopic {
+    qint64 id = 0;
+    QString title;
+    QString section;  // Content section short name, such as "pantry_storage".
+    QString version;  // Date of the last change.
+    QString content;  // Main content, in DocBook XML format.
+};
+
+/**
+ * @brief One category in the category hierarchy, as shown when browsing it in one language.
+ */
+struct CategoryEntry {
+    qint64 id = -1;
+    QString name;
+    int childCount = 0;  // Number of direct child categories.
+    int topicCount = 0;  // Number of topics directly assigned to the category.
+};
+
+/**
+ * @brief One SQL statement issued by ContentDatabase, for checking its query plan.
+ */
+struct SqlStatement {
+    QString name;
+    QString sql;
+    QStringList scannedTables; // Tables scanned by design. The statement's time budget grows with their size.
+};
+
+class ContentPack;
+
 class ContentDatabase : public QObject {
 
    Q_OBJECT
-   Q_PROPERTY(QStringList completionModel MEMBER m_completionModel NOTIFY completionsChanged)
+   Q_PROPERTY(CompletionModel* completionModel READ completionModel CONSTANT)
+   Q_PROPERTY(QString damage READ damage NOTIFY damageChanged)
+
+   CompletionModel* m_completionModel;
+
+   // Checks of the database file, and the problem found by them. See connect().
+   DatabaseValidator* m_validator;
+   QString m_damage;
+
+   void reportDamage(QString databaseFile, QString problem);
+   void checkForDamage(const QSqlError& error) const;
+
+   // Completion candidates of the last database search, for refining them while the user types.
+   QString m_candidatesInput;
+   QString m_candidatesLanguage;
+   QStringList m_candidates;
+   bool m_candidatesComplete;
+
+   // Language data. Replaced as a whole when switching the language, see setLanguage(). Written
+   // under m_languageDataMutex, as memory budget evictors also clear it.
+   QString m_language;
+   QString m_pendingLanguage;
+   QSharedPointer<const CategoryNameIndex> m_categoryIndex;
+   QSharedPointer<const FuzzyIndex> m_fuzzyIndex;
+   mutable QMutex m_languageDataMutex;
+
+   QSharedPointer<const CategoryNameIndex> categoryIndex() const;
+   QSharedPointer<const FuzzyIndex> fuzzyIndex() const;
+
+   // Barcodes of all products, for completing barcode numbers. Replaced as a whole when switching
+   // the database, see buildBarcodeIndex().
+   QSharedPointer<const BarcodeIndex> m_barcodeIndex;
+   mutable QMutex m_barcodeIndexMutex;
 
-   QStringList m_completionModel;
+   QSharedPointer<const BarcodeIndex> barcodeIndex() const;
+   void buildBarcodeIndex();
+
+   // Compiled form of the database in use, if one was made for it. Replaced as a whole when
+   // switching the database, see openPack().
+   QSharedPointer<const ContentPack> m_pack;
+   mutable QMutex m_packMutex;
+
+   QSharedPointer<const ContentPack> pack() const;
+   void openPack();
+
+   QStringList addFuzzyCompletions(QStringList completions, QString fragments, QString language, int limit) const;
+
+   // The topics found by the last calls of topics(), with the arguments they were found for.
+   struct TopicsCacheEntry {
+       int generation = -1;
+       QString searchTerm;
+       QString language;
+       QVector<ContentTopic> topics;
+   };
+   mutable QList<TopicsCacheEntry> m_topicsCache; // Most recently used first.
+   mutable QMutex m_topicsCacheMutex;
+
+   // Topics rendered by renderTopic(), keyed by database generation, topic ID and section header use.
+   mutable QCache<QString, QString> m_renderCache;
+   mutable QMutex m_renderCacheMutex;
+
+   // Rendered topics and pages on disk, kept across restarts. See renderTopic() and content().
+   mutable RenderCache m_diskCache;
+   QByteArray m_databaseFingerprint; // Of the database in use, see DatabaseValidator::fingerprint(). Guarded by m_renderCacheMutex.
+
+   QString diskCacheKey(QString item) const;
+   QString databaseFingerprint() const;
+
+   // Runs the prefetching requested by prefetch(), one search term at a time.
+   QThreadPool m_prefetchPool;
+   QAtomicInt m_prefetchGeneration;
+
+   // Registrations with MemoryBudget, see registerCaches().
+   int m_categoryIndexBudgetId;
+   int m_fuzzyIndexBudgetId;
+   int m_topicsCacheBudgetId;
+   int m_renderCacheBudgetId;
+   int m_barcodeIndexBudgetId;
+
+   void registerCaches();
+
+   QVector<ContentTopic> queryTopics(QString searchTerm, QString language) const;
+
+   static QVariantList bibliography(const QString& content);
 
 public:
     explicit ContentDatabase (QObject* parent = 0);
 
+    ~ContentDatabase();
+
     void connect();
 
+    CompletionModel* completionModel() const;
+
+    QString damage() const;
+
+    static QSqlDatabase connection();
+
+    static QString databaseFile();
+
+    void switchDatabase(QString databaseFile);
+
+    Q_INVOKABLE
+    void setLanguage(QString language);
+
     Q_INVOKABLE // Allows to invoke this method from QML.
     QString normalize(QString searchTerm);
 
@@ -31,13 +174,58 @@ public:
     Q_INVOKABLE
     void clearCompletions();
 
+    static QVector<SqlStatement> statements();
+
+    static QStringList queryCompletions(QString fragments, QString language, int limit);
+
+    QStringList completeBarcodes(QString digits, int limit) const;
+
+    QString topCategory(QString barcode, QString language) const;
+
+    QVector<ContentTopic> topics(QString searchTerm, QString language) const;
+
+    static int sectionPriority(QString section);
+
+    static void sortTopics(QVector<ContentTopic>& topics);
+
+    static QString topicsAsDocbook(const QVector<ContentTopic>& topics);
+
+    static QString renderHtml(QString docbook, bool sectionHeaders = true);
+
+    static QString renderTopicsHtml(const QVector<ContentTopic>& topics);
+
+    QString renderTopic(const ContentTopic& topic, bool sectionHeader) const;
+
+    QString snapshotKey(QString searchTerm, QString language) const;
+
+    Q_INVOKABLE
+    void prefetch(QStringList searchTerms, QString language);
+
     QString contentAsDocbook(QString searchTerm, QString language);
 
     Q_INVOKABLE
     QString content(QString searchTerm, QString language, ContentFormat format = ContentFormat::HTML);
 
-    QString literature(QString searchTerm);
+    Q_INVOKABLE
+    QStringList productCategories(QString barcode, QString language);
+
+    Q_INVOKABLE
+    QVariantList lookupBatch(QStringList barcodes, QString language);
+
+    QVector<CategoryEntry> categoryChildren(qint64 parentId, QString language, const CategoryEntry& after, int limit) const;
+
+    Q_INVOKABLE
+    QVariantList parentCategories(qint64 categoryId, QString language) const;
+
+    Q_INVOKABLE
+    int topicCount(qint64 categoryId) const;
+
+    Q_INVOKABLE
+    QVariantList literature(QString searchTerm, QString language);
 
 signals:
     void completionsChanged();
+    void languageDataChanged(QString language);
+    void contentChanged();
+    void damageChanged();
 };
@@ -0,0 +1,752 @@
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QHash>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "ContentPack.h"
+#include "BarcodeIndex.h"
+#include "ContentUpdater.h"
+
+
+// File format identification. The format number changes with every incompatible change.
+static const char packMagic[8] = {'F', 'R', 'P', 'A', 'C', 'K', '\r', '\n'};
+static const quint32 packFormat = 1;
+
+// Offset of absent strings in a StringRef, such as a topic without content in a language.
+static const quint32 noString = 0xFFFFFFFF;
+
+// Language codes are stored zero-padded to this many bytes.
+static const int languageCodeSize = 8;
+
+// Sections of a content pack, identified by these numbers in the section table.
+enum PackSection : quint32 {
+    productCodesSection = 1,
+    productCategoryOffsetsSection,
+    productCategoriesSection,
+    categoryIdsSection,
+    categoryParentOffsetsSection,
+    categoryParentsSection,
+    categoryTopicOffsetsSection,
+    categoryTopicsSection,
+    topicIdsSection,
+    topicMetaSection,
+    languagesSection,
+    categoryNamesSection,
+    topicTextsSection,
+    stringsSection
+};
+
+// Start of a content pack file. Followed by the section table, and that by the sections.
+struct PackHeader {
+    char magic[8];
+    quint32 format;
+    qint32 userVersion;     // user_version of the database the pack was made from.
+    quint32 sectionCount;
+    quint32 reserved;
+};
+
+// One entry of the section table. All sections start at multiples of 8 bytes.
+struct PackSectionEntry {
+    quint32 id;
+    quint32 elementSize;
+    quint64 offset;
+    quint64 count;          // Number of elements.
+};
+
+static_assert(sizeof(PackHeader) == 24 && sizeof(PackSectionEntry) == 24, "Unexpected padding in content pack structures.");
+
+
+/** @brief The given offset, rounded up to the next multiple of 8. */
+static quint64 aligned(quint64 offset) {
+    return (offset + 7) & ~quint64(7);
+}
+
+
+/** @brief The bytes of a vector's elements, without copying them. The vector must outlive the result. */
+template <typename T> static QByteArray rawBytes(const QVector<T>& values) {
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(values.constData()), values.size() * int(sizeof(T)));
+}
+
+
+/**
+ * @brief Group (node, target) pairs into compressed sparse rows.
+ * @param pairs  The pairs. Sorted and deduplicated here.
+ * @param nodes  Number of nodes.
+ * @param offsets  Receives per node the start of its targets in targets, plus one extra at the end.
+ * @param targets  Receives the targets, grouped by node and sorted per node.
+ */
+static void compressRows(std::vector<std::pair<quint32, quint32>>& pairs, int nodes,
+                         QVector<quint32>* offsets, QVector<quint32>* targets) {
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    offsets->clear();
+    targets->clear();
+    offsets->reserve(nodes + 1);
+    targets->reserve(int(pairs.size()));
+    auto pair = pairs.cbegin();
+    for (int node = 0; node < nodes; node++) {
+        *offsets << quint32(targets->size());
+        for (; pair != pairs.cend() && pair->first == quint32(node); ++pair)
+            *targets << pair->second;
+    }
+    *offsets << quint32(targets->size());
+}
+
+
+/**
+ * @brief Read-only, memory-mapped compilation of the content database, for fast lookups.
+ * @details A content pack holds what barcode and category lookups need, in the form they need it:
+ *   the sorted barcodes of all products, the category relations as compressed sparse rows (per
+ *   product its categories, per category its parents and its topics), and per language the
+ *   category names and topic texts as references into one UTF-8 string arena. Categories and
+ *   topics are referred to by their number in the sorted lists of their IDs.
+ *
+ *   The file is mapped into memory and used in place: opening it only checks the header and the
+ *   section table, with no parsing and no heap allocation proportional to its size. So the pack is
+ *   ready right at startup, and the operating system pages in only what lookups touch. The
+ *   references inside the sections are checked when following them, so a damaged pack gives wrong
+ *   results at worst, but never reads outside the file.
+ *
+ *   The pack is made from a database with create(), and is only used with the database version it
+ *   was made from. Completions and category name searches still use the database.
+ */
+ContentPack::ContentPack() : m_data(nullptr), m_size(0) { }
+
+
+ContentPack::~ContentPack() {
+    close();
+}
+
+
+/**
+ * @brief Open a content pack file.
+ * @param fileName  The file to open.
+ * @param userVersion  user_version of the database in use. Packs made from another database version are refused.
+ * @return true if the pack can be used, false otherwise.
+ */
+bool ContentPack::open(QString fileName, qint32 userVersion) {
+    close();
+
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+    Q_UNUSED(fileName)
+    Q_UNUSED(userVersion)
+    qWarning() << "ContentPack::open: ERROR: Content packs are only supported on little endian systems.";
+    return false;
+#else
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "ContentPack::open: ERROR: Could not open" << fileName << ":" << m_file.errorString();
+        return false;
+    }
+    m_size = m_file.size();
+    m_data = m_size >= qint64(sizeof(PackHeader)) ? m_file.map(0, m_size) : nullptr;
+
+    const PackHeader* header = reinterpret_cast<const PackHeader*>(m_data);
+    if (!header || std::memcmp(header->magic, packMagic, sizeof(packMagic)) != 0 || header->format != packFormat) {
+        qWarning() << "ContentPack::open: ERROR:" << fileName << "is no content pack of format" << packFormat;
+        close();
+        return false;
+    }
+    if (header->userVersion != userVersion) {
+        qDebug() << "ContentPack::open: Not using" << fileName << "as it was made from database version"
+            << header->userVersion << "instead of" << userVersion;
+        close();
+        return false;
+    }
+    if (sizeof(PackHeader) + quint64(header->sectionCount) * sizeof(PackSectionEntry) > quint64(m_size)) {
+        qWarning() << "ContentPack::open: ERROR:" << fileName << "is truncated.";
+        close();
+        return false;
+    }
+
+    bool valid =
+        map(productCodesSection, m_productCodes) &&
+        map(productCategoryOffsetsSection, m_productCategoryOffsets) &&
+        map(productCategoriesSection, m_productCategories) &&
+        map(categoryIdsSection, m_categoryIds) &&
+        map(categoryParentOffsetsSection, m_categoryParentOffsets) &&
+        map(categoryParentsSection, m_categoryParents) &&
+        map(categoryTopicOffsetsSection, m_categoryTopicOffsets) &&
+        map(categoryTopicsSection, m_categoryTopics) &&
+        map(topicIdsSection, m_topicIds) &&
+        map(topicMetaSection, m_topicMeta) &&
+        map(languagesSection, m_languages) &&
+        map(categoryNamesSection, m_categoryNames) &&
+        map(topicTextsSection, m_topicTexts) &&
+        map(stringsSection, m_strings);
+
+    quint64 languages = m_languages.count / languageCodeSize;
+    valid = valid &&
+        m_productCategoryOffsets.count == m_productCodes.count + 1 &&
+        m_categoryParentOffsets.count == m_categoryIds.count + 1 &&
+        m_categoryTopicOffsets.count == m_categoryIds.count + 1 &&
+        m_topicMeta.count == m_topicIds.count &&
+        m_languages.count % languageCodeSize == 0 &&
+        m_categoryNames.count == languages * m_categoryIds.count &&
+        m_topicTexts.count == languages * m_topicIds.count &&
+        m_productCodes.count < quint64(std::numeric_limits<int>::max()) &&
+        m_categoryIds.count < quint64(std::numeric_limits<int>::max());
+
+    if (!valid) {
+        qWarning() << "ContentPack::open: ERROR:" << fileName << "is damaged.";
+        close();
+        return false;
+    }
+
+    qDebug() << "ContentPack::open: Using" << fileName << "with" << m_productCodes.count << "products,"
+        << m_categoryIds.count << "categories and" << m_topicIds.count << "topics.";
+    return true;
+#endif
+}
+
+
+/** @brief Unmap and close the file, if open. Afterwards, all lookups find nothing. */
+void ContentPack::close() {
+    if (m_data)
+        m_file.unmap(const_cast<uchar*>(m_data));
+    m_file.close();
+    m_data = nullptr;
+    m_size = 0;
+
+    m_productCodes = Column<quint64>();
+    m_productCategoryOffsets = Column<quint32>();
+    m_productCategories = Column<quint32>();
+    m_categoryIds = Column<qint64>();
+    m_categoryParentOffsets = Column<quint32>();
+    m_categoryParents = Column<quint32>();
+    m_categoryTopicOffsets = Column<quint32>();
+    m_categoryTopics = Column<quint32>();
+    m_topicIds = Column<qint64>();
+    m_topicMeta = Column<TopicMeta>();
+    m_languages = Column<char>();
+    m_categoryNames = Column<StringRef>();
+    m_topicTexts = Column<TopicText>();
+    m_strings = Column<char>();
+}
+
+
+/**
+ * @brief Point a column to its section of the mapped file.
+ * @return true if the section exists, has the expected element size and lies within the file.
+ */
+template <typename T> bool ContentPack::map(quint32 section, Column<T>& column) {
+    const PackHeader* header = reinterpret_cast<const PackHeader*>(m_data);
+    const PackSectionEntry* entries = reinterpret_cast<const PackSectionEntry*>(m_data + sizeof(PackHeader));
+
+    for (quint32 i = 0; i < header->sectionCount; i++) {
+        const PackSectionEntry& entry = entries[i];
+        if (entry.id != section)
+            continue;
+
+        if (entry.elementSize != sizeof(T) || entry.offset % 8 != 0 || entry.offset > quint64(m_size)
+                || entry.count > (quint64(m_size) - entry.offset) / sizeof(T)) {
+            qWarning() << "ContentPack::map: ERROR: Section" << section << "is damaged.";
+            return false;
+        }
+        column.data = reinterpret_cast<const T*>(m_data + entry.offset);
+        column.count = entry.count;
+        return true;
+    }
+
+    qWarning() << "ContentPack::map: ERROR: Section" << section << "is missing.";
+    return false;
+}
+
+
+/**
+ * @brief Find the targets of a node in compressed sparse rows.
+ * @param offsets  Per node the start of its targets, plus one extra at the end.
+ * @param targets  The targets of all nodes.
+ * @param i  The node.
+ * @param begin  Receives the start of the node's targets.
+ * @param end  Receives the end of the node's targets.
+ * @return true if found, false if the node does not exist or the offsets are damaged.
+ */
+template <typename T> bool ContentPack::related(const Column<quint32>& offsets, const Column<T>& targets, quint32 i,
+                                                const T** begin, const T** end) {
+    if (quint64(i) + 1 >= offsets.count)
+        return false;
+    quint32 first = offsets.data[i];
+    quint32 last = offsets.data[i + 1];
+    if (first > last || last > targets.count)
+        return false;
+
+    *begin = targets.data + first;
+    *end = targets.data + last;
+    return true;
+}
+
+
+/** @brief The number of the product with the given barcode, or -1 if there is none. */
+int ContentPack::productNumber(quint64 code) const {
+    const quint64* end = m_productCodes.data + m_productCodes.count;
+    const quint64* found = std::lower_bound(m_productCodes.data, end, code);
+    return found != end && *found == code ? int(found - m_productCodes.data) : -1;
+}
+
+
+/** @brief The number of the category with the given ID, or -1 if there is none. */
+int ContentPack::categoryNumber(qint64 categoryId) const {
+    const qint64* end = m_categoryIds.data + m_categoryIds.count;
+    const qint64* found = std::lower_bound(m_categoryIds.data, end, categoryId);
+    return found != end && *found == categoryId ? int(found - m_categoryIds.data) : -1;
+}
+
+
+/** @brief The number of the given language, or -1 if the pack has no texts in it. */
+int ContentPack::languageNumber(QString language) const {
+    QByteArray code = language.toUtf8();
+    for (quint64 i = 0; i < m_languages.count / languageCodeSize; i++) {
+        const char* entry = m_languages.data + i * languageCodeSize;
+        if (QByteArray(entry, int(qstrnlen(entry, languageCodeSize))) == code)
+            return int(i);
+    }
+    return -1;
+}
+
+
+/** @brief The name of a category in a language, or a null string if it has none. */
+QString ContentPack::categoryName(quint32 category, int language) const {
+    if (language < 0 || category >= m_categoryIds.count)
+        return QString();
+    return string(m_categoryNames.data[quint64(language) * m_categoryIds.count + category]);
+}
+
+
+/** @brief A string from the string arena. A null string if absent or damaged. */
+QString ContentPack::string(StringRef ref) const {
+    if (ref.offset == noString || quint64(ref.offset) + ref.length > m_strings.count)
+        return QString();
+    return QString::fromUtf8(m_strings.data + ref.offset, int(ref.length));
+}
+
+
+/**
+ * @brief Collect the topics of the given categories and all their ancestors.
+ * @details Does the same as the recursive SQL queries in ContentDatabase::queryTopics(): every
+ *   ancestor is expanded once, even if reachable via multiple categories, and every topic is
+ *   included once.
+ * @param categories  Category numbers.
+ * @param language  The language of the topics. Topics without content in it are left out.
+ * @return The topics, ordered by ID.
+ */
+QVector<ContentTopic> ContentPack::topics(QVector<quint32> categories, QString language) const {
+    QVector<ContentTopic> topics;
+    int lang = languageNumber(language);
+    if (lang < 0)
+        return topics;
+
+    QSet<quint32> seen;
+    for (quint32 category : categories)
+        seen.insert(category);
+    for (int i = 0; i < categories.size(); i++) {
+        const quint32* parent;
+        const quint32* end;
+        if (!related(m_categoryParentOffsets, m_categoryParents, categories[i], &parent, &end))
+            continue;
+        for (; parent != end; ++parent)
+            if (!seen.contains(*parent)) {
+                seen.insert(*parent);
+                categories << *parent;
+            }
+    }
+
+    // Topic numbers are in the order of topic IDs.
+    QVector<quint32> topicNumbers;
+    for (quint32 category : categories) {
+        const quint32* topic;
+        const quint32* end;
+        if (related(m_categoryTopicOffsets, m_categoryTopics, category, &topic, &end))
+            for (; topic != end; ++topic)
+                topicNumbers << *topic;
+    }
+    std::sort(topicNumbers.begin(), topicNumbers.end());
+    topicNumbers.erase(std::unique(topicNumbers.begin(), topicNumbers.end()), topicNumbers.end());
+
+    for (quint32 number : topicNumbers) {
+        if (number >= m_topicIds.count)
+            continue;
+        const TopicText& text = m_topicTexts.data[quint64(lang) * m_topicIds.count + number];
+        if (text.content.offset == noString)
+            continue;
+
+        ContentTopic topic;
+        topic.id = m_topicIds.data[number];
+        topic.title = string(text.title);
+        topic.section = string(m_topicMeta.data[number].section);
+        topic.version = string(m_topicMeta.data[number].version);
+        topic.content = string(text.content);
+        topics << topic;
+    }
+    return topics;
+}
+
+
+/**
+ * @brief Find the topics for a product. Thread-safe.
+ * @param code  The product's barcode number.
+ * @param language  The language of the topics, as stored in the database.
+ * @return The topics of the product's categories and their ancestors, ordered by ID.
+ */
+QVector<ContentTopic> ContentPack::topicsForBarcode(quint64 code, QString language) const {
+    const quint32* category;
+    const quint32* end;
+    int product = productNumber(code);
+    if (product < 0 || !related(m_productCategoryOffsets, m_productCategories, quint32(product), &category, &end))
+        return QVector<ContentTopic>();
+
+    QVector<quint32> categories;
+    for (; category != end; ++category)
+        if (*category < m_categoryIds.count)
+            categories << *category;
+    return topics(categories, language);
+}
+
+
+/**
+ * @brief Find the topics for a category. Thread-safe.
+ * @param categoryId  The category's ID in the database.
+ * @param language  The language of the topics, as stored in the database.
+ * @return The topics of the category and its ancestors, ordered by ID.
+ */
+QVector<ContentTopic> ContentPack::topicsForCategory(qint64 categoryId, QString language) const {
+    int category = categoryNumber(categoryId);
+    if (category < 0)
+        return QVector<ContentTopic>();
+    return topics(QVector<quint32>{quint32(category)}, language);
+}
+
+
+/**
+ * @brief Determine the names of the categories directly assigned to a product. Thread-safe.
+ * @return The category names. Empty if the product is not in the pack or has no categories with a
+ *   name in the given language.
+ */
+QStringList ContentPack::productCategories(quint64 code, QString language) const {
+    QStringList names;
+    const quint32* category;
+    const quint32* end;
+    int product = productNumber(code);
+    int lang = languageNumber(language);
+    if (product < 0 || lang < 0 || !related(m_productCategoryOffsets, m_productCategories, quint32(product), &category, &end))
+        return names;
+
+    for (; category != end; ++category) {
+        QString name = categoryName(*category, lang);
+        if (!name.isNull())
+            names << name;
+    }
+    return names;
+}
+
+
+/**
+ * @brief Determine the most specific category of a product: one that is no parent of another one
+ *   of its categories. Thread-safe.
+ * @return The category name, or "" if the product is not in the pack or has no such category with
+ *   a name in the given language.
+ */
+QString ContentPack::topCategory(quint64 code, QString language) const {
+    const quint32* first;
+    const quint32* end;
+    int product = productNumber(code);
+    int lang = languageNumber(language);
+    if (product < 0 || lang < 0 || !related(m_productCategoryOffsets, m_productCategories, quint32(product), &first, &end))
+        return QString();
+
+    QSet<quint32> parents;
+    for (const quint32* category = first; category != end; ++category) {
+        const quint32* parent;
+        const quint32* parentsEnd;
+        if (related(m_categoryParentOffsets, m_categoryParents, *category, &parent, &parentsEnd))
+            for (; parent != parentsEnd; ++parent)
+                parents.insert(*parent);
+    }
+
+    for (const quint32* category = first; category != end; ++category) {
+        QString name = categoryName(*category, lang);
+        if (!parents.contains(*category) && !name.isNull())
+            return name;
+    }
+    return QString();
+}
+
+
+/**
+ * @brief Find the barcodes starting with the given digits. Thread-safe.
+ * @details Works like BarcodeIndex::complete(), on the sorted barcodes in the pack.
+ * @param digits  The start of a barcode number, as typed.
+ * @param limit  Maximum number of results.
+ * @return The barcodes, shortest first, and each length in ascending order.
+ */
+QVector<quint64> ContentPack::completeBarcodes(QString digits, int limit) const {
+    QVector<quint64> results;
+    const quint64* end = m_productCodes.data + m_productCodes.count;
+    for (const QPair<quint64, quint64>& range : BarcodeIndex::prefixRanges(digits)) {
+        const quint64* code = std::lower_bound(m_productCodes.data, end, range.first);
+        for (; code != end && *code < range.second; ++code) {
+            if (results.size() >= limit)
+                return results;
+            results << *code;
+        }
+    }
+    return results;
+}
+
+
+/** @brief The content pack file belonging to a database file: the same name with suffix ".frpack". */
+QString ContentPack::packFile(QString databaseFile) {
+    QFileInfo info(databaseFile);
+    return info.path() + "/" + info.completeBaseName() + ".frpack";
+}
+
+
+/**
+ * @brief Create a content pack from a content database.
+ * @details Used when building the content database. The pack is written with the byte order of the
+ *   system creating it, which has to be little endian like the systems using it.
+ * @param databaseFile  The database to convert.
+ * @param packFile  The pack file to write. Replaced if it exists.
+ * @return true on success, false otherwise.
+ */
+bool ContentPack::create(QString databaseFile, QString packFile) {
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+    Q_UNUSED(databaseFile)
+    Q_UNUSED(packFile)
+    qWarning() << "ContentPack::create: ERROR: Content packs can only be created on little endian systems.";
+    return false;
+#else
+    QElapsedTimer timer;
+    timer.start();
+
+    qint32 userVersion = ContentUpdater::userVersion(databaseFile);
+    if (userVersion < 0) {
+        qWarning() << "ContentPack::create: ERROR:" << databaseFile << "is no SQLite database.";
+        return false;
+    }
+
+    QVector<quint64> productCodes;
+    QVector<quint32> productCategoryOffsets, productCategories;
+    QVector<qint64> categoryIds;
+    QVector<quint32> categoryParentOffsets, categoryParents;
+    QVector<quint32> categoryTopicOffsets, categoryTopics;
+    QVector<qint64> topicIds;
+    QVector<TopicMeta> topicMeta;
+    QByteArray languageCodes;
+    QVector<StringRef> categoryNames;
+    QVector<TopicText> topicTexts;
+    QByteArray strings;
+
+    // Adds a string to the arena, storing repeated strings such as section names only once.
+    QHash<QByteArray, StringRef> stored;
+    bool overflow = false;
+    auto addString = [&](const QString& text) -> StringRef {
+        QByteArray utf8 = text.toUtf8();
+        if (stored.contains(utf8))
+            return stored.value(utf8);
+        if (quint64(strings.size()) + utf8.size() >= noString) {
+            overflow = true;
+            return StringRef{noString, 0};
+        }
+        StringRef ref{quint32(strings.size()), quint32(utf8.size())};
+        strings += utf8;
+        stored.insert(utf8, ref);
+        return ref;
+    };
+
+    bool success = true;
+    const QString connectionName("ContentPack-create");
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY");
+        db.setDatabaseName(databaseFile);
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        success = db.open();
+
+        // Categories, numbered in the order of their IDs.
+        QHash<qint64, quint32> categoryNumbers;
+        success = success && query.exec(
+            "SELECT category_id FROM category_names "
+            "UNION SELECT category_id FROM category_structure "
+            "UNION SELECT parent_id FROM category_structure "
+            "UNION SELECT category_id FROM product_categories "
+            "UNION SELECT category_id FROM topic_categories");
+        while (success && query.next())
+            categoryIds << query.value(0).toLongLong();
+        std::sort(categoryIds.begin(), categoryIds.end());
+        for (int i = 0; i < categoryIds.size(); i++)
+            categoryNumbers.insert(categoryIds[i], quint32(i));
+
+        // Topics, numbered in the order of their IDs.
+        QHash<qint64, quint32> topicNumbers;
+        success = success && query.exec("SELECT id, section, version FROM topics ORDER BY id");
+        while (success && query.next()) {
+            topicNumbers.insert(query.value(0).toLongLong(), quint32(topicIds.size()));
+            topicIds << query.value(0).toLongLong();
+            topicMeta << TopicMeta{addString(query.value(1).toString()), addString(query.value(2).toString())};
+        }
+
+        // Products and their categories. Products without categories are kept for completing barcodes.
+        const quint32 noCategory = 0xFFFFFFFF;
+        std::vector<std::pair<quint64, quint32>> codeCategories;
+        success = success && query.exec(
+            "SELECT products.code, product_categories.category_id "
+            "FROM products LEFT JOIN product_categories ON products.id = product_categories.product_id");
+        while (success && query.next()) {
+            qint64 code = query.value(0).toLongLong();
+            if (code > 0)
+                codeCategories.emplace_back(quint64(code), query.value(1).isNull()
+                    ? noCategory : categoryNumbers.value(query.value(1).toLongLong()));
+        }
+        std::sort(codeCategories.begin(), codeCategories.end());
+        std::vector<std::pair<quint32, quint32>> pairs;
+        for (const auto& codeCategory : codeCategories) {
+            if (productCodes.isEmpty() || productCodes.last() != codeCategory.first)
+                productCodes << codeCategory.first;
+            if (codeCategory.second != noCategory)
+                pairs.emplace_back(quint32(productCodes.size() - 1), codeCategory.second);
+        }
+        std::vector<std::pair<quint64, quint32>>().swap(codeCategories);
+        compressRows(pairs, productCodes.size(), &productCategoryOffsets, &productCategories);
+
+        // Parents of the categories.
+        pairs.clear();
+        success = success && query.exec("SELECT category_id, parent_id FROM category_structure");
+        while (success && query.next())
+            pairs.emplace_back(categoryNumbers.value(query.value(0).toLongLong()),
+                               categoryNumbers.value(query.value(1).toLongLong()));
+        compressRows(pairs, categoryIds.size(), &categoryParentOffsets, &categoryParents);
+
+        // Topics of the categories. Assignments of topics that do not exist are left out.
+        pairs.clear();
+        success = success && query.exec("SELECT category_id, topic_id FROM topic_categories");
+        while (success && query.next())
+            if (topicNumbers.contains(query.value(1).toLongLong()))
+                pairs.emplace_back(categoryNumbers.value(query.value(0).toLongLong()),
+                                   topicNumbers.value(query.value(1).toLongLong()));
+        compressRows(pairs, categoryIds.size(), &categoryTopicOffsets, &categoryTopics);
+
+        // Languages of the texts.
+        QStringList languages;
+        success = success && query.exec("SELECT lang FROM category_names UNION SELECT lang FROM topic_contents");
+        while (success && query.next()) {
+            QByteArray code = query.value(0).toString().toUtf8();
+            if (code.isEmpty() || code.size() > languageCodeSize) {
+                qWarning() << "ContentPack::create: Leaving out texts with unsupported language code" << code;
+                continue;
+            }
+            languages << QString::fromUtf8(code);
+            languageCodes += code.leftJustified(languageCodeSize, '\0');
+        }
+
+        // Per language and category, the first name found. Further names are synonyms.
+        categoryNames.fill(StringRef{noString, 0}, languages.size() * categoryIds.size());
+        success = success && query.exec("SELECT category_id, lang, name FROM category_names");
+        while (success && query.next()) {
+            int lang = languages.indexOf(query.value(1).toString());
+            if (lang < 0)
+                continue;
+            StringRef& name = categoryNames[lang * categoryIds.size() + int(categoryNumbers.value(query.value(0).toLongLong()))];
+            if (name.offset == noString)
+                name = addString(query.value(2).toString());
+        }
+
+        // Per language and topic, its title and content.
+        topicTexts.fill(TopicText{{noString, 0}, {noString, 0}}, languages.size() * topicIds.size());
+        success = success && query.exec("SELECT topic_id, lang, title, content FROM topic_contents");
+        while (success && query.next()) {
+            int lang = languages.indexOf(query.value(1).toString());
+            if (lang < 0 || !topicNumbers.contains(query.value(0).toLongLong()))
+                continue;
+            TopicText& text = topicTexts[lang * topicIds.size() + int(topicNumbers.value(query.value(0).toLongLong()))];
+            text.title = addString(query.value(2).toString());
+            text.content = addString(query.value(3).toString());
+        }
+
+        if (!success)
+            qWarning() << "ContentPack::create: ERROR:" << db.lastError().text() << query.lastError().text();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    if (!success)
+        return false;
+    if (overflow) {
+        qWarning() << "ContentPack::create: ERROR: The texts exceed the maximum size of a content pack.";
+        return false;
+    }
+
+    // Write the header, the section table and then the sections, each aligned to 8 bytes.
+    struct Section {
+        PackSection id;
+        quint32 elementSize;
+        quint64 count;
+        QByteArray data;
+    };
+    QVector<Section> sections = {
+        {productCodesSection, sizeof(quint64), quint64(productCodes.size()), rawBytes(productCodes)},
+        {productCategoryOffsetsSection, sizeof(quint32), quint64(productCategoryOffsets.size()), rawBytes(productCategoryOffsets)},
+        {productCategoriesSection, sizeof(quint32), quint64(productCategories.size()), rawBytes(productCategories)},
+        {categoryIdsSection, sizeof(qint64), quint64(categoryIds.size()), rawBytes(categoryIds)},
+        {categoryParentOffsetsSection, sizeof(quint32), quint64(categoryParentOffsets.size()), rawBytes(categoryParentOffsets)},
+        {categoryParentsSection, sizeof(quint32), quint64(categoryParents.size()), rawBytes(categoryParents)},
+        {categoryTopicOffsetsSection, sizeof(quint32), quint64(categoryTopicOffsets.size()), rawBytes(categoryTopicOffsets)},
+        {categoryTopicsSection, sizeof(quint32), quint64(categoryTopics.size()), rawBytes(categoryTopics)},
+        {topicIdsSection, sizeof(qint64), quint64(topicIds.size()), rawBytes(topicIds)},
+        {topicMetaSection, sizeof(TopicMeta), quint64(topicMeta.size()), rawBytes(topicMeta)},
+        {languagesSection, 1, quint64(languageCodes.size()), languageCodes},
+        {categoryNamesSection, sizeof(StringRef), quint64(categoryNames.size()), rawBytes(categoryNames)},
+        {topicTextsSection, sizeof(TopicText), quint64(topicTexts.size()), rawBytes(topicTexts)},
+        {stringsSection, 1, quint64(strings.size()), strings}
+    };
+
+    PackHeader header;
+    std::memcpy(header.magic, packMagic, sizeof(packMagic));
+    header.format = packFormat;
+    header.userVersion = userVersion;
+    header.sectionCount = quint32(sections.size());
+    header.reserved = 0;
+
+    QVector<PackSectionEntry> entries;
+    quint64 offset = aligned(sizeof(PackHeader) + sections.size() * sizeof(PackSectionEntry));
+    for (const Section& section : sections) {
+        entries << PackSectionEntry{section.id, section.elementSize, offset, section.count};
+        offset = aligned(offset + quint64(section.data.size()));
+    }
+
+    QSaveFile file(packFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "ContentPack::create: ERROR: Could not write" << packFile << ":" << file.errorString();
+        return false;
+    }
+    const QByteArray padding(8, '\0');
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(rawBytes(entries));
+    file.write(padding.constData(), qint64(aligned(file.pos()) - file.pos()));
+    for (const Section& section : sections) {
+        file.write(section.data);
+        file.write(padding.constData(), qint64(aligned(file.pos()) - file.pos()));
+    }
+    if (!file.commit()) {
+        qWarning() << "ContentPack::create: ERROR: Could not write" << packFile << ":" << file.errorString();
+        return false;
+    }
+
+    qDebug() << "ContentPack::create: Wrote" << packFile << "with" << productCodes.size() << "products,"
+        << categoryIds.size() << "categories and" << topicIds.size() << "topics in" << timer.elapsed() << "ms.";
+    return true;
+#endif
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "ContentDatabase.h"
+
+class ContentPack {
+
+public:
+    ContentPack();
+
+    ~ContentPack();
+
+    bool open(QString fileName, qint32 userVersion);
+
+    QVector<ContentTopic> topicsForBarcode(quint64 code, QString language) const;
+
+    QVector<ContentTopic> topicsForCategory(qint64 categoryId, QString language) const;
+
+    QStringList productCategories(quint64 code, QString language) const;
+
+    QString topCategory(quint64 code, QString language) const;
+
+    QVector<quint64> completeBarcodes(QString digits, int limit) const;
+
+    static QString packFile(QString databaseFile);
+
+    static bool create(QString databaseFile, QString packFile);
+
+private:
+    // Location of a UTF-8 string in the string arena. Absent strings have offset noString.
+    struct StringRef {
+        quint32 offset;
+        quint32 length;
+    };
+
+    struct TopicText {
+        StringRef title;
+        StringRef content;
+    };
+
+    struct TopicMeta {
+        StringRef section;
+        StringRef version;
+    };
+
+    // A section of the file, used in place as an array.
+    template <typename T> struct Column {
+        const T* data = nullptr;
+        quint64 count = 0;
+    };
+
+    template <typename T> bool map(quint32 section, Column<T>& column);
+    template <typename T> static bool related(const Column<quint32>& offsets, const Column<T>& targets, quint32 i,
+                                              const T** begin, const T** end);
+
+    void close();
+    int productNumber(quint64 code) const;
+    int categoryNumber(qint64 categoryId) const;
+    int languageNumber(QString language) const;
+    QString categoryName(quint32 category, int language) const;
+    QVector<ContentTopic> topics(QVector<quint32> categories, QString language) const;
+    QString string(StringRef ref) const;
+
+    Q_DISABLE_COPY(ContentPack)
+
+    QFile m_file;
+    const uchar* m_data;
+    qint64 m_size;
+
+    Column<quint64> m_productCodes;             // Sorted.
+    Column<quint32> m_productCategoryOffsets;   // Per product: start of its categories. One extra at the end.
+    Column<quint32> m_productCategories;        // Category numbers.
+    Column<qint64> m_categoryIds;               // Per category number: the category ID. Sorted.
+    Column<quint32> m_categoryParentOffsets;    // Per category: start of its parents. One extra at the end.
+    Column<quint32> m_categoryParents;          // Category numbers.
+    Column<quint32> m_categoryTopicOffsets;     // Per category: start of its topics. One extra at the end.
+    Column<quint32> m_categoryTopics;           // Topic numbers, sorted per category.
+    Column<qint64> m_topicIds;                  // Per topic number: the topic ID. Sorted.
+    Column<TopicMeta> m_topicMeta;              // Per topic.
+    Column<char> m_languages;                   // Per language: its code, zero-padded to 8 bytes.
+    Column<StringRef> m_categoryNames;          // Per language and category: the category's name.
+    Column<TopicText> m_topicTexts;             // Per language and topic: the topic's title and content.
+    Column<char> m_strings;                     // The string arena.
+};
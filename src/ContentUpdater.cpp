@@ -0,0 +1,430 @@
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QVariant>
+#include <QDebug>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QElapsedTimer>
+
+#include "ContentUpdater.h"
+
+
+// File format identification of changeset files: "FRCS" for "Food Rescue changeset", and the version.
+static const quint32 changesetMagic = 0x46524353;
+static const quint32 changesetFormat = 1;
+
+// Kinds of row operations in a changeset.
+enum ChangesetOperation : quint8 {DELETE_ROW = 1, INSERT_ROW = 2};
+
+
+/**
+ * @brief Updater for the content database that applies changesets instead of replacing the file.
+ * @details A changeset contains the rows deleted from and inserted into every table between two
+ *   versions of the content database. Versions are identified by the SQLite "user_version" header
+ *   field. Changesets are applied in the background to one of two "slot" copies of the database in
+ *   the app's local data directory, never to the database in use. The slot not in use is always one
+ *   update behind, so it is brought up to date by applying the last changeset again plus the new
+ *   one, and the I/O needed scales with the size of the changes only. The full database is copied
+ *   once, when a slot does not yet exist.
+ *
+ *   When done, updated() provides the updated database file, to be swapped in by
+ *   ContentDatabase::switchDatabase(). On the next start, ContentDatabase::connect() picks the
+ *   newest of the bundled database and the slots (see newestDatabase()).
+ *
+ *   SQLite's session extension would provide similar changesets, but it is not compiled into the
+ *   SQLite library shipped with Qt, so a simple changeset format of our own is used.
+ */
+ContentUpdater::ContentUpdater(QObject* parent) : QObject(parent) { }
+
+
+/**
+ * @brief Apply the given and all previously stored changesets to a copy of the active database, in
+ *   the background. Emits updated() or failed() when done. Does nothing if no changeset applies.
+ * @param changesetFiles  New changeset files to apply. They are copied to the app's local data
+ *   directory, so they can be deleted afterwards.
+ * @param activeDatabase  The database file currently in use by ContentDatabase.
+ */
+void ContentUpdater::apply(QStringList changesetFiles, QString activeDatabase) {
+    struct Outcome { bool success; QString database; QString error; };
+
+    QFutureWatcher<Outcome>* watcher = new QFutureWatcher<Outcome>(this);
+
+    QObject::connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        Outcome outcome = watcher->result();
+
+        if (!outcome.success) {
+            qWarning() << "ContentUpdater::apply: ERROR:" << outcome.error;
+            failed(outcome.error);
+        }
+        else if (!outcome.database.isEmpty())
+            updated(outcome.database, userVersion(outcome.database));
+    });
+
+    watcher->setFuture(QtConcurrent::run([changesetFiles, activeDatabase]() {
+        Outcome outcome;
+        outcome.success = applyChain(changesetFiles, activeDatabase, &outcome.database, &outcome.error);
+        return outcome;
+    }));
+}
+
+
+/**
+ * @brief Bring the slot not in use up to the newest version reachable with the stored changesets.
+ *   Executed on a worker thread.
+ * @param updatedDatabase  Receives the updated slot file, or "" if there was nothing to update.
+ * @param error  Receives an error message on failure.
+ * @return false on failure, true otherwise.
+ */
+bool ContentUpdater::applyChain(QStringList changesetFiles, QString activeDatabase, QString* updatedDatabase,
+                                QString* error) {
+    QElapsedTimer timer;
+    timer.start();
+
+    // Store the new changesets.
+    QDir().mkpath(changesetDirectory());
+    for (QString file : changesetFiles) {
+        ChangesetInfo info;
+        if (!readChangesetInfo(file, &info)) {
+            *error = "Not a valid changeset file: " + file;
+            return false;
+        }
+        QString stored = QString("%1/%2-%3.frcs").arg(changesetDirectory())
+            .arg(info.baseVersion).arg(info.targetVersion);
+        QFile::remove(stored);
+        if (!QFile::copy(file, stored)) {
+            *error = "Could not store changeset " + file;
+            return false;
+        }
+    }
+
+    QList<ChangesetInfo> changesets;
+    for (QFileInfo file : QDir(changesetDirectory()).entryInfoList({"*.frcs"}, QDir::Files)) {
+        ChangesetInfo info;
+        if (readChangesetInfo(file.absoluteFilePath(), &info))
+            changesets << info;
+    }
+
+    // Find the chain of changesets from the given version to the newest reachable version.
+    auto chainFrom = [&changesets](qint32 version) {
+        QStringList chain;
+        for (bool extended = true; extended; ) {
+            extended = false;
+            const ChangesetInfo* next = nullptr;
+            for (const ChangesetInfo& info : changesets)
+                if (info.baseVersion == version && (!next || info.targetVersion > next->targetVersion))
+                    next = &info;
+            if (next) {
+                chain << next->fileName;
+                version = next->targetVersion;
+                extended = true;
+            }
+        }
+        return qMakePair(chain, version);
+    };
+
+    qint32 activeVersion = userVersion(activeDatabase);
+    QPair<QStringList, qint32> fromActive = chainFrom(activeVersion);
+    if (fromActive.second <= activeVersion) {
+        updatedDatabase->clear();
+        return true;
+    }
+
+    // Use the slot that is not in use. Prefer updating its existing content over copying the
+    // active database, if it reaches the same version.
+    QString slot = QFileInfo(activeDatabase) == QFileInfo(slotFile(0)) ? slotFile(1) : slotFile(0);
+    qint32 slotVersion = userVersion(slot);
+    QPair<QStringList, qint32> fromSlot = chainFrom(slotVersion);
+    QStringList chain = fromActive.first;
+    if (slotVersion >= 0 && slotVersion <= activeVersion && fromSlot.second == fromActive.second)
+        chain = fromSlot.first;
+    else {
+        qDebug() << "ContentUpdater::applyChain: Copying" << activeDatabase << "to" << slot;
+        QFile::remove(slot);
+        if (!QFile::copy(activeDatabase, slot)) {
+            *error = "Could not copy the database to " + slot;
+            return false;
+        }
+        QFile(slot).setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+    }
+
+    bool success = true;
+    const QString connectionName("ContentUpdater");
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(slot);
+        if (!db.open()) {
+            *error = "Could not open " + slot + ": " + db.lastError().text();
+            success = false;
+        }
+
+        // All changesets are applied in one transaction, so a failed update leaves the slot unchanged.
+        if (success)
+            success = db.transaction();
+        for (int i = 0; success && i < chain.size(); i++)
+            success = applyChangeset(db, chain[i], error);
+        if (success) {
+            QSqlQuery query(db);
+            success = query.exec(QString("PRAGMA user_version = %1").arg(fromActive.second)) && db.commit();
+            if (!success)
+                *error = "Could not commit the update: " + db.lastError().text();
+        }
+        if (!success && db.isOpen())
+            db.rollback();
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    if (!success)
+        return false;
+
+    // Changesets leading up to the active version are no longer needed by either slot.
+    for (const ChangesetInfo& info : changesets)
+        if (info.targetVersion <= activeVersion)
+            QFile::remove(info.fileName);
+
+    qDebug() << "ContentUpdater::applyChain: Updated" << slot << "to version" << fromActive.second
+        << "with" << chain.size() << "changesets in" << timer.elapsed() << "ms.";
+    *updatedDatabase = slot;
+    return true;
+}
+
+
+/**
+ * @brief Apply the row operations of one changeset to the given database.
+ * @return false with an error message on failure, true otherwise.
+ */
+bool ContentUpdater::applyChangeset(QSqlDatabase database, QString changesetFile, QString* error) {
+    QFile file(changesetFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = "Could not open " + changesetFile;
+        return false;
+    }
+
+    QDataStream header(&file);
+    header.setVersion(QDataStream::Qt_5_12);
+    quint32 magic, format;
+    qint32 baseVersion, targetVersion;
+    QByteArray compressed;
+    header >> magic >> format >> baseVersion >> targetVersion >> compressed;
+
+    QByteArray payload = qUncompress(compressed);
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_5_12);
+
+    quint32 tableCount;
+    in >> tableCount;
+    for (quint32 t = 0; t < tableCount && in.status() == QDataStream::Ok; t++) {
+        QString table;
+        QStringList columns;
+        quint32 operationCount;
+        in >> table >> columns >> operationCount;
+
+        // "IS" instead of "=" also matches NULL values.
+        QStringList conditions, placeholders;
+        for (const QString& column : columns) {
+            conditions << QString("\"%1\" IS ?").arg(column);
+            placeholders << "?";
+        }
+
+        QSqlQuery deleteQuery(database);
+        QSqlQuery insertQuery(database);
+        deleteQuery.prepare(QString("DELETE FROM \"%1\" WHERE %2").arg(table, conditions.join(" AND ")));
+        insertQuery.prepare(QString("INSERT INTO \"%1\" VALUES (%2)").arg(table, placeholders.join(", ")));
+
+        for (quint32 i = 0; i < operationCount && in.status() == QDataStream::Ok; i++) {
+            quint8 operation;
+            QVariantList values;
+            in >> operation >> values;
+
+            QSqlQuery& query = operation == DELETE_ROW ? deleteQuery : insertQuery;
+            for (int v = 0; v < values.size(); v++)
+                query.bindValue(v, values[v]);
+            if (!query.exec()) {
+                *error = QString("Applying %1 to table %2 failed: %3")
+                    .arg(changesetFile, table, query.lastError().text());
+                return false;
+            }
+        }
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        *error = "Changeset file is truncated or damaged: " + changesetFile;
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Create a changeset with the differences between two versions of the content database.
+ * @details Both databases must have the same tables and columns, and the new database must have a
+ *   higher user_version than the old one (set with "PRAGMA user_version = …" when building it).
+ *   Rows are compared as a whole, so a changed row is recorded as a deletion plus an insertion.
+ * @return true on success, false otherwise.
+ */
+bool ContentUpdater::createChangeset(QString oldDatabase, QString newDatabase, QString changesetFile) {
+    qint32 baseVersion = userVersion(oldDatabase);
+    qint32 targetVersion = userVersion(newDatabase);
+    if (baseVersion < 0 || targetVersion <= baseVersion) {
+        qWarning() << "ContentUpdater::createChangeset: ERROR: The new database needs a higher"
+            << "user_version than the old one, found" << baseVersion << "and" << targetVersion;
+        return false;
+    }
+
+    QByteArray payload;
+    bool success = true;
+    const QString connectionName("ContentUpdater-create");
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY");
+        db.setDatabaseName(newDatabase);
+        QSqlQuery query(db);
+        success = db.open() && query.exec(QString("ATTACH DATABASE '%1' AS old").arg(QString(oldDatabase).replace("'", "''")));
+        if (!success)
+            qWarning() << "ContentUpdater::createChangeset: ERROR:" << db.lastError().text() << query.lastError().text();
+
+        QStringList tables;
+        if (success && query.exec("SELECT name FROM main.sqlite_master WHERE type = 'table' AND name NOT LIKE 'sqlite_%' ORDER BY name"))
+            while (query.next())
+                tables << query.value(0).toString();
+
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_12);
+        out << quint32(tables.size());
+
+        for (int t = 0; success && t < tables.size(); t++) {
+            QString table = tables[t];
+            QStringList columns;
+            query.exec(QString("PRAGMA main.table_info(\"%1\")").arg(table));
+            while (query.next())
+                columns << query.value(1).toString();
+
+            // Collect deletions before insertions, so that changed rows with unique keys can be applied.
+            QList<QPair<quint8, QVariantList>> operations;
+            const QString difference("SELECT * FROM %1.\"%3\" EXCEPT SELECT * FROM %2.\"%3\"");
+            for (quint8 operation : {quint8(DELETE_ROW), quint8(INSERT_ROW)}) {
+                bool deletion = operation == DELETE_ROW;
+                if (!query.exec(difference.arg(deletion ? "old" : "main", deletion ? "main" : "old", table))) {
+                    qWarning() << "ContentUpdater::createChangeset: ERROR: Comparing table" << table
+                        << "failed:" << query.lastError().text();
+                    success = false;
+                    break;
+                }
+                while (query.next()) {
+                    QVariantList values;
+                    for (int c = 0; c < query.record().count(); c++)
+                        values << query.value(c);
+                    operations << qMakePair(operation, values);
+                }
+            }
+
+            out << table << columns << quint32(operations.size());
+            for (const auto& operation : operations)
+                out << operation.first << operation.second;
+
+            qDebug() << "ContentUpdater::createChangeset: Table" << table << ":" << operations.size() << "changes.";
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    if (!success)
+        return false;
+
+    QSaveFile file(changesetFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "ContentUpdater::createChangeset: ERROR: Could not open" << changesetFile;
+        return false;
+    }
+    QDataStream header(&file);
+    header.setVersion(QDataStream::Qt_5_12);
+    header << changesetMagic << changesetFormat << baseVersion << targetVersion << qCompress(payload);
+
+    return file.commit();
+}
+
+
+/**
+ * @brief Read the header of a changeset file.
+ * @return true if the file is a changeset in a supported format, false otherwise.
+ */
+bool ContentUpdater::readChangesetInfo(QString changesetFile, ChangesetInfo* info) {
+    QFile file(changesetFile);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic, format;
+    in >> magic >> format >> info->baseVersion >> info->targetVersion;
+    info->fileName = QFileInfo(changesetFile).absoluteFilePath();
+
+    return in.status() == QDataStream::Ok && magic == changesetMagic && format == changesetFormat;
+}
+
+
+/**
+ * @brief Choose the newest one of the bundled database and the updated database copies.
+ * @param bundledDatabase  The database file shipped with the application.
+ * @return The file with the highest user_version. The bundled database wins ties, for example
+ *   when an application update ships the same content as an earlier content update.
+ */
+QString ContentUpdater::newestDatabase(QString bundledDatabase) {
+    QString newest = bundledDatabase;
+    qint32 newestVersion = userVersion(bundledDatabase);
+
+    for (int slot = 0; slot < 2; slot++) {
+        qint32 version = userVersion(slotFile(slot));
+        if (version > newestVersion) {
+            newest = slotFile(slot);
+            newestVersion = version;
+        }
+    }
+
+    return newest;
+}
+
+
+/**
+ * @brief Read the "user_version" field of a SQLite database file, without opening it as a database.
+ * @return The version, or -1 if the file does not exist or is no SQLite database.
+ */
+qint32 ContentUpdater::userVersion(QString databaseFile) {
+    QFile file(databaseFile);
+    if (databaseFile.isEmpty() || !file.open(QIODevice::ReadOnly))
+        return -1;
+
+    // See "Database File Format", section "The Database Header": https://www.sqlite.org/fileformat.html
+    QByteArray header = file.read(64);
+    if (header.size() < 64 || !header.startsWith(QByteArray("SQLite format 3\0", 16)))
+        return -1;
+
+    QDataStream in(header.mid(60, 4));
+    in.setByteOrder(QDataStream::BigEndian);
+    qint32 version;
+    in >> version;
+    return version;
+}
+
+
+QString ContentUpdater::slotFile(int slot) {
+    return QString("%1/foodrescue-content.slot-%2.sqlite3")
+        .arg(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation))
+        .arg(slot == 0 ? "a" : "b");
+}
+
+
+QString ContentUpdater::changesetDirectory() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/changesets";
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <QSqlDatabase>
+
+/**
+ * @brief Header data of a content database changeset file.
+ */
+struct ChangesetInfo {
+    QString fileName;
+    qint32 baseVersion = -1;   // user_version of the database the changeset applies to.
+    qint32 targetVersion = -1; // user_version of the database after applying the changeset.
+};
+
+class ContentUpdater : public QObject {
+
+    Q_OBJECT
+
+public:
+    explicit ContentUpdater(QObject* parent = 0);
+
+    void apply(QStringList changesetFiles, QString activeDatabase);
+
+    static bool createChangeset(QString oldDatabase, QString newDatabase, QString changesetFile);
+
+    static QString newestDatabase(QString bundledDatabase);
+
+    static qint32 userVersion(QString databaseFile);
+
+signals:
+    void updated(QString databaseFile, int version);
+    void failed(QString message);
+
+private:
+    static bool applyChain(QStringList changesetFiles, QString activeDatabase, QString* updatedDatabase,
+                           QString* error);
+    static bool readChangesetInfo(QString changesetFile, ChangesetInfo* info);
+    static bool applyChangeset(QSqlDatabase database, QString changesetFile, QString* error);
+    static QString slotFile(int slot);
+    static QString changesetDirectory();
+};
@@ -0,0 +1,511 @@
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QSqlRecord>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QRegularExpression>
+#include <QSet>
+#include <QHash>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <limits>
+
+#include "DatabaseValidator.h"
+#include "ContentDatabase.h"
+
+
+// File format identification of the saved results: "FRDV" for "Food Rescue database validation",
+// and the version.
+static const quint32 resultsMagic = 0x46524456;
+static const quint32 resultsFormat = 1;
+
+// Version of the checks done by verify(). Increasing it invalidates all saved results, so that
+// databases are checked again after the checks changed.
+static const quint32 checksVersion = 1;
+
+// Saved results to keep. Enough for the bundled database and both update slots of ContentUpdater.
+static const int maxResults = 8;
+
+// The tables the application queries, with the columns it uses.
+static const struct { const char* table; const char* columns; } expectedTables[] = {
+    {"products", "id code"},
+    {"product_categories", "product_id category_id"},
+    {"category_structure", "category_id parent_id"},
+    {"category_names", "category_id lang name"},
+    {"topics", "id section version"},
+    {"topic_categories", "topic_id category_id"},
+    {"topic_contents", "topic_id lang title content"},
+};
+
+// The lookups the application's queries are composed of. Each has to be done with an index, as a
+// table scan would make the queries slow. Index names are not checked, only that an index is used.
+static const struct { const char* lookup; const char* query; } expectedPlans[] = {
+    {"product by barcode", "SELECT id FROM products WHERE code = 0"},
+    {"categories of a product", "SELECT category_id FROM product_categories WHERE product_id = 0"},
+    {"parents of a category", "SELECT parent_id FROM category_structure WHERE category_id = 0"},
+    {"names of a category", "SELECT name FROM category_names WHERE category_id = 0 AND lang = ''"},
+    {"topics of a category", "SELECT topic_id FROM topic_categories WHERE category_id = 0"},
+    {"children of a category", "SELECT category_id FROM category_structure WHERE parent_id = 0"},
+    {"category names in order", "SELECT category_id FROM category_names WHERE lang = '' AND (name, category_id) > ('', 0)"},
+    {"topic by ID", "SELECT section, version FROM topics WHERE id = 0"},
+    {"content of a topic", "SELECT title, content FROM topic_contents WHERE topic_id = 0 AND lang = ''"},
+};
+
+// Time budget of one statement in checkQueryPlans(): a base budget, plus time per row of the
+// tables the statement scans by design.
+static const qint64 baseBudgetMicros = 20000;
+static const qint64 scanBudgetMicrosPerRow = 2;
+
+// Tables with more rows count as large in checkQueryPlans().
+static const qint64 largeTableRows = 10000;
+
+// Runs per statement in checkQueryPlans(). The fastest counts, to reduce noise from other processes.
+static const int timedRuns = 3;
+
+
+/**
+ * @brief Checks that a content database file has the structure the application expects and is
+ *   not damaged.
+ * @details A full check reads the whole file, which takes too long to do before every start. So
+ *   the checking is split up:
+ *
+ *   - check() does the cheap checks, synchronously: it reads the file header, and looks up the
+ *     result of an earlier full check of the same file.
+ *   - validate() does the full check with verify() in the background, unless the same file passed
+ *     it before. Emits validated() or failed() when done.
+ *
+ *   Results are saved per fingerprint of the file (see fingerprint()), so they survive restarts and
+ *   are invalidated when the file changes.
+ */
+DatabaseValidator::DatabaseValidator(QObject* parent) : QObject(parent) {
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(directory);
+    m_fileName = directory + "/database-checks.dat";
+    loadResults();
+}
+
+
+/**
+ * @brief Check the given database file quickly, without reading more than its header.
+ * @return A description of the problem found, or "" if none was found. A problem found by an earlier
+ *   full check of the same, unchanged file is reported as well.
+ */
+QString DatabaseValidator::check(QString databaseFile) {
+    QString problem = checkHeader(databaseFile);
+    if (!problem.isEmpty())
+        return problem;
+
+    return m_results.value(fingerprint(databaseFile));
+}
+
+
+/**
+ * @brief Fully check the given database file in the background, unless it passed the check before.
+ * @details Emits validated() or failed() when done. The file is opened with its own connection,
+ *   so this does not interfere with queries running at the same time.
+ * @param databaseFile  The database file to check.
+ */
+void DatabaseValidator::validate(QString databaseFile) {
+    QByteArray fileFingerprint = fingerprint(databaseFile);
+    if (m_results.contains(fileFingerprint)) {
+        QString problem = m_results.value(fileFingerprint);
+        qDebug() << "DatabaseValidator::validate: Skipping the check of unchanged database" << databaseFile;
+        if (problem.isEmpty())
+            validated(databaseFile);
+        else
+            failed(databaseFile, problem);
+        return;
+    }
+
+    QFutureWatcher<QString>* watcher = new QFutureWatcher<QString>(this);
+
+    QObject::connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, databaseFile, fileFingerprint]() {
+        watcher->deleteLater();
+        QString problem = watcher->result();
+
+        // A file that changed while being checked is checked again at the next start.
+        if (fingerprint(databaseFile) == fileFingerprint)
+            storeResult(fileFingerprint, problem);
+
+        if (problem.isEmpty())
+            validated(databaseFile);
+        else {
+            qWarning() << "DatabaseValidator::validate: ERROR: Database" << databaseFile << "is damaged:" << problem;
+            failed(databaseFile, problem);
+        }
+    });
+
+    watcher->setFuture(QtConcurrent::run([databaseFile]() {
+        static QAtomicInt connections;
+        const QString connectionName = QString("DatabaseValidator-%1").arg(connections.fetchAndAddRelaxed(1));
+
+        QElapsedTimer timer;
+        timer.start();
+        QStringList problems;
+        QStringList warnings;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+            db.setConnectOptions("QSQLITE_OPEN_READONLY");
+            db.setDatabaseName(databaseFile);
+            if (db.open())
+                problems = verify(db, &warnings);
+            else
+                problems << "Could not open the database: " + db.lastError().text();
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+
+        for (const QString& warning : warnings)
+            qWarning() << "DatabaseValidator::validate: WARNING:" << warning;
+        qDebug() << "DatabaseValidator::validate: Checked database" << databaseFile << "in" << timer.elapsed() << "ms.";
+
+        return problems.join(" ");
+    }));
+}
+
+
+/**
+ * @brief Remember that the given database file is damaged, as found while using it.
+ * @details So the damage is reported by check() at the next start, before the file is used.
+ */
+void DatabaseValidator::recordFailure(QString databaseFile, QString problem) {
+    storeResult(fingerprint(databaseFile), problem);
+}
+
+
+/**
+ * @brief Fully check an open database. Slow, as it reads the whole file.
+ * @details Checks that the expected tables and columns exist, that the lookups the queries are
+ *   composed of use an index, and the integrity of the file with SQLite's "PRAGMA quick_check".
+ * @param database  The database to check, opened for use by the calling thread.
+ * @param warnings  Receives descriptions of problems that make the database slow, but still usable:
+ *   lookups not using an index.
+ * @return Descriptions of the problems that make the database unusable. Empty if none were found.
+ */
+QStringList DatabaseValidator::verify(QSqlDatabase database, QStringList* warnings) {
+    QStringList problems;
+
+    for (const auto& expected : expectedTables) {
+        QSqlRecord record = database.record(expected.table);
+        if (record.isEmpty()) {
+            problems << QString("Table \"%1\" is missing.").arg(expected.table);
+            continue;
+        }
+        for (const QString& column : QString(expected.columns).split(' '))
+            if (record.indexOf(column) < 0)
+                problems << QString("Column \"%1.%2\" is missing.").arg(expected.table, column);
+    }
+
+    // Only check the query plans of lookups whose tables exist, as the others would fail anyway.
+    if (problems.isEmpty()) {
+        QSqlQuery query(database);
+        QRegularExpression scan("^SCAN (TABLE )?(\\w+)");
+        for (const auto& expected : expectedPlans) {
+            if (!query.exec(QString("EXPLAIN QUERY PLAN ") + expected.query)) {
+                problems << QString("Lookup of %1 failed: %2").arg(expected.lookup, query.lastError().text());
+                continue;
+            }
+            // The last column contains the plan step description, in all SQLite versions.
+            while (query.next()) {
+                QString step = query.value(query.record().count() - 1).toString();
+                if (scan.match(step).hasMatch())
+                    *warnings << QString("Lookup of %1 does not use an index: %2").arg(expected.lookup, step);
+            }
+        }
+    }
+
+    QSqlQuery query(database);
+    if (!query.exec("PRAGMA quick_check(10)"))
+        problems << "Integrity check failed: " + query.lastError().text();
+    else {
+        QStringList messages;
+        while (query.next())
+            messages << query.value(0).toString();
+        if (messages != QStringList("ok"))
+            problems << "Integrity check failed: " + messages.join("; ");
+    }
+
+    return problems;
+}
+
+
+/**
+ * @brief Check the SQLite file header of the given database file.
+ * @details Detects files that are no SQLite databases at all, and truncated files, as can result
+ *   from an interrupted copy. Reads only the first 100 bytes of the file.
+ * @return A description of the problem found, or "" if none was found.
+ */
+QString DatabaseValidator::checkHeader(QString databaseFile) {
+    QFile file(databaseFile);
+    if (!file.open(QIODevice::ReadOnly))
+        return "Could not open the database file.";
+
+    QByteArray header = file.read(100);
+    if (header.size() < 100 || !header.startsWith(QByteArray("SQLite format 3\0", 16)))
+        return "The file is not a SQLite database.";
+
+    const uchar* data = reinterpret_cast<const uchar*>(header.constData());
+    quint32 pageSize = qFromBigEndian<quint16>(data + 16);
+    if (pageSize == 1)
+        pageSize = 65536;
+    if (pageSize < 512 || pageSize > 65536 || (pageSize & (pageSize - 1)) != 0)
+        return QString("Invalid page size %1 in the file header.").arg(pageSize);
+
+    // The page count in the header is only valid if written by the same change as the change counter.
+    quint32 changeCounter = qFromBigEndian<quint32>(data + 24);
+    quint32 pageCount = qFromBigEndian<quint32>(data + 28);
+    quint32 validFor = qFromBigEndian<quint32>(data + 92);
+    if (changeCounter == validFor && qint64(pageCount) * pageSize > file.size())
+        return QString("The file is truncated: %1 of %2 bytes present.").arg(file.size()).arg(qint64(pageCount) * pageSize);
+
+    return QString();
+}
+
+
+/**
+ * @brief Determine a fingerprint that changes whenever the given database file changes.
+ * @details Made from the file's size, modification time and header. The header contains SQLite's
+ *   change counter, so this also detects changes that keep size and modification time.
+ */
+QByteArray DatabaseValidator::fingerprint(QString databaseFile) {
+    QFileInfo info(databaseFile);
+    QFile file(databaseFile);
+    QByteArray header;
+    if (file.open(QIODevice::ReadOnly))
+        header = file.read(100);
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QByteArray properties;
+    QDataStream out(&properties, QIODevice::WriteOnly);
+    out << checksVersion << info.absoluteFilePath() << info.size() << info.lastModified().toMSecsSinceEpoch();
+    hash.addData(properties);
+    hash.addData(header);
+    return hash.result();
+}
+
+
+/**
+ * @brief Restore the results of earlier checks from the results file.
+ * @return true if saved results were restored, false otherwise.
+ */
+bool DatabaseValidator::loadResults() {
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic, format;
+    QMap<QByteArray, QString> results;
+    in >> magic >> format >> results;
+
+    if (in.status() != QDataStream::Ok || magic != resultsMagic || format != resultsFormat) {
+        qWarning() << "DatabaseValidator::loadResults: WARNING: Ignoring unreadable results file" << m_fileName;
+        return false;
+    }
+
+    m_results = results;
+    return true;
+}
+
+
+/**
+ * @brief Write the results of the checks to the results file. The file is replaced atomically.
+ * @return true on success, false otherwise.
+ */
+bool DatabaseValidator::saveResults() {
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "DatabaseValidator::saveResults: ERROR: Could not open" << m_fileName;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << resultsMagic << resultsFormat << m_results;
+
+    return file.commit();
+}
+
+
+void DatabaseValidator::storeResult(QByteArray fingerprint, QString problem) {
+    // Mostly, the results of replaced database files accumulate here. Dropping a result of a file
+    //   still in use only costs checking it once more.
+    while (m_results.size() >= maxResults && !m_results.contains(fingerprint))
+        m_results.erase(m_results.begin());
+
+    m_results.insert(fingerprint, problem);
+    saveResults();
+}
+
+
+/**
+ * @brief Check the query plans and execution times of all SQL statements of ContentDatabase.
+ * @details Guards against a content database build that loses an index, which would silently make
+ *   queries slow. Each statement of ContentDatabase::statements() is run with sample values taken
+ *   from the database. It fails the check if its query plan
+ *
+ *   - scans a table, other than the tables it scans by design,
+ *   - builds an automatic (temporary) index, which means that a needed index is missing, or
+ *   - uses a temporary B-tree for DISTINCT while scanning a large table,
+ *
+ *   or if it takes longer than its time budget. The budget grows with the rows of the tables it
+ *   scans by design, so the check works for small test databases and the full database alike.
+ * @param databaseFile  The database to check.
+ * @param out  Receives a report with one line per statement, and the query plans of failed ones.
+ * @return true if all statements passed, false otherwise.
+ */
+bool DatabaseValidator::checkQueryPlans(QString databaseFile, QTextStream& out) {
+    bool success = true;
+    const QString connectionName("DatabaseValidator-plans");
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY");
+        db.setDatabaseName(databaseFile);
+        if (!db.open()) {
+            out << "Could not open " << databaseFile << ": " << db.lastError().text() << "\n";
+            success = false;
+        }
+
+        // Row counts of all tables.
+        QHash<QString, qint64> rows;
+        QSqlQuery query(db);
+        if (success && query.exec("SELECT name FROM sqlite_master WHERE type = 'table'")) {
+            QStringList tables;
+            while (query.next())
+                tables << query.value(0).toString();
+            for (const QString& table : tables)
+                if (query.exec(QString("SELECT COUNT(*) FROM \"%1\"").arg(table)) && query.next())
+                    rows[table] = query.value(0).toLongLong();
+        }
+
+        // Sample values for the placeholders, named after the values they stand for.
+        //   The product with the most categories is used, as it has the deepest and most overlapping
+        //   category ancestry, which makes the topic queries slowest.
+        QVariantMap values;
+        if (success && query.exec(
+            "SELECT products.code FROM products "
+            "INNER JOIN product_categories ON products.id = product_categories.product_id "
+            "GROUP BY products.id ORDER BY COUNT(*) DESC LIMIT 1"
+        ) && query.next())
+            values["code"] = query.value(0);
+        if (success && query.exec("SELECT topic_id FROM topic_contents LIMIT 1") && query.next())
+            values["id"] = query.value(0);
+        if (success && query.exec("SELECT category_id, name, lang FROM category_names LIMIT 1") && query.next()) {
+            values["categoryId"] = query.value(0);
+            values["name"] = query.value(1);
+            values["lang"] = query.value(2).toString().left(2);
+        }
+        //   The category with the most children is used as parent, as its pages are slowest to sort.
+        if (success && query.exec(
+            "SELECT parent_id FROM category_structure GROUP BY parent_id ORDER BY COUNT(*) DESC LIMIT 1"
+        ) && query.next())
+            values["parentId"] = query.value(0);
+        values["afterName"] = "";
+        values["afterId"] = -1;
+        values["languageTerm"] = values["lang"].toString() + "%";
+        values["searchTerm"] = "%" + values["name"].toString().left(3) + "%";
+        values["limit"] = 10;
+        values["low"] = values["code"];
+        values["high"] = values["code"].toLongLong() + 1;
+
+        // Numbered placeholders such as :code0 and :code1 get the same value as :code.
+        QRegularExpression placeholder(":([A-Za-z]+)(\\d*)\\b");
+        auto bindValues = [&values, &placeholder](QSqlQuery& query, const QString& sql) {
+            QRegularExpressionMatchIterator i = placeholder.globalMatch(sql);
+            while (i.hasNext()) {
+                QRegularExpressionMatch match = i.next();
+                query.bindValue(match.captured(0), values.value(match.captured(1)));
+            }
+        };
+
+        QVector<SqlStatement> statements;
+        if (success)
+            statements = ContentDatabase::statements();
+
+        QRegularExpression scan("^SCAN (TABLE )?(\\w+)");
+        QRegularExpression automaticIndex("^SEARCH (TABLE )?(\\w+) USING AUTOMATIC");
+        for (const SqlStatement& statement : statements) {
+            QStringList problems;
+            QStringList plan;
+            qint64 scannedRows = 0;
+            QSet<int> largeScanLevels;    // Plan steps under which a large table is scanned.
+            QSet<int> distinctLevels;     // Plan steps under which a temporary B-tree for DISTINCT is used.
+
+            query.prepare("EXPLAIN QUERY PLAN " + statement.sql);
+            bindValues(query, statement.sql);
+            if (!query.exec())
+                problems << "Query plan not available: " + query.lastError().text();
+            while (query.next()) {
+                // The last column contains the plan step description, in all SQLite versions. Steps
+                //   are nested under a parent step since SQLite 3.24, and grouped by subquery before.
+                QSqlRecord record = query.record();
+                QString step = query.value(record.count() - 1).toString();
+                int level = query.value(record.indexOf("parent") >= 0 ? record.indexOf("parent") : 0).toInt();
+                plan << step;
+
+                QRegularExpressionMatch match = scan.match(step);
+                QString table = match.captured(2);
+                if (match.hasMatch() && rows.contains(table)) {
+                    if (!statement.scannedTables.contains(table))
+                        problems << QString("Scans table \"%1\" with %2 rows.").arg(table).arg(rows[table]);
+                    else
+                        scannedRows += rows[table];
+                    if (rows[table] > largeTableRows)
+                        largeScanLevels.insert(level);
+                }
+
+                match = automaticIndex.match(step);
+                if (match.hasMatch() && rows.contains(match.captured(2)))
+                    problems << "Builds a temporary index, so an index is missing: " + step;
+
+                if (step.startsWith("USE TEMP B-TREE FOR DISTINCT"))
+                    distinctLevels.insert(level);
+            }
+            if (distinctLevels.intersects(largeScanLevels))
+                problems << "Uses a temporary B-tree for DISTINCT on a large table.";
+
+            qint64 bestMicros = std::numeric_limits<qint64>::max();
+            for (int run = 0; run < timedRuns && problems.isEmpty(); run++) {
+                QElapsedTimer timer;
+                timer.start();
+                query.prepare(statement.sql);
+                bindValues(query, statement.sql);
+                if (!query.exec())
+                    problems << "Execution failed: " + query.lastError().text();
+                while (query.next()) { }
+                bestMicros = qMin(bestMicros, timer.nsecsElapsed() / 1000);
+            }
+            qint64 budgetMicros = baseBudgetMicros + scanBudgetMicrosPerRow * scannedRows;
+            if (problems.isEmpty() && bestMicros > budgetMicros)
+                problems << QString("Takes %1 µs, more than its budget of %2 µs.").arg(bestMicros).arg(budgetMicros);
+
+            if (problems.isEmpty())
+                out << QString("OK    %1 (%2 of %3 µs)\n").arg(statement.name).arg(bestMicros).arg(budgetMicros);
+            else {
+                out << "FAIL  " << statement.name << "\n";
+                for (const QString& problem : problems)
+                    out << "        " << problem << "\n";
+                out << "      Query plan:\n";
+                for (const QString& step : plan)
+                    out << "        " << step << "\n";
+                success = false;
+            }
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    out.flush();
+    return success;
+}
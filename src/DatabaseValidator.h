@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QMap>
+#include <QSqlDatabase>
+#include <QTextStream>
+
+class DatabaseValidator : public QObject {
+
+    Q_OBJECT
+
+public:
+    explicit DatabaseValidator(QObject* parent = 0);
+
+    QString check(QString databaseFile);
+
+    void validate(QString databaseFile);
+
+    void recordFailure(QString databaseFile, QString problem);
+
+    static QStringList verify(QSqlDatabase database, QStringList* warnings);
+
+    static QString checkHeader(QString databaseFile);
+
+    static QByteArray fingerprint(QString databaseFile);
+
+    static bool checkQueryPlans(QString databaseFile, QTextStream& out);
+
+signals:
+    void validated(QString databaseFile);
+    void failed(QString databaseFile, QString problem);
+
+private:
+    bool loadResults();
+    bool saveResults();
+    void storeResult(QByteArray fingerprint, QString problem);
+
+    QString m_fileName;
+    QMap<QByteArray, QString> m_results; // Per database fingerprint: the problem found, or "" if none.
+};
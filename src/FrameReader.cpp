@@ -0,0 +1,51 @@
+#include <QDebug>
+
+#include "FrameReader.h"
+#include "FrameRecorder.h"
+
+
+/**
+ * @brief Open a recording and check that it is of the format written by FrameRecorder.
+ * @return true on success, false if the file could not be opened or is no frame recording.
+ */
+bool FrameReader::open(QString fileName) {
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "FrameReader::open: ERROR: Could not open" << fileName << ":" << m_file.errorString();
+        return false;
+    }
+    m_in.setDevice(&m_file);
+    m_in.setVersion(QDataStream::Qt_5_12);
+
+    quint32 magic, format;
+    m_in >> magic >> format;
+    if (m_in.status() != QDataStream::Ok || magic != FrameFileMagic || format != FrameFileFormat) {
+        qWarning() << "FrameReader::open: ERROR:" << fileName << "is no frame recording of format" << FrameFileFormat;
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Read the next frame into a new frame buffer.
+ * @param frame  Where to store the frame.
+ * @param time  Where to store the frame's time, in ms since the first frame.
+ * @return false at the end of the file, or when the rest of it is damaged.
+ */
+bool FrameReader::next(QVideoFrame* frame, qint64* time) {
+    qint32 pixelFormat, width, height, bytesPerLine, bytes;
+    m_in >> *time >> pixelFormat >> width >> height >> bytesPerLine >> bytes;
+    if (m_in.status() != QDataStream::Ok || width <= 0 || height <= 0 || bytes <= 0
+        || bytes > m_file.size() - m_file.pos())
+        return false;
+
+    QVideoFrame result(bytes, QSize(width, height), bytesPerLine, QVideoFrame::PixelFormat(pixelFormat));
+    if (!result.map(QAbstractVideoBuffer::WriteOnly))
+        return false;
+    bool complete = m_in.readRawData(reinterpret_cast<char*>(result.bits()), bytes) == bytes;
+    result.unmap();
+
+    *frame = result;
+    return complete;
+}
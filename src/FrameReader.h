@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QString>
+#include <QFile>
+#include <QDataStream>
+#include <QVideoFrame>
+
+/**
+ * @brief Reads the video frames written by FrameRecorder, one by one.
+ */
+class FrameReader {
+
+public:
+    bool open(QString fileName);
+
+    bool next(QVideoFrame* frame, qint64* time);
+
+private:
+    QFile m_file;
+    QDataStream m_in;
+};
@@ -0,0 +1,122 @@
+#include <QDebug>
+#include <QtConcurrent>
+
+#include "FrameRecorder.h"
+
+
+FrameRecorder::FrameRecorder() : m_droppedFrames(0) {
+    // A single thread, so that frames are written in the order they were recorded.
+    m_writer.setMaxThreadCount(1);
+}
+
+
+FrameRecorder::~FrameRecorder() {
+    close();
+}
+
+
+/**
+ * @brief The file last given to open(), even if it could not be opened or was closed since.
+ */
+QString FrameRecorder::fileName() const {
+    return m_fileName;
+}
+
+
+bool FrameRecorder::isOpen() const {
+    return m_file.isOpen();
+}
+
+
+/**
+ * @brief Start a new recording, replacing the file's content. Closes the current recording, if any.
+ * @return true on success, false if the file could not be opened for writing.
+ */
+bool FrameRecorder::open(QString fileName) {
+    close();
+    m_fileName = fileName;
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        qWarning() << "FrameRecorder::open: ERROR: Could not open" << fileName << ":" << m_file.errorString();
+        return false;
+    }
+    m_out.setDevice(&m_file);
+    m_out.setVersion(QDataStream::Qt_5_12);
+    m_out << FrameFileMagic << FrameFileFormat;
+    m_clock.invalidate();
+    m_writeFailed.store(0);
+    m_droppedFrames = 0;
+    return true;
+}
+
+
+/**
+ * @brief Finish the current recording, if any, after writing all frames still pending.
+ */
+void FrameRecorder::close() {
+    m_writer.waitForDone();
+    if (!m_file.isOpen())
+        return;
+
+    m_out.setDevice(nullptr);
+    m_file.close();
+    if (m_droppedFrames > 0)
+        qWarning() << "FrameRecorder::close: WARNING:" << m_droppedFrames << "frames were dropped from"
+                   << m_fileName << "because the disk could not keep up.";
+}
+
+
+/**
+ * @brief Append a copy of a frame to the recording. It is written to the file on the writer thread.
+ * @return true on success, false if no recording is open, the frame could not be copied, more than
+ *   MaxPendingFrames frames are waiting to be written, or writing an earlier frame failed.
+ */
+bool FrameRecorder::record(const QVideoFrame& frame) {
+    QVideoFrame img = frame; // Shallow copy, for access to the non-const map() function.
+    if (!m_file.isOpen() || m_writeFailed.load() || !frame.isValid())
+        return false;
+
+    // The clock runs from the first frame offered, so dropped frames leave a gap in the recorded times.
+    if (!m_clock.isValid())
+        m_clock.start();
+    if (m_pendingFrames.load() >= MaxPendingFrames) {
+        ++m_droppedFrames;
+        return false;
+    }
+    if (!img.map(QAbstractVideoBuffer::ReadOnly))
+        return false;
+
+    RecordedFrame recorded;
+    recorded.time = m_clock.elapsed();
+    recorded.pixelFormat = qint32(img.pixelFormat());
+    recorded.width = img.width();
+    recorded.height = img.height();
+    recorded.bytesPerLine = img.bytesPerLine();
+    recorded.data = QByteArray(reinterpret_cast<const char*>(img.bits()), img.mappedBytes());
+    img.unmap();
+
+    m_pendingFrames.ref();
+    QtConcurrent::run(&m_writer, [this, recorded]() {
+        write(recorded);
+        m_pendingFrames.deref();
+    });
+    return true;
+}
+
+
+/**
+ * @brief Write one frame to the file. Runs on the writer thread.
+ */
+void FrameRecorder::write(const RecordedFrame& frame) {
+    if (m_writeFailed.load())
+        return;
+
+    m_out << frame.time << frame.pixelFormat << frame.width << frame.height << frame.bytesPerLine
+          << qint32(frame.data.size());
+    m_out.writeRawData(frame.data.constData(), frame.data.size());
+
+    if (m_out.status() != QDataStream::Ok) {
+        qWarning() << "FrameRecorder::write: ERROR: Could not write to" << m_fileName << ":" << m_file.errorString();
+        m_writeFailed.store(1);
+    }
+}
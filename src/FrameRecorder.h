@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QVideoFrame>
+
+/**
+ * @brief File format of recorded video frames. See FrameRecorder.
+ */
+static constexpr quint32 FrameFileMagic = 0x5A514652; // "ZQFR"
+static constexpr quint32 FrameFileFormat = 1;
+
+/**
+ * @brief Writes video frames to a file, so that scanning can be replayed and measured without a camera.
+ * @details See FrameReplay. Frames keep their native pixel format, so replaying them goes through
+ *   the same conversions as live frames. The file holds the magic and format number, then per frame
+ *   its time in ms since the first frame, its pixel format, width, height, bytes per line and the
+ *   size and content of its mapped memory. Frames are stored uncompressed, so files grow fast.
+ *
+ *   record() only copies the frame; writing it happens on a writer thread, so that a slow disk does
+ *   not slow down the video thread. Not thread-safe otherwise: open(), close() and record() are
+ *   meant to be called by one thread.
+ */
+class FrameRecorder {
+
+public:
+    // Frames copied but not yet written, above which further frames are dropped from the recording.
+    static constexpr int MaxPendingFrames = 16;
+
+    FrameRecorder();
+
+    ~FrameRecorder();
+
+    QString fileName() const;
+
+    bool isOpen() const;
+
+    bool open(QString fileName);
+
+    void close();
+
+    bool record(const QVideoFrame& frame);
+
+private:
+    // One frame as copied by record(), waiting to be written.
+    struct RecordedFrame {
+        qint64 time;
+        qint32 pixelFormat;
+        qint32 width;
+        qint32 height;
+        qint32 bytesPerLine;
+        QByteArray data;
+    };
+
+    void write(const RecordedFrame& frame);
+
+    QString m_fileName;
+    QFile m_file;        // Written by the writer thread while frames are pending.
+    QDataStream m_out;   // Written by the writer thread while frames are pending.
+    QElapsedTimer m_clock;
+
+    QThreadPool m_writer;
+    QAtomicInt m_pendingFrames;
+    QAtomicInt m_writeFailed;
+    int m_droppedFrames;
+};
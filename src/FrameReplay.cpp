@@ -0,0 +1,138 @@
+#include <QVideoSurfaceFormat>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QDebug>
+
+#include <algorithm>
+#include <memory>
+
+#include "FrameReplay.h"
+#include "FrameReader.h"
+#include "ZXingQtReader.h"
+
+
+/** @brief The value below which the given share of the sorted values lies. */
+static double percentile(const QVector<double>& sorted, double share) {
+    if (sorted.isEmpty())
+        return 0;
+    return sorted[qMin(sorted.size() - 1, int(share * sorted.size()))];
+}
+
+
+/**
+ * @brief Harness that replays recorded camera frames through the barcode scanner and measures it.
+ * @details The frames are recorded with FrameRecorder, such as by starting the application
+ *   with "--record-frames <file>" and scanning. They are replayed through the same
+ *   ZXingQt::VideoFilter and runnable as in the scanner page, with the same settings, so that
+ *   changes to the scanner can be compared reproducibly on a desktop computer.
+ *
+ *   By default, frames are replayed in real time: a frame is only processed once its recorded time
+ *   has come, and frames whose time has passed while the previous frame was still being processed
+ *   are skipped, as a camera would deliver them while the filter is busy. With maximum speed, all
+ *   frames are processed back to back.
+ */
+FrameReplay::FrameReplay() : m_maxSpeed(false) { }
+
+
+/** @brief Process all frames back to back, instead of at their recorded times. */
+void FrameReplay::setMaxSpeed(bool maxSpeed) {
+    m_maxSpeed = maxSpeed;
+}
+
+
+/**
+ * @brief Replay a frame recording and write a report of the scanner's performance.
+ * @details The report contains the per-frame decode latency, the share of frames with a detected
+ *   barcode, the time to the first detection and the barcodes found, followed by the filter's
+ *   ScanStatistics.
+ * @param fileName  The recording, as written by FrameRecorder.
+ * @param out  Where to write the report to.
+ * @return true on success, false if the recording could not be read.
+ */
+bool FrameReplay::run(QString fileName, QTextStream& out) {
+    FrameReader reader;
+    if (!reader.open(fileName))
+        return false;
+
+    // The same settings as in ScannerPage.qml.
+    ZXingQt::VideoFilter filter;
+    filter.setFormats(int(ZXingQt::BarcodeFormat::EAN13) | int(ZXingQt::BarcodeFormat::EAN8));
+    filter.setTryRotate(true);
+    filter.setTryHarder(true);
+    std::unique_ptr<QVideoFilterRunnable> runnable(filter.createFilterRunnable());
+
+    ZXingQt::Result result;
+    QObject::connect(&filter, &ZXingQt::VideoFilter::newResult, [&result](ZXingQt::Result newResult) {
+        result = newResult;
+    });
+
+    int frames = 0;
+    int skipped = 0;
+    int detected = 0;
+    qint64 firstDetection = -1;    // Recording time of the first frame with a barcode, in ms.
+    qint64 firstDetectionAt = -1;  // Replay time when it was detected, in ms.
+    QVector<double> latencies;     // Per processed frame, in ms.
+    QStringList codes;
+
+    QElapsedTimer replay;
+    replay.start();
+    filter.statistics()->reset();
+    filter.statistics()->markCameraStarted();
+
+    QVideoFrame frame;
+    qint64 time;
+    while (reader.next(&frame, &time)) {
+        frames++;
+        if (!m_maxSpeed) {
+            qint64 wait = time - replay.elapsed();
+            if (wait < 0 && frames > 1) {
+                skipped++;
+                continue;
+            }
+            if (wait > 0)
+                QThread::msleep(quint64(wait));
+        }
+
+        QElapsedTimer latency;
+        latency.start();
+        result = ZXingQt::Result();
+        runnable->run(&frame, QVideoSurfaceFormat(frame.size(), frame.pixelFormat()), QVideoFilterRunnable::RunFlags());
+        latencies << latency.nsecsElapsed() / 1e6;
+
+        if (result.isValid()) {
+            detected++;
+            if (firstDetection < 0) {
+                firstDetection = time;
+                firstDetectionAt = replay.elapsed();
+            }
+            if (!codes.contains(result.text()))
+                codes << result.text();
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    double total = 0;
+    for (double latency : latencies)
+        total += latency;
+
+    out << "recording: " << fileName << "\n";
+    out << "mode: " << (m_maxSpeed ? "maximum speed" : "real time") << "\n";
+    out << "frames: " << frames << ", processed: " << latencies.size() << ", skipped while busy: " << skipped << "\n";
+    out << "detection rate: " << detected << " of " << latencies.size() << " processed frames ("
+        << QString::number(latencies.isEmpty() ? 0.0 : 100.0 * detected / latencies.size(), 'f', 1) << " %)\n";
+    out << "decode latency (ms): mean " << QString::number(latencies.isEmpty() ? 0.0 : total / latencies.size(), 'f', 2)
+        << ", p50 " << QString::number(percentile(latencies, 0.5), 'f', 2)
+        << ", p90 " << QString::number(percentile(latencies, 0.9), 'f', 2)
+        << ", p99 " << QString::number(percentile(latencies, 0.99), 'f', 2)
+        << ", max " << QString::number(latencies.isEmpty() ? 0.0 : latencies.last(), 'f', 2) << "\n";
+    if (firstDetection < 0)
+        out << "time to first detection: -\n";
+    else
+        out << "time to first detection: " << firstDetection << " ms of recording, after " << firstDetectionAt
+            << " ms of replay\n";
+    out << "barcodes: " << codes.join(", ") << "\n";
+    out << filter.statistics()->dump();
+    out.flush();
+
+    return true;
+}
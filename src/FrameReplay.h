@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QString>
+#include <QTextStream>
+
+class FrameReplay {
+
+public:
+    FrameReplay();
+
+    void setMaxSpeed(bool maxSpeed);
+
+    bool run(QString fileName, QTextStream& out);
+
+private:
+    bool m_maxSpeed;
+};
@@ -0,0 +1,250 @@
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QSet>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "FuzzyIndex.h"
+
+
+// Bounds on the work per search, so that typing stays fast whatever the input.
+static const int maxPatternLength = 64;   // Bits in the bit vectors of distance().
+static const int maxPostingLength = 4000; // Trigrams in more names than this are too common to be selective.
+static const int maxVerifications = 400;  // Candidates for which the edit distance is computed.
+
+
+/**
+ * @brief In-memory index for typo-tolerant completion of category names.
+ * @details Finds the category names that contain a part within a small edit distance of the input,
+ *   such as "Yogurt" for "yoghurt". Candidates are selected with a trigram index first: by the
+ *   q-gram lemma, a text within edit distance k of a pattern shares at least (m - 2) - 3k of the
+ *   pattern's m - 2 trigrams, as each edit destroys at most three of them. Only the candidates are
+ *   then checked with the bit-parallel edit distance of distance().
+ *
+ *   The work per search is bounded: very common trigrams are skipped, and only the most promising
+ *   candidates are checked. So this can run on every keystroke.
+ */
+FuzzyIndex::FuzzyIndex() { }
+
+
+/**
+ * @brief Build the index from the category names of one language in the given database.
+ * @param database  An open database connection, to be used from the calling thread.
+ * @param language  The language to index, given as a two-letter language code.
+ * @return true if the index could be built, false otherwise. The index is left empty on failure.
+ */
+bool FuzzyIndex::build(QSqlDatabase database, QString language) {
+    QElapsedTimer timer;
+    timer.start();
+
+    m_language = language.left(2);
+    m_names.clear();
+    m_folded.clear();
+    m_grams.clear();
+    m_offsets.clear();
+    m_postings.clear();
+
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    query.prepare("SELECT DISTINCT name FROM category_names WHERE lang LIKE :languageTerm");
+    query.bindValue(":languageTerm", m_language + "%");
+    if (!query.exec()) {
+        qWarning() << "FuzzyIndex::build: ERROR: " << query.lastError().text();
+        return false;
+    }
+
+    std::vector<std::pair<quint64, int>> pairs;
+    while (query.next()) {
+        QString name = query.value(0).toString();
+        int number = m_names.size();
+        m_names << name;
+        m_folded << name.toCaseFolded();
+        for (quint64 gram : trigrams(m_folded.last()))
+            pairs.emplace_back(gram, number);
+    }
+
+    // Group the (trigram, name) pairs by trigram into posting lists.
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    m_postings.reserve(int(pairs.size()));
+    for (const auto& pair : pairs) {
+        if (m_grams.isEmpty() || m_grams.last() != pair.first) {
+            m_grams << pair.first;
+            m_offsets << m_postings.size();
+        }
+        m_postings << pair.second;
+    }
+    m_offsets << m_postings.size();
+
+    qDebug() << "FuzzyIndex::build: Indexed" << m_names.size() << "names of language" << m_language
+             << "with" << m_grams.size() << "trigrams in" << timer.elapsed() << "ms.";
+    return true;
+}
+
+
+/** @brief The language of the indexed names, as a two-letter language code. */
+QString FuzzyIndex::language() const {
+    return m_language;
+}
+
+
+/** @brief Determine if the index is unusable, because it has not been built successfully. */
+bool FuzzyIndex::isEmpty() const {
+    return m_names.isEmpty();
+}
+
+
+/** @brief Approximate heap memory used by the index, in bytes. */
+qint64 FuzzyIndex::memoryUsage() const {
+    qint64 bytes = (m_names.capacity() + m_folded.capacity()) * sizeof(QString)
+        + m_grams.capacity() * sizeof(quint64)
+        + (m_offsets.capacity() + m_postings.capacity()) * sizeof(int);
+    for (int i = 0; i < m_names.size(); i++)
+        bytes += (m_names[i].capacity() + m_folded[i].capacity()) * 2;
+    return bytes;
+}
+
+
+/**
+ * @brief Find the category names containing a part similar to the input.
+ * @details The allowed edit distance is 1 for inputs of up to 4 characters and 2 otherwise. Inputs
+ *   shorter than 3 characters are not searched, as almost everything is similar to them.
+ * @param input  The text to search for, case-insensitive.
+ * @param limit  Maximum number of results.
+ * @return The names, ordered by edit distance, then by length.
+ */
+QStringList FuzzyIndex::search(QString input, int limit) const {
+    QString pattern = input.simplified().toCaseFolded().left(maxPatternLength);
+    if (pattern.size() < 3 || isEmpty())
+        return QStringList();
+    int maxDistance = pattern.size() <= 4 ? 1 : 2;
+
+    // Count the trigrams each name shares with the pattern.
+    QVector<quint64> patternGrams = trigrams(pattern);
+    int threshold = patternGrams.size() - 3 * maxDistance;
+    QHash<int, int> shared;
+    for (quint64 gram : patternGrams) {
+        auto found = std::lower_bound(m_grams.constBegin(), m_grams.constEnd(), gram);
+        if (found == m_grams.constEnd() || *found != gram)
+            continue;
+
+        int i = int(found - m_grams.constBegin());
+        if (m_offsets[i + 1] - m_offsets[i] > maxPostingLength) {
+            threshold--; // The lemma still holds when not counting this trigram for any name.
+            continue;
+        }
+        for (int p = m_offsets[i]; p < m_offsets[i + 1]; p++)
+            shared[m_postings[p]]++;
+    }
+    threshold = qMax(1, threshold);
+
+    // Check the candidates sharing the most trigrams.
+    QVector<QPair<int, int>> candidates; // (shared trigrams, name number)
+    for (auto i = shared.constBegin(); i != shared.constEnd(); ++i)
+        if (i.value() >= threshold)
+            candidates << qMakePair(i.value(), i.key());
+    std::sort(candidates.begin(), candidates.end(), [](const QPair<int, int>& a, const QPair<int, int>& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    if (candidates.size() > maxVerifications)
+        candidates.resize(maxVerifications);
+
+    std::vector<std::tuple<int, int, QString>> matches; // (distance, length, name)
+    for (const QPair<int, int>& candidate : candidates) {
+        int d = distance(pattern, m_folded[candidate.second], maxDistance);
+        if (d <= maxDistance)
+            matches.emplace_back(d, m_names[candidate.second].size(), m_names[candidate.second]);
+    }
+    std::sort(matches.begin(), matches.end());
+
+    QStringList results;
+    for (const auto& match : matches) {
+        if (results.size() >= limit)
+            break;
+        results << std::get<2>(match);
+    }
+    return results;
+}
+
+
+/**
+ * @brief Determine the smallest edit distance between the pattern and any part of the text.
+ * @details Uses the bit-parallel algorithm by Myers (1999) in the formulation by Hyyrö (2001): one
+ *   column of the dynamic programming matrix is kept as vertical delta bit vectors, and a whole
+ *   column is computed with a few word operations per text character. As the distance to a
+ *   part of the text is wanted, starting anywhere in the text costs nothing, so no carry is shifted
+ *   into the horizontal deltas.
+ * @param pattern  The pattern, of at most 64 characters. Longer patterns are cut.
+ * @param text  The text to search in.
+ * @param maxDistance  Stop early and return a value above this once exceeding it is certain.
+ * @return The edit distance.
+ */
+int FuzzyIndex::distance(const QString& pattern, const QString& text, int maxDistance) {
+    const int m = qMin(pattern.size(), maxPatternLength);
+    if (m == 0)
+        return 0;
+
+    // Per character: the bit vector of its positions in the pattern.
+    quint64 asciiEq[128] = {};
+    QHash<ushort, quint64> otherEq;
+    for (int i = 0; i < m; i++) {
+        ushort c = pattern[i].unicode();
+        if (c < 128)
+            asciiEq[c] |= quint64(1) << i;
+        else
+            otherEq[c] |= quint64(1) << i;
+    }
+
+    const quint64 last = quint64(1) << (m - 1);
+    quint64 pv = ~quint64(0);
+    quint64 mv = 0;
+    int score = m;
+    int best = m;
+
+    for (int j = 0; j < text.size(); j++) {
+        ushort c = text[j].unicode();
+        quint64 eq = c < 128 ? asciiEq[c] : otherEq.value(c, 0);
+
+        quint64 xv = eq | mv;
+        quint64 xh = (((eq & pv) + pv) ^ pv) | eq;
+        quint64 ph = mv | ~(xh | pv);
+        quint64 mh = pv & xh;
+
+        if (ph & last)
+            score++;
+        else if (mh & last)
+            score--;
+
+        ph <<= 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+
+        best = qMin(best, score);
+        if (best == 0)
+            break;
+        // The score decreases by at most one per remaining character.
+        if (score - (text.size() - 1 - j) > maxDistance && best > maxDistance)
+            break;
+    }
+
+    return best;
+}
+
+
+/** @brief The distinct trigrams of a text, each packed into an integer. */
+QVector<quint64> FuzzyIndex::trigrams(const QString& text) {
+    QVector<quint64> grams;
+    for (int i = 0; i + 2 < text.size(); i++)
+        grams << (quint64(text[i].unicode()) << 32 | quint64(text[i + 1].unicode()) << 16 | text[i + 2].unicode());
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    return grams;
+}
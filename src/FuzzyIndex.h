@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class FuzzyIndex {
+
+public:
+    FuzzyIndex();
+
+    bool build(QSqlDatabase database, QString language);
+
+    QString language() const;
+
+    QStringList search(QString input, int limit) const;
+
+    bool isEmpty() const;
+
+    qint64 memoryUsage() const;
+
+    static int distance(const QString& pattern, const QString& text, int maxDistance);
+
+private:
+    static QVector<quint64> trigrams(const QString& text);
+
+    QString m_language;
+    QVector<QString> m_names;      // Original category names, unique.
+    QVector<QString> m_folded;     // Per name: the case-folded name, as matched against.
+    QVector<quint64> m_grams;      // Sorted unique trigrams of all case-folded names.
+    QVector<int> m_offsets;        // Per trigram: start of its posting list in m_postings. One extra at the end.
+    QVector<int> m_postings;       // Name numbers, grouped by trigram.
+};
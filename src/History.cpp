@@ -1,16 +1,87 @@
 #include <QObject>
 #include <QDebug>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+#include <limits>
+
 #include "History.h"
+#include "MemoryBudget.h"
+
+
+// File format identification of saved histories: "FRHI" for "Food Rescue history", and the version.
+static const quint32 historyMagic = 0x46524849;
+static const quint32 historyFormat = 1;
+
+// Default capacity until setStorage() is called.
+static const int defaultMaxItems = 100;
+
 
 /**
  * @brief Create a history object, starting with a single initial history item.
+ * @details The history has a fixed capacity of items and bytes. When adding an item to a full
+ *   history, the oldest items are dropped. Items are kept in a ring buffer, so adding, dropping
+ *   and navigating are O(1) (amortised when discarding forward history).
  * @param startItem  The item to use for the "start of history", usually equivalent to the
  *   identifier of a start screen or homepage or other page displayed before the first user action.
  * @param parent  TODO
  */
-History::History (QString startItem, QObject* parent) : QObject(parent) {
-    m_history << startItem;
-    m_currentIndex = 0;
+History::History (QString startItem, QObject* parent) : QObject(parent),
+    m_first(0), m_size(0), m_currentIndex(0), m_bytes(0), m_maxBytes(std::numeric_limits<qint64>::max()) {
+
+    m_items.resize(defaultMaxItems);
+    append(startItem);
+
+    // Saving is deferred and batched, so that navigating quickly does not write the file every time.
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(2000);
+    QObject::connect(&m_saveTimer, &QTimer::timeout, this, &History::save);
+
+    m_budgetId = MemoryBudget::instance()->registerCache("History", "items", 1, [this](qint64 bytes) {
+        return evict(bytes);
+    });
+    reportUsage();
+}
+
+/** @brief Save the history if a save is still pending. */
+History::~History() {
+    if (m_saveTimer.isActive())
+        save();
+    MemoryBudget::instance()->unregisterCache(m_budgetId);
+}
+
+/**
+ * @brief Persist the history in the given file, and restore it from there now if it exists.
+ * @param fileName  The file to save the history to. It is saved in a compact binary format.
+ * @param maxItems  Maximum number of history items to keep.
+ * @param maxBytes  Maximum total size of all history items to keep, counted as UTF-16 text.
+ */
+void History::setStorage(QString fileName, int maxItems, qint64 maxBytes) {
+    m_fileName = fileName;
+    m_maxBytes = maxBytes;
+
+    // Re-create the ring buffer with the new capacity, keeping the newest items.
+    QStringList items = history();
+    int currentIndex = m_currentIndex;
+    m_items.fill(QString(), qMax(1, maxItems));
+    m_first = m_size = 0;
+    m_bytes = 0;
+    for (const QString& item : items)
+        append(item);
+    m_currentIndex = qBound(0, currentIndex - (items.size() - m_size), m_size - 1);
+
+    if (load())
+        historyChanged();
+    reportUsage();
+}
+
+/** @brief All history items, from the oldest to the newest. */
+QStringList History::history() const {
+    QStringList items;
+    for (int i = 0; i < m_size; i++)
+        items << at(i);
+    return items;
 }
 
 /** @brief Navigate backwards in the history and return the identifier of the new current item. */
@@ -18,11 +89,12 @@ QString History::back() {
     if (backPossible()) {
         m_currentIndex--;
         historyChanged();
+        scheduleSave();
     }
     else
         qWarning() << "History::back() called but not possible.";
 
-    return m_history.at(m_currentIndex);
+    return at(m_currentIndex);
 }
 
 /** @brief Navigate forward in the history and return the identifier of the new current item. */
@@ -30,29 +102,30 @@ QString History::forward() {
     if (forwardPossible()) {
         m_currentIndex++;
         historyChanged();
+        scheduleSave();
     }
     else
         qWarning() << "History::forward() called but not possible.";
 
-    return m_history.at(m_currentIndex);
+    return at(m_currentIndex);
 }
 
 /** @brief Determine if navigating backwards in the history is possible. */
 bool History::backPossible() {
-    if (m_history.size() == 0)
+    if (m_size == 0)
         return false;
     else {
-        int lastIndex = m_history.size() - 1;
+        int lastIndex = m_size - 1;
         return m_currentIndex <= lastIndex && m_currentIndex > 0;
     }
 }
 
 /** @brief Determine if navigating forward in the history is possible. */
 bool History::forwardPossible() {
-    if (m_history.size() == 0)
+    if (m_size == 0)
         return false;
     else {
-        int lastIndex = m_history.size() - 1;
+        int lastIndex = m_size - 1;
         return m_currentIndex < lastIndex;
     }
 }
@@ -68,17 +141,24 @@ bool History::forwardPossible() {
 void History::add(QString item) {
     if (item == "") return;
 
-    // Use erase(begin, end) with pointer arithmetic to erase all elements after the current.
+    // Forget all items after the current one.
     //   Forgetting a part of the history is just like undo/redo steps: all redo steps after the
     //   first action done while navigating the undo history are thrown away to avoid branching.
-    //   See: https://doc.qt.io/archives/qt-4.8/qlist-iterator.html#operator-2b
-    m_history.erase(m_history.begin() + m_currentIndex + 1, m_history.end());
+    //   The slots are freed one by one, so the cost is amortised over the adds that filled them.
+    while (m_size > m_currentIndex + 1) {
+        int last = (m_first + m_size - 1) % m_items.size();
+        m_bytes -= m_items[last].size() * 2;
+        m_items[last].clear();
+        m_size--;
+    }
 
     if (item != current()) {
-        m_history << item;
-        m_currentIndex = m_history.size() - 1;
+        append(item);
+        m_currentIndex = m_size - 1;
     }
     historyChanged();
+    scheduleSave();
+    reportUsage();
 }
 
 /**
@@ -86,5 +166,110 @@ void History::add(QString item) {
  * @return The identifier string of the current history item.
  */
 QString History::current() {
-    return m_history.at(m_currentIndex);
+    return at(m_currentIndex);
+}
+
+/** @brief The history item at the given position, counted from the oldest item. */
+const QString& History::at(int index) const {
+    return m_items.at((m_first + index) % m_items.size());
+}
+
+/** @brief Append an item after the newest one, dropping old items to stay within capacity. */
+void History::append(QString item) {
+    if (m_size == m_items.size())
+        dropOldest();
+
+    m_items[(m_first + m_size) % m_items.size()] = item;
+    m_size++;
+    m_bytes += item.size() * 2;
+
+    while (m_bytes > m_maxBytes && m_size > 1)
+        dropOldest();
+}
+
+void History::dropOldest() {
+    m_bytes -= m_items[m_first].size() * 2;
+    m_items[m_first].clear();
+    m_first = (m_first + 1) % m_items.size();
+    m_size--;
+    m_currentIndex = qMax(0, m_currentIndex - 1);
+}
+
+/**
+ * @brief Drop the oldest history items to free memory, as requested by MemoryBudget.
+ * @details The current item and the items after it are always kept, so navigation stays intact.
+ * @return The number of bytes freed.
+ */
+qint64 History::evict(qint64 bytes) {
+    qint64 before = m_bytes;
+    while (before - m_bytes < bytes && m_currentIndex > 0)
+        dropOldest();
+
+    if (m_bytes != before) {
+        historyChanged();
+        scheduleSave();
+        reportUsage();
+    }
+    return before - m_bytes;
+}
+
+void History::reportUsage() {
+    MemoryBudget::instance()->report(m_budgetId, m_items.capacity() * sizeof(QString) + m_bytes);
+}
+
+void History::scheduleSave() {
+    if (!m_fileName.isEmpty())
+        m_saveTimer.start();
+}
+
+/**
+ * @brief Restore the history from the storage file.
+ * @return true if a saved history was restored, false otherwise.
+ */
+bool History::load() {
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic, format;
+    qint32 currentIndex;
+    QStringList items;
+    in >> magic >> format >> currentIndex >> items;
+
+    if (in.status() != QDataStream::Ok || magic != historyMagic || format != historyFormat || items.isEmpty()) {
+        qWarning() << "History::load: WARNING: Ignoring unreadable history file" << m_fileName;
+        return false;
+    }
+
+    m_items.fill(QString());
+    m_first = m_size = 0;
+    m_bytes = 0;
+    for (const QString& item : items)
+        append(item);
+    m_currentIndex = qBound(0, currentIndex - (items.size() - m_size), m_size - 1);
+
+    return true;
+}
+
+/**
+ * @brief Write the history to the storage file. The file is replaced atomically.
+ * @return true on success, false otherwise.
+ */
+bool History::save() {
+    if (m_fileName.isEmpty())
+        return false;
+
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "History::save: ERROR: Could not open" << m_fileName;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << historyMagic << historyFormat << qint32(m_currentIndex) << history();
+
+    return file.commit();
 }
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <QObject>
+#include <QStringList>
+#include <QVector>
+#include <QTimer>
 
 class History : public QObject {
 
@@ -8,16 +11,31 @@ class History : public QObject {
 
     // TODO: Maybe introduce different signals backPossibleChanged and forwardPossibleChanged, as
     //   that means fewer signal calls in total. But it's simpler this way, and no performance issue.
-    Q_PROPERTY(QStringList history MEMBER m_history      NOTIFY historyChanged)
+    Q_PROPERTY(QStringList history READ history          NOTIFY historyChanged)
     Q_PROPERTY(bool backPossible READ backPossible       NOTIFY historyChanged)
     Q_PROPERTY(bool forwardPossible READ forwardPossible NOTIFY historyChanged)
 
-    QStringList m_history;
-    int m_currentIndex;
+    // Ring buffer of history items. Item i (counted from the oldest) is at (m_first + i) % capacity.
+    QVector<QString> m_items;
+    int m_first;
+    int m_size;
+    int m_currentIndex; // Counted from the oldest item.
+    qint64 m_bytes;     // Total size of all items, in bytes of UTF-16 text.
+    qint64 m_maxBytes;
+
+    QString m_fileName;
+    QTimer m_saveTimer;
+    int m_budgetId;     // Registration with MemoryBudget.
 
 public:
     explicit History (QString startItem, QObject* parent = 0);
 
+    ~History();
+
+    void setStorage(QString fileName, int maxItems, qint64 maxBytes);
+
+    QStringList history() const;
+
     Q_INVOKABLE // Allows to invoke this method from QML.
     QString back();
 
@@ -38,4 +56,14 @@ public:
 
 signals:
     void historyChanged();
+
+private:
+    const QString& at(int index) const;
+    void append(QString item);
+    void dropOldest();
+    qint64 evict(qint64 bytes);
+    void reportUsage();
+    void scheduleSave();
+    bool load();
+    bool save();
 };
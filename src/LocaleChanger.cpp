@@ -71,4 +71,8 @@ void LocaleChanger::changeLocale(QString locale) {
     //   installTranslator() above, as per https://forum.qt.io/post/276252 . Maybe the engine then passes
     //   it to other QML components, allowing them to react as well.
     engine->retranslate();
+
+    // Let C++ components adapt their language-specific data. This is the language actually in use
+    // now, which may be the English fallback.
+    localeChanged(QLocale().name().left(2));
 }
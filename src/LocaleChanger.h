@@ -13,6 +13,9 @@ public:
     Q_INVOKABLE
     void changeLocale(QString language);
 
+signals:
+    void localeChanged(QString language);
+
 private:
     QQmlEngine* engine;
     QString pathPrefix;
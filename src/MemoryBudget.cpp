@@ -0,0 +1,197 @@
+#include <QDebug>
+#include <QMetaObject>
+#include <QVector>
+
+#include <algorithm>
+
+#include "MemoryBudget.h"
+
+
+/**
+ * @brief One memory budget shared by all caches, buffers and indexes of the application.
+ * @details Every cache registers itself with an eviction callback and reports its memory usage
+ *   whenever that changes. When the total usage exceeds the limit, caches are asked to free memory,
+ *   starting with those that are cheapest to rebuild per byte, and among equally cheap ones with the
+ *   largest. So on low-RAM devices, one limit governs all caches, and memory goes to the caches
+ *   where it saves the most work.
+ *
+ *   Reporting is thread-safe. Eviction always happens on the main thread, in a queued call after
+ *   the report that exceeded the limit, so eviction callbacks must be safe to call from there.
+ */
+MemoryBudget::MemoryBudget(QObject* parent) : QObject(parent),
+    m_nextId(1), m_limit(64 * 1024 * 1024), m_usage(0), m_enforcePending(false) { }
+
+
+// The application's memory budget, see create().
+static MemoryBudget* budgetInstance = nullptr;
+
+
+/**
+ * @brief Create the application's memory budget. Call once in main(), before anything uses it.
+ * @details The budget lives in the main thread, where enforce() must run, and is destroyed with
+ *   the application object, while the event loop and thread data still exist.
+ * @param application  The application object, which becomes the parent of the budget.
+ */
+MemoryBudget* MemoryBudget::create(QObject* application) {
+    Q_ASSERT(!budgetInstance);
+    budgetInstance = new MemoryBudget(application);
+    return budgetInstance;
+}
+
+
+/** @brief The application's memory budget. Thread-safe once created, see create(). */
+MemoryBudget* MemoryBudget::instance() {
+    Q_ASSERT_X(budgetInstance, "MemoryBudget::instance", "MemoryBudget::create() was not called in main()");
+    return budgetInstance;
+}
+
+
+MemoryBudget::~MemoryBudget() {
+    if (budgetInstance == this)
+        budgetInstance = nullptr;
+}
+
+
+/**
+ * @brief Register a cache. Thread-safe.
+ * @param subsystem  The application part owning the cache, such as "ContentDatabase".
+ * @param name  The name of the cache within its subsystem.
+ * @param rebuildCost  Relative cost per byte of recreating evicted data, from 1 (a buffer that is
+ *   simply allocated again) to 10 (an index rebuilt with a database query).
+ * @param evictor  Called on the main thread to free memory. It should also report() the new usage.
+ *   Empty for memory that is counted in the budget but cannot be freed, such as a scratch buffer
+ *   needed again by the very next frame.
+ * @return An identifier for reporting usage and for unregistering.
+ */
+int MemoryBudget::registerCache(QString subsystem, QString name, int rebuildCost, Evictor evictor) {
+    QMutexLocker locker(&m_mutex);
+    int id = m_nextId++;
+    m_caches.insert(id, Cache{subsystem, name, rebuildCost, evictor, 0});
+    return id;
+}
+
+
+/** @brief Unregister a cache, such as when destroying its owner. Thread-safe. */
+void MemoryBudget::unregisterCache(int id) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_caches.contains(id))
+            return;
+        m_usage -= m_caches[id].usage;
+        m_caches.remove(id);
+    }
+    usageChanged();
+}
+
+
+/**
+ * @brief Report the current memory usage of a cache. Thread-safe.
+ * @param id  The identifier returned by registerCache().
+ * @param bytes  The total memory now used by the cache.
+ */
+void MemoryBudget::report(int id, qint64 bytes) {
+    bool enforce = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_caches.contains(id) || m_caches[id].usage == bytes)
+            return;
+        m_usage += bytes - m_caches[id].usage;
+        m_caches[id].usage = bytes;
+
+        if (m_usage > m_limit && !m_enforcePending) {
+            m_enforcePending = true;
+            enforce = true;
+        }
+    }
+
+    usageChanged();
+    if (enforce)
+        QMetaObject::invokeMethod(this, "enforce", Qt::QueuedConnection);
+}
+
+
+/** @brief The maximum memory to be used by all registered caches together, in bytes. */
+qint64 MemoryBudget::limit() const {
+    QMutexLocker locker(&m_mutex);
+    return m_limit;
+}
+
+
+void MemoryBudget::setLimit(qint64 bytes) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (bytes == m_limit)
+            return;
+        m_limit = bytes;
+    }
+    limitChanged();
+    QMetaObject::invokeMethod(this, "enforce", Qt::QueuedConnection);
+}
+
+
+/** @brief The memory currently used by all registered caches together, in bytes. */
+qint64 MemoryBudget::usage() const {
+    QMutexLocker locker(&m_mutex);
+    return m_usage;
+}
+
+
+/** @brief The memory currently used per subsystem, in bytes, keyed by subsystem name. */
+QVariantMap MemoryBudget::usageBySubsystem() const {
+    QMutexLocker locker(&m_mutex);
+    QMap<QString, qint64> usage;
+    for (const Cache& cache : m_caches)
+        usage[cache.subsystem] += cache.usage;
+
+    QVariantMap result;
+    for (auto i = usage.constBegin(); i != usage.constEnd(); ++i)
+        result[i.key()] = i.value();
+    return result;
+}
+
+
+/** @brief Describe the usage of every cache, for diagnostics. */
+QString MemoryBudget::dump() const {
+    QMutexLocker locker(&m_mutex);
+    QString text = QString("Memory budget: %1 of %2 KiB used\n").arg(m_usage / 1024).arg(m_limit / 1024);
+    for (const Cache& cache : m_caches)
+        text += QString("  %1.%2: %3 KiB (rebuild cost %4)\n")
+            .arg(cache.subsystem, cache.name).arg(cache.usage / 1024).arg(cache.rebuildCost);
+    return text;
+}
+
+
+/**
+ * @brief Evict cache contents until the usage is within the limit again.
+ */
+void MemoryBudget::enforce() {
+    struct Candidate { int id; int rebuildCost; qint64 usage; Evictor evictor; };
+    QVector<Candidate> candidates;
+    qint64 excess;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_enforcePending = false;
+        excess = m_usage - m_limit;
+        for (auto i = m_caches.constBegin(); i != m_caches.constEnd(); ++i)
+            if (i.value().usage > 0 && i.value().evictor)
+                candidates << Candidate{i.key(), i.value().rebuildCost, i.value().usage, i.value().evictor};
+    }
+    if (excess <= 0)
+        return;
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.rebuildCost != b.rebuildCost ? a.rebuildCost < b.rebuildCost : a.usage > b.usage;
+    });
+
+    // Evictors are called without holding the lock, as they report their new usage.
+    for (const Candidate& candidate : candidates) {
+        if (excess <= 0)
+            break;
+        qint64 freed = candidate.evictor(qMin(excess, candidate.usage));
+        excess -= freed;
+        qDebug() << "MemoryBudget::enforce: Cache" << candidate.id << "freed" << freed / 1024 << "KiB.";
+    }
+
+    if (excess > 0)
+        qWarning() << "MemoryBudget::enforce: WARNING: Still" << excess / 1024 << "KiB over the limit.";
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QObject>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+
+#include <functional>
+
+class MemoryBudget : public QObject {
+
+    Q_OBJECT
+    Q_PROPERTY(qint64 limit READ limit WRITE setLimit NOTIFY limitChanged)
+    Q_PROPERTY(qint64 usage READ usage NOTIFY usageChanged)
+    Q_PROPERTY(QVariantMap usageBySubsystem READ usageBySubsystem NOTIFY usageChanged)
+
+public:
+    // Called with the number of bytes to free. Returns the number of bytes actually freed.
+    typedef std::function<qint64(qint64 bytes)> Evictor;
+
+    static MemoryBudget* create(QObject* application);
+
+    static MemoryBudget* instance();
+
+    ~MemoryBudget();
+
+    int registerCache(QString subsystem, QString name, int rebuildCost, Evictor evictor);
+
+    void unregisterCache(int id);
+
+    void report(int id, qint64 bytes);
+
+    qint64 limit() const;
+
+    void setLimit(qint64 bytes);
+
+    qint64 usage() const;
+
+    QVariantMap usageBySubsystem() const;
+
+    Q_INVOKABLE
+    QString dump() const;
+
+signals:
+    void limitChanged();
+    void usageChanged();
+
+private:
+    explicit MemoryBudget(QObject* parent = 0);
+
+    Q_INVOKABLE void enforce();
+
+    struct Cache {
+        QString subsystem;
+        QString name;
+        int rebuildCost;
+        Evictor evictor;
+        qint64 usage;
+    };
+
+    mutable QMutex m_mutex;
+    QMap<int, Cache> m_caches;
+    int m_nextId;
+    qint64 m_limit;
+    qint64 m_usage;
+    bool m_enforcePending;
+};
@@ -0,0 +1,254 @@
+#include <QDebug>
+#include <QPolygon>
+
+#include <algorithm>
+#include <cstring>
+
+#include "MultiScanner.h"
+#include "ScanlineEanReader.h"
+#include "ZXingQtReader.h"
+
+
+/**
+ * @brief The region to mask for a found barcode: its bounding box plus a quiet zone.
+ * @details Linear barcodes are located by the scan lines that decoded them, so their box can be
+ *   just a few rows high. It is extended up and down by the barcode's width then, which covers
+ *   the bars of all common linear formats.
+ * @param result  The barcode, with its position in frame coordinates.
+ */
+static QRect maskOf(const ZXingQt::Result& result) {
+    const ZXingQt::Position& p = result.position();
+    QRect box = QPolygon(QVector<QPoint>{p.topLeft(), p.topRight(), p.bottomRight(), p.bottomLeft()})
+        .boundingRect();
+
+    int margin = box.width() / 10;
+    if (box.height() < box.width() / 2)
+        return box.adjusted(-margin, -box.width(), margin, box.width());
+    return box.adjusted(-margin, -margin, margin, margin);
+}
+
+
+/**
+ * @brief The distance in bytes between two pixels of a row, as read by zxing.
+ */
+static int bytesPerPixel(ZXing::ImageFormat fmt, int pixStride) {
+    using ZXing::ImageFormat;
+
+    if (pixStride > 0)
+        return pixStride;
+    switch (fmt) {
+    case ImageFormat::RGB:
+    case ImageFormat::BGR:
+        return 3;
+    case ImageFormat::RGBX:
+    case ImageFormat::XRGB:
+    case ImageFormat::BGRX:
+    case ImageFormat::XBGR:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+
+/**
+ * @brief Search one frame for barcodes and collect the ones not seen recently for the next batch.
+ * @param frame  The video frame to search.
+ * @param hints  The barcode formats etc. to search for.
+ * @param dropped  Set to whether the frame could not be searched at all, see ZXingQt::ReadBarcode().
+ * @param conversionBuffer  For frames in pixel formats that zxing cannot read, see ZXingQt::ReadBarcode().
+ * @return The first barcode decoded in the frame, if any. Its position is in frame coordinates.
+ *   Tracked barcodes are masked and so not decoded again until their tracking ends.
+ */
+ZXingQt::Result MultiScanner::scan(const QVideoFrame& frame, const ZXing::DecodeHints& hints, bool* dropped,
+                                   QImage* conversionBuffer) {
+    if (!m_clock.isValid())
+        m_clock.start();
+    const qint64 now = m_clock.elapsed();
+
+    // Barcodes whose tracking ends are searched for again in this frame, confirming their position.
+    QVector<QRect> masks;
+    for (auto i = m_tracked.begin(); i != m_tracked.end(); ) {
+        if (--i->framesLeft < 0) {
+            i = m_tracked.erase(i);
+        }
+        else {
+            masks << i->mask;
+            ++i;
+        }
+    }
+
+    QVector<ZXingQt::Result> results = readStrips(frame, hints, masks, dropped, conversionBuffer);
+
+    ZXingQt::Result first;
+    for (const ZXingQt::Result& result : results) {
+        if (!first.isValid())
+            first = result;
+
+        auto seen = m_seen.constFind(result.text());
+        bool isNew = seen == m_seen.constEnd() || now - seen.value() > SeenTtlMs;
+        if (isNew && !m_pending.contains(result.text()))
+            m_pending << result.text();
+        m_seen[result.text()] = now;
+
+        // Track the barcode at its new position, replacing where it was tracked before.
+        auto tracked = std::find_if(m_tracked.begin(), m_tracked.end(), [&result](const Tracked& t) {
+            return t.text == result.text();
+        });
+        if (tracked != m_tracked.end())
+            *tracked = Tracked{result.text(), maskOf(result), TrackFrames};
+        else
+            m_tracked << Tracked{result.text(), maskOf(result), TrackFrames};
+    }
+
+    // Forget barcodes not seen for a while, so they count as new when seen again. Tracked barcodes
+    //   are not searched for, so they count as seen.
+    for (const Tracked& tracked : m_tracked)
+        m_seen[tracked.text] = now;
+    for (auto i = m_seen.begin(); i != m_seen.end(); ) {
+        if (now - i.value() > SeenTtlMs)
+            i = m_seen.erase(i);
+        else
+            ++i;
+    }
+
+    return first;
+}
+
+
+/**
+ * @brief Take the barcodes found since the last batch, if BatchIntervalMs has passed since then.
+ * @return The barcode texts, in the order they were found. Empty if there are none yet, or if the
+ *   last batch was taken less than BatchIntervalMs ago.
+ */
+QStringList MultiScanner::takeBatch() {
+    if (m_pending.isEmpty() || m_clock.elapsed() - m_lastBatch < BatchIntervalMs)
+        return QStringList();
+
+    QStringList batch = m_pending;
+    m_pending.clear();
+    m_lastBatch = m_clock.elapsed();
+    return batch;
+}
+
+
+/**
+ * @brief Search the strips of a video frame for barcodes, up to MaxPerStrip per strip.
+ * @details Strip i spans 2/(n+1) of the frame height, starting at i/(n+1) of it, where n is the
+ *   number of strips. Each barcode found is added to the masks, so searching a strip again, and
+ *   the overlapping next strip, finds the other barcodes.
+ * @param masks  Regions not to search, in frame coordinates. Extended by the barcodes found.
+ * @return The barcodes found, with positions in frame coordinates. For the other parameters, see scan().
+ */
+QVector<ZXingQt::Result> MultiScanner::readStrips(const QVideoFrame& frame, const ZXing::DecodeHints& hints,
+                                                  QVector<QRect>& masks, bool* dropped,
+                                                  QImage* conversionBuffer) {
+    using ZXing::ImageFormat;
+
+    QVector<ZXingQt::Result> results;
+    if (dropped)
+        *dropped = true;
+
+    QVideoFrame img = frame; // Shallow copy, for access to the non-const map() function.
+    if (!frame.isValid() || !img.map(QAbstractVideoBuffer::ReadOnly)) {
+        qWarning() << "MultiScanner::readStrips: ERROR: Could not map the video frame into memory.";
+        return results;
+    }
+
+    ImageFormat fmt = ImageFormat::None;
+    int pixStride = 0;
+    int pixOffset = 0;
+    ZXingQt::ImageFormatFromVideoFrame(img.pixelFormat(), fmt, pixStride, pixOffset);
+
+    const uchar* bits = img.bits() + pixOffset;
+    const uchar* end = img.bits() + img.mappedBytes();
+    int rowStride = img.bytesPerLine();
+    if (fmt == ImageFormat::None) {
+        QImage::Format qfmt = QVideoFrame::imageFormatFromPixelFormat(img.pixelFormat());
+        if (qfmt == QImage::Format_Invalid || !conversionBuffer) {
+            img.unmap();
+            return results;
+        }
+        ZXingQt::ConvertToRGBX(QImage(img.bits(), img.width(), img.height(), img.bytesPerLine(), qfmt),
+                               *conversionBuffer);
+        bits = conversionBuffer->constBits();
+        end = bits + conversionBuffer->sizeInBytes();
+        rowStride = conversionBuffer->bytesPerLine();
+        fmt = ImageFormat::RGBX;
+        pixStride = 0;
+    }
+
+    const bool fastPath = fmt == ImageFormat::Lum && ScanlineEanReader::supports(hints);
+    const int pixelBytes = bytesPerPixel(fmt, pixStride);
+    const int stripHeight = 2 * img.height() / (StripCount + 1);
+    for (int i = 0; i < StripCount; i++) {
+        const int top = i * img.height() / (StripCount + 1);
+        const QRect strip(0, top, img.width(), stripHeight);
+
+        QStringList found;
+        for (int attempt = 0; attempt < MaxPerStrip; attempt++) {
+            const uchar* stripBits = maskedStrip(bits + top * rowStride, end - (bits + top * rowStride), strip,
+                                                 rowStride, pixelBytes, masks);
+            ZXingQt::Result result;
+            if (fastPath) {
+                result = ZXingQt::Result(ScanlineEanReader::read(stripBits, img.width(), stripHeight, rowStride,
+                                                                 pixStride, hints));
+                result.fastPath = result.isValid();
+            }
+            if (!result.isValid())
+                result = ZXingQt::Result(ZXing::ReadBarcode(
+                    {stripBits, img.width(), stripHeight, fmt, rowStride, pixStride}, hints
+                ));
+
+            // Finding a barcode again means its mask did not cover it, so searching on would not help.
+            if (!result.isValid() || found.contains(result.text()))
+                break;
+            found << result.text();
+            result.translate(0, top);
+            masks << maskOf(result);
+            results << result;
+        }
+    }
+
+    img.unmap();
+    if (dropped)
+        *dropped = false;
+
+    return results;
+}
+
+
+/**
+ * @brief Provide the pixels of a strip with the masked regions painted white.
+ * @param bits  The first pixel of the strip.
+ * @param availableBytes  The bytes readable from bits on, to not copy beyond the end of the frame.
+ * @param strip  The strip, in frame coordinates.
+ * @param masks  The regions to mask, in frame coordinates.
+ * @return bits itself if no region overlaps the strip, else a masked copy in m_maskBuffer with the
+ *   same row stride. Valid until the next call.
+ */
+const uchar* MultiScanner::maskedStrip(const uchar* bits, qint64 availableBytes, QRect strip, int rowStride,
+                                       int bytesPerPixel, const QVector<QRect>& masks) {
+    bool masked = std::any_of(masks.begin(), masks.end(), [&strip](const QRect& mask) {
+        return mask.intersects(strip);
+    });
+    if (!masked)
+        return bits;
+
+    const qint64 bytes = qMin(qint64(rowStride) * strip.height(), availableBytes);
+    if (m_maskBuffer.size() < qint64(rowStride) * strip.height())
+        m_maskBuffer.resize(rowStride * strip.height());
+    std::memcpy(m_maskBuffer.data(), bits, size_t(bytes));
+
+    for (const QRect& mask : masks) {
+        QRect region = mask.intersected(strip).translated(0, -strip.top());
+        for (int y = region.top(); y <= region.bottom(); y++) {
+            qint64 start = qint64(y) * rowStride + qint64(region.left()) * bytesPerPixel;
+            qint64 length = qMin(qint64(region.width()) * bytesPerPixel, bytes - start);
+            if (length > 0)
+                std::memset(m_maskBuffer.data() + start, 0xFF, size_t(length));
+        }
+    }
+
+    return reinterpret_cast<const uchar*>(m_maskBuffer.constData());
+}
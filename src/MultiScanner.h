@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QByteArray>
+#include <QImage>
+#include <QRect>
+#include <QElapsedTimer>
+#include <QVideoFrame>
+
+#include <ZXing/DecodeHints.h>
+
+namespace ZXingQt { class Result; }
+
+/**
+ * @brief Continuous scanning of multiple barcodes per video frame, as used by ZXingQt::VideoFilter.
+ * @details Each frame is searched in StripCount overlapping horizontal strips. zxing finds one
+ *   barcode per search, and always the same one of several side by side. So after every hit, the
+ *   region of the barcode found is masked (painted white) in a copy of the strip, and the strip is
+ *   searched again, up to MaxPerStrip times. Barcodes standing side by side, as on crates and
+ *   shelves, are thus all found in the same frame.
+ *
+ *   The position of every barcode found is tracked for TrackFrames frames, during which its region
+ *   is masked before searching, so known barcodes do not cost decode time. After that the barcode
+ *   is searched for again, which confirms or updates its position. Independently, each barcode text
+ *   is reported once until it was not seen for SeenTtlMs.
+ *
+ *   Not thread-safe. Meant to be used by the video thread only.
+ */
+class MultiScanner {
+
+public:
+    static constexpr int StripCount = 4;        // Horizontal strips each frame is searched in.
+    static constexpr int MaxPerStrip = 3;       // Barcodes searched for per strip and frame.
+    static constexpr int TrackFrames = 8;       // Frames a found barcode's region stays masked.
+    static constexpr int SeenTtlMs = 3000;      // Time after which a barcode counts as new again when not seen.
+    static constexpr int BatchIntervalMs = 500; // Minimum time between two batches, see takeBatch().
+
+    ZXingQt::Result scan(const QVideoFrame& frame, const ZXing::DecodeHints& hints, bool* dropped,
+                         QImage* conversionBuffer);
+
+    QStringList takeBatch();
+
+private:
+    struct Tracked {
+        QString text;
+        QRect mask;     // Region to mask, in frame coordinates. See maskOf().
+        int framesLeft; // Frames until the barcode is searched for again.
+    };
+
+    QVector<ZXingQt::Result> readStrips(const QVideoFrame& frame, const ZXing::DecodeHints& hints,
+                                        QVector<QRect>& masks, bool* dropped, QImage* conversionBuffer);
+    const uchar* maskedStrip(const uchar* bits, qint64 availableBytes, QRect strip, int rowStride,
+                             int bytesPerPixel, const QVector<QRect>& masks);
+
+    QElapsedTimer m_clock;
+    QVector<Tracked> m_tracked;    // Barcodes whose regions are masked.
+    QHash<QString, qint64> m_seen; // Barcode text → time last seen, in ms of m_clock.
+    QStringList m_pending;         // New barcodes for the next batch.
+    qint64 m_lastBatch = 0;
+    QByteArray m_maskBuffer;       // Copy of the strip being searched, with masked regions. Reused across frames.
+};
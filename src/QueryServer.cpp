@@ -0,0 +1,243 @@
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QPointer>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <QDebug>
+
+#include "QueryServer.h"
+
+
+// Limits protecting the server from misbehaving clients.
+static const int maxRequestBytes = 1024 * 1024;
+static const int maxPendingRequests = 32; // Per client. Further requests wait in the socket buffer.
+
+
+/**
+ * @brief Serves the lookups of the application to other processes on the same device, via a local
+ *   socket (a Unix domain socket or Windows named pipe).
+ * @details So co-located clients such as point-of-sale terminals and label printers use the same
+ *   database, indexes and renderer as the application, without a network.
+ *
+ *   Protocol: every request and response is one frame, consisting of the length of its payload
+ *   as a 4 byte big-endian unsigned integer, followed by the payload, a UTF-8 encoded JSON object.
+ *   A request is {"id": …, "method": "…", "params": {…}}; its response is {"id": …, "result": …}
+ *   or {"id": …, "error": "…"}, with the id copied from the request.
+ *
+ *   Methods:
+ *   - normalize {searchTerm} → the normalized search term
+ *   - complete {fragments, language, limit = 10} → array of category names
+ *   - content {searchTerm, language, format = "html" | "docbook"} → the content document
+ *   - lookup {barcodes, language} → object mapping each barcode to an array of its category names
+ *   - statistics {} → request counts and latencies per method, see statistics()
+ *
+ *   Requests may be pipelined: a client can send many requests without waiting for responses.
+ *   They are executed concurrently by a fixed pool of worker threads, each with its own database
+ *   connection, so responses can arrive in a different order than the requests and have to be
+ *   matched by their id.
+ */
+QueryServer::QueryServer(ContentDatabase* database, QObject* parent) : QObject(parent),
+    m_database(database) {
+
+    QObject::connect(&m_server, &QLocalServer::newConnection, this, &QueryServer::acceptConnections);
+}
+
+
+QueryServer::~QueryServer() {
+    m_server.close();
+    m_workers.waitForDone();
+}
+
+
+/**
+ * @brief Start listening for clients.
+ * @param name  The name of the local socket. A stale socket of that name is removed.
+ * @param workers  Number of worker threads executing requests.
+ * @return true on success, false otherwise.
+ */
+bool QueryServer::listen(QString name, int workers) {
+    // Worker threads are kept for the lifetime of the server, as each has its own database connection.
+    m_workers.setMaxThreadCount(qMax(1, workers));
+    m_workers.setExpiryTimeout(-1);
+
+    QLocalServer::removeServer(name);
+    if (!m_server.listen(name)) {
+        qWarning() << "QueryServer::listen: ERROR: Could not listen on" << name << ":" << m_server.errorString();
+        return false;
+    }
+
+    qDebug() << "QueryServer::listen: Serving on" << m_server.fullServerName() << "with"
+             << m_workers.maxThreadCount() << "workers.";
+    return true;
+}
+
+
+/**
+ * @brief Request statistics since the server was started. Thread-safe.
+ * @return An object with one entry per method, each with the number of requests, the number of
+ *   failed requests, and the mean and maximum latency in microseconds. Latency is measured from
+ *   receiving a request to sending its response, so it includes waiting for a free worker.
+ */
+QJsonObject QueryServer::statistics() const {
+    QMutexLocker locker(&m_statisticsMutex);
+    QJsonObject result;
+    for (auto i = m_statistics.constBegin(); i != m_statistics.constEnd(); ++i) {
+        const MethodStatistics& statistics = i.value();
+        result[i.key()] = QJsonObject {
+            {"count", statistics.count},
+            {"errors", statistics.errors},
+            {"meanMicros", statistics.count > 0 ? statistics.totalMicros / statistics.count : 0},
+            {"maxMicros", statistics.maxMicros}
+        };
+    }
+    return result;
+}
+
+
+void QueryServer::acceptConnections() {
+    while (QLocalSocket* socket = m_server.nextPendingConnection()) {
+        m_clients.insert(socket, Client());
+
+        QObject::connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            readRequests(socket);
+        });
+        QObject::connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            m_clients.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+
+/**
+ * @brief Parse the complete requests received from a client and hand them to the workers.
+ * @details Parsing pauses while the client has maxPendingRequests requests in execution, and
+ *   continues when responses have been sent.
+ */
+void QueryServer::readRequests(QLocalSocket* socket) {
+    if (!m_clients.contains(socket))
+        return;
+
+    Client& client = m_clients[socket];
+    client.buffer.append(socket->readAll());
+
+    while (client.pending < maxPendingRequests && client.buffer.size() >= 4) {
+        quint32 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(client.buffer.constData()));
+        if (length > quint32(maxRequestBytes)) {
+            qWarning() << "QueryServer::readRequests: ERROR: Request of" << length << "bytes too large. Disconnecting.";
+            socket->abort();
+            return;
+        }
+        if (quint32(client.buffer.size()) < 4 + length)
+            break;
+
+        QElapsedTimer received;
+        received.start();
+        QByteArray payload = client.buffer.mid(4, length);
+        client.buffer.remove(0, 4 + length);
+
+        QJsonParseError parseError;
+        QJsonObject request = QJsonDocument::fromJson(payload, &parseError).object();
+        if (parseError.error != QJsonParseError::NoError) {
+            QJsonObject response {{"id", QJsonValue()}, {"error", "Invalid JSON: " + parseError.errorString()}};
+            writeResponse(socket, response);
+            record("invalid", received.nsecsElapsed() / 1000, true);
+            continue;
+        }
+
+        client.pending++;
+        QPointer<QLocalSocket> target(socket);
+        QtConcurrent::run(&m_workers, [this, target, request, received]() {
+            QJsonObject response = execute(request);
+            QString method = request["method"].toString();
+
+            // Sockets may only be used by their own thread, so the response is sent from there.
+            QMetaObject::invokeMethod(this, [this, target, response, method, received]() {
+                if (target)
+                    sendResponse(target, response, method, received);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+
+/** @brief Send the response to an executed request, and continue parsing the client's requests. */
+void QueryServer::sendResponse(QLocalSocket* socket, QJsonObject response, QString method, QElapsedTimer received) {
+    writeResponse(socket, response);
+    record(method, received.nsecsElapsed() / 1000, response.contains("error"));
+
+    if (m_clients.contains(socket)) {
+        m_clients[socket].pending--;
+        if (!m_clients[socket].buffer.isEmpty())
+            readRequests(socket);
+    }
+}
+
+
+void QueryServer::writeResponse(QLocalSocket* socket, const QJsonObject& response) {
+    QByteArray payload = QJsonDocument(response).toJson(QJsonDocument::Compact);
+    uchar length[4];
+    qToBigEndian<quint32>(quint32(payload.size()), length);
+    socket->write(reinterpret_cast<const char*>(length), 4);
+    socket->write(payload);
+}
+
+
+/**
+ * @brief Execute one request. Called on a worker thread.
+ * @return The response to the request.
+ */
+QJsonObject QueryServer::execute(const QJsonObject& request) {
+    QString method = request["method"].toString();
+    QJsonObject params = request["params"].toObject();
+    QString language = params["language"].toString().left(2);
+
+    QJsonObject response {{"id", request["id"]}};
+
+    if (method == "normalize") {
+        response["result"] = m_database->normalize(params["searchTerm"].toString());
+    }
+    else if (method == "complete") {
+        QString fragments = params["fragments"].toString().simplified();
+        int limit = params["limit"].toInt(10);
+        response["result"] = QJsonArray::fromStringList(
+            fragments.isEmpty() ? QStringList() : ContentDatabase::queryCompletions(fragments, language, limit)
+        );
+    }
+    else if (method == "content") {
+        ContentFormat format = params["format"].toString() == "docbook" ? ContentFormat::DOCBOOK : ContentFormat::HTML;
+        QString searchTerm = m_database->normalize(params["searchTerm"].toString());
+        response["result"] = m_database->content(searchTerm, language, format);
+    }
+    else if (method == "lookup") {
+        QStringList codes;
+        for (const QJsonValue& barcode : params["barcodes"].toArray())
+            codes << m_database->normalize(barcode.toString());
+
+        // All barcodes with one statement, instead of one statement per barcode.
+        QJsonObject result;
+        for (const QVariant& item : m_database->lookupBatch(codes, language)) {
+            QVariantMap product = item.toMap();
+            result[product["barcode"].toString()] = QJsonArray::fromStringList(product["categories"].toStringList());
+        }
+        response["result"] = result;
+    }
+    else if (method == "statistics") {
+        response["result"] = statistics();
+    }
+    else {
+        response["error"] = QString("Unknown method \"%1\".").arg(method);
+    }
+
+    return response;
+}
+
+
+void QueryServer::record(QString method, qint64 micros, bool error) {
+    QMutexLocker locker(&m_statisticsMutex);
+    MethodStatistics& statistics = m_statistics[method];
+    statistics.count++;
+    statistics.errors += error ? 1 : 0;
+    statistics.totalMicros += micros;
+    statistics.maxMicros = qMax(statistics.maxMicros, micros);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QThreadPool>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+
+#include "ContentDatabase.h"
+
+class QueryServer : public QObject {
+
+    Q_OBJECT
+
+public:
+    explicit QueryServer(ContentDatabase* database, QObject* parent = 0);
+
+    ~QueryServer();
+
+    bool listen(QString name, int workers);
+
+    QJsonObject statistics() const;
+
+private:
+    struct Client {
+        QByteArray buffer;  // Received data not yet parsed into requests.
+        int pending = 0;    // Requests being executed.
+    };
+
+    struct MethodStatistics {
+        qint64 count = 0;
+        qint64 errors = 0;
+        qint64 totalMicros = 0;
+        qint64 maxMicros = 0;
+    };
+
+    void acceptConnections();
+    void readRequests(QLocalSocket* socket);
+    void sendResponse(QLocalSocket* socket, QJsonObject response, QString method, QElapsedTimer received);
+    void writeResponse(QLocalSocket* socket, const QJsonObject& response);
+    QJsonObject execute(const QJsonObject& request);
+    void record(QString method, qint64 micros, bool error);
+
+    ContentDatabase* m_database;
+    QLocalServer m_server;
+    QThreadPool m_workers;
+    QHash<QLocalSocket*, Client> m_clients;
+
+    mutable QMutex m_statisticsMutex;
+    QMap<QString, MethodStatistics> m_statistics;
+};
@@ -0,0 +1,143 @@
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QtConcurrent>
+#include <QDebug>
+
+#include "RenderCache.h"
+
+
+// File format identification of cache files: "FRRC" for "Food Rescue render cache", and the version.
+static const quint32 renderCacheMagic = 0x46525243;
+static const quint32 renderCacheFormat = 1;
+
+// Eviction removes files until the cache is this much of its maximum size, so it does not run on every write.
+static const double evictionTarget = 0.75;
+
+
+/**
+ * @brief A cache of rendered HTML on disk, so content is rendered only once across restarts.
+ * @details Every entry is a file of its own, named after a hash of its key. So finding and reading
+ *   an entry is a single file access, without an index to load or to keep consistent. Reading an
+ *   entry sets its file's modification time, so that time tells when the entry was last used.
+ *   Entries are written in the background, one at a time. When the files exceed the maximum total
+ *   size, the least recently used ones are removed.
+ *
+ *   The keys have to identify everything the HTML depends on, as entries are never invalidated.
+ *   The key is stored in the file as well and compared when reading, so hash collisions are harmless.
+ * @param directory  The directory for the cache files. Created if it does not exist.
+ * @param maxBytes  Maximum total size of the cache files.
+ */
+RenderCache::RenderCache(QString directory, qint64 maxBytes) :
+    m_directory(directory), m_maxBytes(maxBytes), m_bytes(-1) {
+
+    QDir().mkpath(directory);
+    m_writer.setMaxThreadCount(1);
+}
+
+
+/** @brief Finish the pending writes. */
+RenderCache::~RenderCache() {
+    m_writer.waitForDone();
+}
+
+
+/**
+ * @brief Read an entry. Thread-safe.
+ * @return The HTML stored for the key, or a null string if there is none.
+ */
+QString RenderCache::lookup(QString key) const {
+    QFile file(fileName(key));
+    if (!file.open(QIODevice::ReadOnly))
+        return QString();
+    QByteArray data = file.readAll();
+    file.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic, format;
+    QString storedKey;
+    QByteArray compressed;
+    in >> magic >> format >> storedKey >> compressed;
+    if (in.status() != QDataStream::Ok || magic != renderCacheMagic || format != renderCacheFormat || storedKey != key)
+        return QString();
+
+    QByteArray html = qUncompress(compressed);
+    return html.isEmpty() ? QString() : QString::fromUtf8(html);
+}
+
+
+/**
+ * @brief Store an entry in the background, replacing any entry with the same key. Thread-safe.
+ * @details Empty HTML is not stored, as it is cheap to determine again.
+ */
+void RenderCache::store(QString key, QString html) {
+    if (html.isEmpty())
+        return;
+
+    QtConcurrent::run(&m_writer, [this, key, html]() {
+        write(key, html);
+    });
+}
+
+
+/** @brief The cache file of a key. */
+QString RenderCache::fileName(QString key) const {
+    QByteArray hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return m_directory + "/" + QString::fromLatin1(hash) + ".cache";
+}
+
+
+/**
+ * @brief Write an entry. Runs on the writer thread.
+ * @details The file is replaced atomically, so readers never see a partially written entry.
+ */
+void RenderCache::write(QString key, QString html) {
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << renderCacheMagic << renderCacheFormat << key << qCompress(html.toUtf8());
+
+    QString name = fileName(key);
+    qint64 replacedBytes = QFileInfo(name).size();
+    QSaveFile file(name);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qWarning() << "RenderCache::write: ERROR: Could not write" << name << ":" << file.errorString();
+        return;
+    }
+
+    if (m_bytes >= 0)
+        m_bytes += data.size() - replacedBytes;
+    if (m_bytes < 0 || m_bytes > m_maxBytes)
+        evict();
+}
+
+
+/**
+ * @brief Determine the total size of the cache files, and remove the least recently used ones if
+ *   that exceeds the maximum. Runs on the writer thread.
+ */
+void RenderCache::evict() {
+    QFileInfoList files = QDir(m_directory).entryInfoList(QStringList("*.cache"), QDir::Files, QDir::Time);
+
+    m_bytes = 0;
+    for (const QFileInfo& info : files)
+        m_bytes += info.size();
+    if (m_bytes <= m_maxBytes)
+        return;
+
+    // Files are sorted by modification time, most recently used first.
+    int removed = 0;
+    qint64 target = qint64(m_maxBytes * evictionTarget);
+    for (int i = files.size() - 1; i >= 0 && m_bytes > target; i--) {
+        if (QFile::remove(files[i].absoluteFilePath())) {
+            m_bytes -= files[i].size();
+            removed++;
+        }
+    }
+    qDebug() << "RenderCache::evict: Removed" << removed << "entries, keeping" << m_bytes << "bytes.";
+}
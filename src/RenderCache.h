@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QString>
+#include <QThreadPool>
+
+class RenderCache {
+
+public:
+    RenderCache(QString directory, qint64 maxBytes);
+
+    ~RenderCache();
+
+    QString lookup(QString key) const;
+
+    void store(QString key, QString html);
+
+private:
+    QString fileName(QString key) const;
+    void write(QString key, QString html);
+    void evict();
+
+    Q_DISABLE_COPY(RenderCache)
+
+    QString m_directory;
+    qint64 m_maxBytes;
+    qint64 m_bytes;         // Total size of the cache files, or -1 if not yet determined. Used by the writer thread only.
+    QThreadPool m_writer;   // One thread, so writes and evictions never run at the same time.
+};
@@ -0,0 +1,276 @@
+#include <QDebug>
+#include <QMetaEnum>
+#include <QMutexLocker>
+#include <QVariantList>
+
+#include "ScanStatistics.h"
+#include "ZXingQtReader.h"
+
+
+/**
+ * @brief Upper bucket bounds in milliseconds (exclusive). The last bucket collects everything above.
+ */
+const int* RollingHistogram::bucketLimits() {
+    static const int limits[BucketCount - 1] = {2, 5, 10, 20, 50, 100, 200, 500, 1000};
+    return limits;
+}
+
+
+int RollingHistogram::bucketOf(int ms) {
+    int bucket = 0;
+    while (bucket < BucketCount - 1 && ms >= bucketLimits()[bucket])
+        ++bucket;
+    return bucket;
+}
+
+
+void RollingHistogram::add(int ms) {
+    if (m_samples.size() < Capacity) {
+        m_samples.append(ms);
+    }
+    else {
+        --m_buckets[bucketOf(m_samples[m_next])];
+        m_samples[m_next] = ms;
+        m_next = (m_next + 1) % Capacity;
+    }
+    ++m_buckets[bucketOf(ms)];
+}
+
+
+QVariantMap RollingHistogram::toVariantMap() const {
+    QVariantList buckets;
+    for (int i = 0; i < BucketCount; ++i)
+        buckets << m_buckets[i];
+
+    qint64 sum = 0;
+    int maximum = 0;
+    for (int ms : m_samples) {
+        sum += ms;
+        maximum = qMax(maximum, ms);
+    }
+
+    QVariantMap map;
+    map["samples"] = m_samples.size();
+    map["mean"] = m_samples.isEmpty() ? 0.0 : double(sum) / m_samples.size();
+    map["max"] = maximum;
+    map["buckets"] = buckets;
+    return map;
+}
+
+
+QString RollingHistogram::toString() const {
+    QString text;
+    int lower = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        if (m_buckets[i] == 0)
+            continue;
+        if (i < BucketCount - 1)
+            text += QString("%1-%2ms:%3 ").arg(lower).arg(bucketLimits()[i] - 1).arg(m_buckets[i]);
+        else
+            text += QString("%1ms+:%2 ").arg(lower).arg(m_buckets[i]);
+        if (i < BucketCount - 1)
+            lower = bucketLimits()[i];
+    }
+    return text.trimmed();
+}
+
+
+ScanStatistics::ScanStatistics(QObject* parent) : QObject(parent), m_notifyPending(false) {
+    m_notifyTimer = new QTimer(this);
+    m_notifyTimer->setSingleShot(true);
+    QObject::connect(m_notifyTimer, &QTimer::timeout, this, &ScanStatistics::emitPendingChange);
+    reset();
+}
+
+
+int ScanStatistics::framesSeen() const {
+    QMutexLocker locker(&m_mutex);
+    return m_framesSeen;
+}
+
+
+int ScanStatistics::framesDecoded() const {
+    QMutexLocker locker(&m_mutex);
+    return m_framesDecoded;
+}
+
+
+int ScanStatistics::framesDropped() const {
+    QMutexLocker locker(&m_mutex);
+    return m_framesDropped;
+}
+
+
+/**
+ * @brief Number of frames decoded by ScanlineEanReader, without the full zxing decode.
+ */
+int ScanStatistics::framesFastPath() const {
+    QMutexLocker locker(&m_mutex);
+    return m_framesFastPath;
+}
+
+
+/**
+ * @brief Milliseconds from markCameraStarted() to the first valid result, or -1 if none yet.
+ */
+int ScanStatistics::timeToFirstDetection() const {
+    QMutexLocker locker(&m_mutex);
+    return m_timeToFirstDetection;
+}
+
+
+QVariantMap ScanStatistics::statusCounts() const {
+    QMutexLocker locker(&m_mutex);
+    QVariantMap map;
+    for (auto it = m_statusCounts.constBegin(); it != m_statusCounts.constEnd(); ++it)
+        map[it.key()] = it.value();
+    return map;
+}
+
+
+QVariantMap ScanStatistics::decodeTimesByFormat() const {
+    QMutexLocker locker(&m_mutex);
+    return toVariantMap(m_byFormat);
+}
+
+
+QVariantMap ScanStatistics::decodeTimesByPixelFormat() const {
+    QMutexLocker locker(&m_mutex);
+    return toVariantMap(m_byPixelFormat);
+}
+
+
+/**
+ * @brief Clear all statistics, such as when starting a new scan session.
+ */
+void ScanStatistics::reset() {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_framesSeen = m_framesDecoded = m_framesDropped = m_framesFastPath = 0;
+        m_timeToFirstDetection = -1;
+        m_statusCounts.clear();
+        m_byFormat.clear();
+        m_byPixelFormat.clear();
+        m_session.start();
+        m_lastNotify.invalidate();
+        m_notifyPending = false;
+    }
+    emit changed();
+}
+
+
+/**
+ * @brief Start measuring the time to the first detection from now.
+ */
+void ScanStatistics::markCameraStarted() {
+    QMutexLocker locker(&m_mutex);
+    m_session.start();
+}
+
+
+void ScanStatistics::recordDroppedFrame() {
+    {
+        QMutexLocker locker(&m_mutex);
+        ++m_framesSeen;
+        ++m_framesDropped;
+    }
+    notify();
+}
+
+
+void ScanStatistics::recordFrame(const ZXingQt::Result& result, QVideoFrame::PixelFormat pixelFormat) {
+    {
+        QMutexLocker locker(&m_mutex);
+        ++m_framesSeen;
+        if (result.isValid()) {
+            ++m_framesDecoded;
+            if (result.fastPath)
+                ++m_framesFastPath;
+            if (m_timeToFirstDetection < 0)
+                m_timeToFirstDetection = int(m_session.elapsed());
+        }
+        QString status = QString::fromLatin1(
+            QMetaEnum::fromType<ZXingQt::DecodeStatus>().valueToKey(int(result.status()))
+        );
+        ++m_statusCounts[status];
+        m_byFormat[result.formatName()].add(result.runTime);
+        m_byPixelFormat[pixelFormatName(pixelFormat)].add(result.runTime);
+    }
+    notify();
+}
+
+
+/**
+ * @brief Human-readable summary of the session, for the log.
+ */
+QString ScanStatistics::dump() const {
+    QMutexLocker locker(&m_mutex);
+    QString text = QString("frames seen: %1, decoded: %2 (fast path: %3), dropped: %4, first detection after: %5\n")
+        .arg(m_framesSeen)
+        .arg(m_framesDecoded)
+        .arg(m_framesFastPath)
+        .arg(m_framesDropped)
+        .arg(m_timeToFirstDetection < 0 ? QString("-") : QString("%1 ms").arg(m_timeToFirstDetection));
+    for (auto it = m_statusCounts.constBegin(); it != m_statusCounts.constEnd(); ++it)
+        text += QString("status %1: %2\n").arg(it.key()).arg(it.value());
+    for (auto it = m_byFormat.constBegin(); it != m_byFormat.constEnd(); ++it)
+        text += QString("decode time, format %1: %2\n").arg(it.key(), it.value().toString());
+    for (auto it = m_byPixelFormat.constBegin(); it != m_byPixelFormat.constEnd(); ++it)
+        text += QString("decode time, pixel format %1: %2\n").arg(it.key(), it.value().toString());
+    return text;
+}
+
+
+void ScanStatistics::logDump() const {
+    qDebug().noquote() << "ScanStatistics:\n" + dump();
+}
+
+
+QString ScanStatistics::pixelFormatName(QVideoFrame::PixelFormat pixelFormat) {
+    QString name;
+    QDebug(&name).noquote().nospace() << pixelFormat;
+    return name;
+}
+
+
+QVariantMap ScanStatistics::toVariantMap(const QHash<QString, RollingHistogram>& histograms) {
+    QVariantMap map;
+    for (auto it = histograms.constBegin(); it != histograms.constEnd(); ++it)
+        map[it.key()] = it.value().toVariantMap();
+    return map;
+}
+
+
+/**
+ * @brief Emit changed(), or schedule it for when NotifyInterval has passed since the last emit.
+ * @details Scheduling makes sure that the last change of a burst is also notified, such as the
+ *   final frame counts after the camera stopped. Called from the video rendering thread, so the
+ *   timer is started through a queued call in the thread it lives in.
+ */
+void ScanStatistics::notify() {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_lastNotify.isValid() && m_lastNotify.elapsed() < NotifyInterval) {
+            if (!m_notifyPending) {
+                m_notifyPending = true;
+                int remaining = NotifyInterval - int(m_lastNotify.elapsed());
+                QMetaObject::invokeMethod(m_notifyTimer, "start", Qt::QueuedConnection, Q_ARG(int, remaining));
+            }
+            return;
+        }
+        m_lastNotify.start();
+    }
+    emit changed();
+}
+
+
+void ScanStatistics::emitPendingChange() {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_notifyPending)
+            return;
+        m_notifyPending = false;
+        m_lastNotify.start();
+    }
+    emit changed();
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QVariantMap>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVideoFrame>
+
+namespace ZXingQt { class Result; }
+
+/**
+ * @brief Decode time distribution over the most recent frames of one kind.
+ * @details Keeps the last Capacity samples in a ring buffer, so that removing the oldest sample
+ *   from its bucket keeps the histogram "rolling" at constant cost per frame.
+ */
+class RollingHistogram {
+
+public:
+    static constexpr int Capacity = 256;
+    static constexpr int BucketCount = 10;
+
+    void add(int ms);
+
+    QVariantMap toVariantMap() const;
+
+    QString toString() const;
+
+private:
+    static const int* bucketLimits();
+    static int bucketOf(int ms);
+
+    QVector<int> m_samples;
+    int m_next = 0;
+    int m_buckets[BucketCount] = {};
+};
+
+/**
+ * @brief Aggregated performance statistics of one scan session of a ZXingQt::VideoFilter.
+ * @details Written from the video rendering thread, read from the GUI thread, so all access is
+ *   locked. Call reset() when starting a new scan session and markCameraStarted() once the camera
+ *   delivers frames, so that the time to the first detection can be measured.
+ */
+class ScanStatistics : public QObject {
+
+    Q_OBJECT
+
+    Q_PROPERTY(int framesSeen READ framesSeen NOTIFY changed)
+    Q_PROPERTY(int framesDecoded READ framesDecoded NOTIFY changed)
+    Q_PROPERTY(int framesDropped READ framesDropped NOTIFY changed)
+    Q_PROPERTY(int framesFastPath READ framesFastPath NOTIFY changed)
+    Q_PROPERTY(int timeToFirstDetection READ timeToFirstDetection NOTIFY changed)
+    Q_PROPERTY(QVariantMap statusCounts READ statusCounts NOTIFY changed)
+    Q_PROPERTY(QVariantMap decodeTimesByFormat READ decodeTimesByFormat NOTIFY changed)
+    Q_PROPERTY(QVariantMap decodeTimesByPixelFormat READ decodeTimesByPixelFormat NOTIFY changed)
+
+public:
+    // Minimum time between two changed() notifications, to not re-evaluate QML bindings every frame.
+    static constexpr int NotifyInterval = 250;
+
+    explicit ScanStatistics(QObject* parent = 0);
+
+    int framesSeen() const;
+
+    int framesDecoded() const;
+
+    int framesDropped() const;
+
+    int framesFastPath() const;
+
+    int timeToFirstDetection() const;
+
+    QVariantMap statusCounts() const;
+
+    QVariantMap decodeTimesByFormat() const;
+
+    QVariantMap decodeTimesByPixelFormat() const;
+
+    Q_INVOKABLE // Allows to invoke this method from QML.
+    void reset();
+
+    Q_INVOKABLE
+    void markCameraStarted();
+
+    void recordDroppedFrame();
+
+    void recordFrame(const ZXingQt::Result& result, QVideoFrame::PixelFormat pixelFormat);
+
+    Q_INVOKABLE
+    QString dump() const;
+
+    Q_INVOKABLE
+    void logDump() const;
+
+signals:
+    void changed();
+
+private slots:
+    void emitPendingChange();
+
+private:
+    static QString pixelFormatName(QVideoFrame::PixelFormat pixelFormat);
+    static QVariantMap toVariantMap(const QHash<QString, RollingHistogram>& histograms);
+
+    void notify();
+
+    mutable QMutex m_mutex;
+    int m_framesSeen;
+    int m_framesDecoded;
+    int m_framesDropped;
+    int m_framesFastPath;
+    int m_timeToFirstDetection;
+    QHash<QString, int> m_statusCounts;
+    QHash<QString, RollingHistogram> m_byFormat;
+    QHash<QString, RollingHistogram> m_byPixelFormat;
+    QElapsedTimer m_session;
+    QElapsedTimer m_lastNotify;
+    QTimer* m_notifyTimer;   // Emits a change held back by notify(). Lives in the thread of this object.
+    bool m_notifyPending;
+};
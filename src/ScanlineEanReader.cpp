@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+
+#include "ScanlineEanReader.h"
+
+
+/**
+ * @brief If the hints ask for retail formats only, so that all requested formats can be found here.
+ */
+bool ScanlineEanReader::supports(const ZXing::DecodeHints& hints) {
+    using ZXing::BarcodeFormat;
+
+    const ZXing::BarcodeFormats formats = hints.formats();
+    for (BarcodeFormat other : {
+        BarcodeFormat::Aztec, BarcodeFormat::Codabar, BarcodeFormat::Code39, BarcodeFormat::Code93,
+        BarcodeFormat::Code128, BarcodeFormat::DataBar, BarcodeFormat::DataBarExpanded, BarcodeFormat::DataMatrix,
+        BarcodeFormat::ITF, BarcodeFormat::MaxiCode, BarcodeFormat::PDF417, BarcodeFormat::QRCode,
+        BarcodeFormat::UPCE
+    }) {
+        if (formats.testFlag(other))
+            return false;
+    }
+    return formats.testFlag(BarcodeFormat::EAN13) || formats.testFlag(BarcodeFormat::EAN8)
+        || formats.testFlag(BarcodeFormat::UPCA);
+}
+
+
+/**
+ * @brief Search a luminance image with one byte per sample.
+ * @param lum  The first sample of the image.
+ * @param rowStride  The distance between rows, in bytes.
+ * @param pixStride  The distance between samples in a row, or 0 if they are adjacent.
+ * @param hints  The formats to search for, and whether to also read vertical scanlines (tryRotate).
+ * @return The barcode found, or an invalid result if none was found.
+ */
+ZXing::Result ScanlineEanReader::read(const uint8_t* lum, int width, int height, int rowStride, int pixStride,
+                                      const ZXing::DecodeHints& hints) {
+    const ZXing::BarcodeFormats formats = hints.formats();
+    const int step = pixStride > 0 ? pixStride : 1;
+
+    std::vector<uint8_t> line;
+    std::vector<int> runs;
+    std::vector<int> reversed;
+
+    for (int rotated = 0; rotated < (hints.tryRotate() ? 2 : 1); rotated++) {
+        const int length = rotated ? height : width;
+        const int lines = rotated ? width : height;
+        const int advance = rotated ? rowStride : step;
+
+        for (int i = 0; i < ScanlineCount; i++) {
+            // From the middle outwards, as the barcode is usually aimed at the middle.
+            int slot = ScanlineCount / 2 + (i % 2 ? (i + 1) / 2 : -(i / 2));
+            int pos = (slot + 1) * lines / (ScanlineCount + 1);
+            const uint8_t* p = rotated ? lum + pos * step : lum + pos * rowStride;
+
+            line.resize(length);
+            for (int k = 0; k < length; k++)
+                line[k] = p[k * advance];
+            if (!binarize(line, runs))
+                continue;
+
+            // Also read the runs backwards, for barcodes upside down.
+            for (int backwards = 0; backwards < 2; backwards++) {
+                const std::vector<int>* r = &runs;
+                if (backwards) {
+                    reversed.assign(runs.rbegin(), runs.rend());
+                    if (reversed.size() % 2 == 0) // Ends with a dark run, but runs start with a light one.
+                        reversed.insert(reversed.begin(), 0);
+                    r = &reversed;
+                }
+
+                std::string text;
+                ZXing::BarcodeFormat format = ZXing::BarcodeFormat::EAN13;
+                int first = 0, last = 0;
+                if (!decodeRuns(*r, formats, text, format, first, last))
+                    continue;
+
+                int start = 0;
+                for (int k = 0; k < first; k++)
+                    start += (*r)[k];
+                int end = start;
+                for (int k = first; k <= last; k++)
+                    end += (*r)[k];
+                end--;
+                if (backwards) {
+                    start = length - 1 - start;
+                    end = length - 1 - end;
+                }
+
+                // Like zxing's own results of 1D barcodes, the position is the scanline through the barcode.
+                auto point = [rotated, pos](int k) {
+                    return rotated ? ZXing::PointI(pos, k) : ZXing::PointI(k, pos);
+                };
+                return ZXing::Result(
+                    std::wstring(text.begin(), text.end()),
+                    ZXing::Position(point(start), point(end), point(end), point(start)),
+                    format
+                );
+            }
+        }
+    }
+    return ZXing::Result(ZXing::DecodeStatus::NotFound);
+}
+
+
+/**
+ * @brief Convert a scanline into the lengths of its alternating light and dark runs.
+ * @details The runs start with a light run, of length 0 if the line starts dark. The threshold is
+ *   the middle between the darkest and lightest samples nearby, so uneven lighting across the
+ *   barcode does not matter. Where there is little contrast nearby, such as in the quiet zones,
+ *   samples count as light. Changing between light and dark needs a margin beyond the threshold,
+ *   against noise.
+ * @return false if the line has too little contrast to contain a barcode.
+ */
+bool ScanlineEanReader::binarize(const std::vector<uint8_t>& line, std::vector<int>& runs) {
+    const int n = int(line.size());
+    runs.clear();
+    if (n < 2)
+        return false;
+
+    auto range = std::minmax_element(line.begin(), line.end());
+    const int contrast = *range.second - *range.first;
+    if (contrast < MinContrast)
+        return false;
+
+    // "Nearby" is the block of a sample and its neighbor blocks.
+    const int blockSize = std::max(8, n / 32);
+    const int blocks = (n + blockSize - 1) / blockSize;
+    std::vector<uint8_t> blockMin(blocks, 255), blockMax(blocks, 0);
+    for (int i = 0; i < n; i++) {
+        blockMin[i / blockSize] = std::min(blockMin[i / blockSize], line[i]);
+        blockMax[i / blockSize] = std::max(blockMax[i / blockSize], line[i]);
+    }
+
+    const int margin = std::max(2, contrast / 16);
+    bool dark = false;
+    int runLength = 0;
+    for (int i = 0; i < n; i++) {
+        const int block = i / blockSize;
+        int lo = blockMin[block], hi = blockMax[block];
+        for (int j = std::max(0, block - 1); j <= std::min(blocks - 1, block + 1); j++) {
+            lo = std::min(lo, int(blockMin[j]));
+            hi = std::max(hi, int(blockMax[j]));
+        }
+        const int threshold = (lo + hi) / 2;
+
+        bool d = hi - lo >= MinContrast
+            && line[i] < (i == 0 ? threshold : dark ? threshold + margin : threshold - margin);
+        if (i == 0) {
+            if (d)
+                runs.push_back(0);
+        }
+        else if (d != dark) {
+            runs.push_back(runLength);
+            runLength = 0;
+        }
+        dark = d;
+        runLength++;
+    }
+    runs.push_back(runLength);
+    return true;
+}
+
+
+/**
+ * @brief Deviation of runs from the widths of a pattern, relative to the total width.
+ * @return The deviation, or a value above MaxAvgVariance if a single run deviates too much.
+ */
+float ScanlineEanReader::variance(const int* runs, const int* pattern, int count) {
+    int total = 0, modules = 0;
+    for (int i = 0; i < count; i++) {
+        total += runs[i];
+        modules += pattern[i];
+    }
+    if (total < modules) // Less than one sample per module.
+        return 1;
+
+    const float unit = float(total) / modules;
+    float sum = 0;
+    for (int i = 0; i < count; i++) {
+        float deviation = std::abs(runs[i] - pattern[i] * unit);
+        if (deviation > MaxIndividualVariance * unit)
+            return 1;
+        sum += deviation;
+    }
+    return sum / total;
+}
+
+
+/**
+ * @brief Decode the four runs of one digit.
+ * @details L codes are the digit patterns starting with a space, as in the left half of EAN-13
+ *   and EAN-8. The right half uses the same widths starting with a bar. G codes, the reversed L
+ *   codes, only occur in the left half of EAN-13.
+ * @return The digit plus 10 for G codes, or -1 if no pattern matches.
+ */
+int ScanlineEanReader::decodeDigit(const int* runs, bool allowG) {
+    static const int patterns[20][4] = {
+        {3, 2, 1, 1}, {2, 2, 2, 1}, {2, 1, 2, 2}, {1, 4, 1, 1}, {1, 1, 3, 2}, // L codes
+        {1, 2, 3, 1}, {1, 1, 1, 4}, {1, 3, 1, 2}, {1, 2, 1, 3}, {3, 1, 1, 2},
+        {1, 1, 2, 3}, {1, 2, 2, 2}, {2, 2, 1, 2}, {1, 1, 4, 1}, {2, 3, 1, 1}, // G codes
+        {1, 3, 2, 1}, {4, 1, 1, 1}, {2, 1, 3, 1}, {3, 1, 2, 1}, {2, 1, 1, 3},
+    };
+
+    int best = -1;
+    float bestVariance = MaxAvgVariance;
+    for (int i = 0; i < (allowG ? 20 : 10); i++) {
+        float v = variance(runs, patterns[i], 4);
+        if (v < bestVariance) {
+            bestVariance = v;
+            best = i;
+        }
+    }
+    return best;
+}
+
+
+/**
+ * @brief Decode an EAN-13 (digits = 13) or EAN-8 (digits = 8) symbol whose start guard is the dark run runs[s].
+ * @return The index of the last run of the end guard, or -1 if there is no valid symbol.
+ */
+int ScanlineEanReader::decodeSymbol(const std::vector<int>& runs, int s, int digits, std::string& text) {
+    static const int guard[] = {1, 1, 1};
+    static const int middleGuard[] = {1, 1, 1, 1, 1};
+    // Parities of the left half of EAN-13, which encode the first digit. Bit 5 - i set if digit i is a G code.
+    static const int firstDigitParities[10] = {0x00, 0x0B, 0x0D, 0x0E, 0x13, 0x19, 0x1C, 0x15, 0x16, 0x1A};
+
+    const int half = digits == 13 ? 6 : 4;
+    const int middle = s + 3 + 4 * half;
+    const int end = middle + 5 + 4 * half;
+    if (end + 3 >= int(runs.size()))
+        return -1;
+    const int* r = runs.data();
+
+    if (variance(r + s, guard, 3) >= MaxAvgVariance || variance(r + middle, middleGuard, 5) >= MaxAvgVariance
+        || variance(r + end, guard, 3) >= MaxAvgVariance)
+        return -1;
+
+    int left = 0, right = 0;
+    for (int i = s + 3; i < middle; i++)
+        left += r[i];
+    for (int i = middle + 5; i < end; i++)
+        right += r[i];
+    const int width = r[s] + r[s + 1] + r[s + 2] + left + r[middle] + r[middle + 1] + r[middle + 2]
+        + r[middle + 3] + r[middle + 4] + right + r[end] + r[end + 1] + r[end + 2];
+    const float unit = float(width) / (digits == 13 ? 95 : 67);
+
+    // Both halves have the same number of modules, and differ in width only by perspective.
+    if (r[s - 1] < QuietZoneModules * unit || r[end + 3] < QuietZoneModules * unit
+        || 4 * left < 3 * right || 4 * right < 3 * left)
+        return -1;
+
+    // Every digit is 7 modules wide. Random patterns matching digits one by one rarely are.
+    for (int i = s + 3; i < end; i += i == middle - 4 ? 9 : 4) {
+        int digitWidth = r[i] + r[i + 1] + r[i + 2] + r[i + 3];
+        if (digitWidth < 7 * MinDigitWidth * unit || digitWidth > 7 * MaxDigitWidth * unit)
+            return -1;
+    }
+
+    text.assign(digits, '0');
+    int parities = 0;
+    for (int i = 0; i < half; i++) {
+        int digit = decodeDigit(r + s + 3 + 4 * i, digits == 13);
+        if (digit < 0)
+            return -1;
+        if (digit >= 10)
+            parities |= 1 << (5 - i);
+        text[digits - 2 * half + i] = char('0' + digit % 10);
+    }
+    for (int i = 0; i < half; i++) {
+        int digit = decodeDigit(r + middle + 5 + 4 * i, false);
+        if (digit < 0)
+            return -1;
+        text[digits - half + i] = char('0' + digit);
+    }
+
+    if (digits == 13) {
+        const int* first = std::find(firstDigitParities, firstDigitParities + 10, parities);
+        if (first == firstDigitParities + 10)
+            return -1;
+        text[0] = char('0' + (first - firstDigitParities));
+    }
+
+    // The check digit makes the weighted sum a multiple of 10. Weights alternate 3 and 1, from the right.
+    int sum = 0;
+    for (int i = 0; i < digits; i++)
+        sum += (text[i] - '0') * ((digits - 1 - i) % 2 ? 3 : 1);
+    return sum % 10 == 0 ? end + 2 : -1;
+}
+
+
+/**
+ * @brief Find the first symbol of the requested formats in the runs of a scanline.
+ * @param first  Set to the index of the symbol's first run.
+ * @param last  Set to the index of the symbol's last run.
+ * @return true if a symbol was found.
+ */
+bool ScanlineEanReader::decodeRuns(const std::vector<int>& runs, const ZXing::BarcodeFormats& formats,
+                                   std::string& text, ZXing::BarcodeFormat& format, int& first, int& last) {
+    const bool ean13 = formats.testFlag(ZXing::BarcodeFormat::EAN13);
+    const bool upca = formats.testFlag(ZXing::BarcodeFormat::UPCA);
+    const bool ean8 = formats.testFlag(ZXing::BarcodeFormat::EAN8);
+
+    // Dark runs have odd indexes.
+    for (int s = 1; s < int(runs.size()); s += 2) {
+        if (ean13 || upca) {
+            last = decodeSymbol(runs, s, 13, text);
+            // UPC-A is EAN-13 with a leading 0. As in zxing, it is reported as UPC-A if requested.
+            if (last >= 0 && upca && text[0] == '0') {
+                text.erase(0, 1);
+                format = ZXing::BarcodeFormat::UPCA;
+                first = s;
+                return true;
+            }
+            if (last >= 0 && ean13) {
+                format = ZXing::BarcodeFormat::EAN13;
+                first = s;
+                return true;
+            }
+        }
+        if (ean8) {
+            last = decodeSymbol(runs, s, 8, text);
+            if (last >= 0) {
+                format = ZXing::BarcodeFormat::EAN8;
+                first = s;
+                return true;
+            }
+        }
+    }
+    return false;
+}
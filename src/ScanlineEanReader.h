@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <ZXing/BarcodeFormat.h>
+#include <ZXing/DecodeHints.h>
+#include <ZXing/Result.h>
+
+/**
+ * @brief Fast path for retail barcodes (EAN-13, EAN-8, UPC-A) in luminance images, tried before the full zxing decode.
+ * @details Instead of binarizing and searching the whole image, it reads a few scanlines through
+ *   the middle of the image, horizontally and, with tryRotate, vertically, and decodes the bar
+ *   widths along them directly. Takes a fraction of the time of a full decode when the barcode is
+ *   held about straight in view, which is the common case when scanning products. A code is only
+ *   accepted with valid guard patterns, quiet zones and check digit. When nothing is found, the
+ *   caller falls back to the full decode, which also finds skewed, damaged and small barcodes.
+ */
+class ScanlineEanReader {
+
+public:
+    static constexpr int ScanlineCount = 5;        // Per orientation.
+    static constexpr int MinContrast = 32;         // Luminance difference below which a line is not decoded.
+    static constexpr int QuietZoneModules = 5;     // Minimum light space before and after a barcode.
+    static constexpr float MinDigitWidth = 0.75f;  // Tolerance of digit widths, relative to the barcode's average.
+    static constexpr float MaxDigitWidth = 1.25f;
+
+    // The same tolerances as in zxing's UPC/EAN reader. Variances are relative to the pattern width.
+    static constexpr float MaxAvgVariance = 0.48f;
+    static constexpr float MaxIndividualVariance = 0.7f;
+
+    static bool supports(const ZXing::DecodeHints& hints);
+
+    static ZXing::Result read(const uint8_t* lum, int width, int height, int rowStride, int pixStride,
+                              const ZXing::DecodeHints& hints);
+
+private:
+    static bool binarize(const std::vector<uint8_t>& line, std::vector<int>& runs);
+
+    static float variance(const int* runs, const int* pattern, int count);
+
+    static int decodeDigit(const int* runs, bool allowG);
+
+    static int decodeSymbol(const std::vector<int>& runs, int s, int digits, std::string& text);
+
+    static bool decodeRuns(const std::vector<int>& runs, const ZXing::BarcodeFormats& formats, std::string& text,
+                           ZXing::BarcodeFormat& format, int& first, int& last);
+};
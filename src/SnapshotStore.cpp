@@ -0,0 +1,193 @@
+#include <QDataStream>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <QDebug>
+
+#include "SnapshotStore.h"
+
+
+// File format identification of snapshot files: "FRSN" for "Food Rescue snapshots", and the version.
+static const quint32 snapshotMagic = 0x4652534E;
+static const quint32 snapshotFormat = 1;
+
+
+/**
+ * @brief A file with the most recently shown pages, so they can be shown again without querying
+ *   and rendering them, such as right after starting the application.
+ * @details The file starts with a small index of the stored pages, followed by the page data.
+ *   Only the index is read when opening the store. A page is read when requested by page(), so
+ *   pages never shown again are never read. The number of pages and their total size are capped;
+ *   when storing a page, the least recently stored pages beyond the cap are dropped.
+ *
+ *   Pages are written in the background, one at a time, as rewriting the file takes time in
+ *   proportion to all pages kept. Until written, a stored page is served from memory.
+ * @param fileName  The file to store the pages in.
+ * @param maxPages  Maximum number of pages to keep.
+ * @param maxBytes  Maximum total size of all pages to keep.
+ */
+SnapshotStore::SnapshotStore(QString fileName, int maxPages, qint64 maxBytes) :
+    m_fileName(fileName), m_maxPages(maxPages), m_maxBytes(maxBytes), m_dataStart(0) {
+
+    m_writer.setMaxThreadCount(1);
+    loadIndex();
+}
+
+
+/** @brief Finish the pending writes. */
+SnapshotStore::~SnapshotStore() {
+    m_writer.waitForDone();
+}
+
+
+/** @brief Determine if a page with the given key is stored. */
+bool SnapshotStore::contains(QString key) const {
+    QMutexLocker locker(&m_mutex);
+    return m_pending.contains(key) || find(key) >= 0;
+}
+
+
+/**
+ * @brief Read a stored page.
+ * @return The page data, or an empty byte array if no such page is stored.
+ */
+QByteArray SnapshotStore::page(QString key) {
+    QMutexLocker locker(&m_mutex);
+    if (m_pending.contains(key))
+        return m_pending.value(key);
+
+    int i = find(key);
+    if (i < 0 || !m_file.isOpen() || !m_file.seek(m_dataStart + m_index[i].offset))
+        return QByteArray();
+
+    QByteArray data = m_file.read(m_index[i].length);
+    return data.size() == m_index[i].length ? data : QByteArray();
+}
+
+
+/**
+ * @brief Store a page in the background, replacing any page with the same key.
+ */
+void SnapshotStore::store(QString key, QByteArray page) {
+    if (page.size() > m_maxBytes)
+        return;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_pending.insert(key, page);
+    }
+
+    QtConcurrent::run(&m_writer, [this, key, page]() {
+        write(key, page);
+    });
+}
+
+
+/**
+ * @brief Write the store file with the given page and the most recent previous ones. Runs on the
+ *   writer thread.
+ * @details The file is replaced atomically, so an interrupted write leaves the previous version.
+ *   Pages that remain are copied from the previous file without decoding them. The lock is only
+ *   held to replace the file, so reading pages meanwhile does not wait for the write.
+ */
+void SnapshotStore::write(QString key, QByteArray page) {
+    QVector<Entry> index;
+    qint64 dataStart;
+    {
+        QMutexLocker locker(&m_mutex);
+        index = m_index;
+        dataStart = m_dataStart;
+    }
+
+    // Determine the pages to keep, newest first, within the caps. Only the writer thread replaces
+    //   the file, so it stays as indexed above while reading from it.
+    QFile previous(m_fileName);
+    bool hasPrevious = !index.isEmpty() && previous.open(QIODevice::ReadOnly);
+    QVector<Entry> kept;
+    QVector<QByteArray> pages;
+    qint64 bytes = page.size();
+    kept << Entry{key, 0, page.size()};
+    pages << page;
+    for (const Entry& entry : index) {
+        if (!hasPrevious || kept.size() >= m_maxPages || bytes + entry.length > m_maxBytes)
+            break;
+        if (entry.key == key)
+            continue;
+        if (!previous.seek(dataStart + entry.offset))
+            continue;
+        QByteArray data = previous.read(entry.length);
+        if (data.size() != entry.length)
+            continue;
+        kept << Entry{entry.key, bytes, entry.length};
+        pages << data;
+        bytes += entry.length;
+    }
+    previous.close();
+
+    QSaveFile file(m_fileName);
+    bool written = file.open(QIODevice::WriteOnly);
+    if (written) {
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_5_12);
+        out << snapshotMagic << snapshotFormat << quint32(kept.size());
+        for (const Entry& entry : kept)
+            out << entry.key << entry.offset << entry.length;
+        for (const QByteArray& data : pages)
+            out.writeRawData(data.constData(), data.size());
+    }
+
+    QMutexLocker locker(&m_mutex);
+    // The reading handle is closed while replacing the file, as some platforms cannot replace open files.
+    m_file.close();
+    if (!written || !file.commit())
+        qWarning() << "SnapshotStore::write: ERROR: Could not write" << m_fileName << ":" << file.errorString();
+    loadIndex();
+
+    // A page stored again meanwhile stays pending, for the next write.
+    if (m_pending.value(key) == page)
+        m_pending.remove(key);
+}
+
+
+/**
+ * @brief Read the index of the store file and keep the file open for reading pages. Call with the
+ *   lock held, except from the constructor.
+ * @return true if the file has a valid index, false otherwise. The store is empty in that case.
+ */
+bool SnapshotStore::loadIndex() {
+    m_index.clear();
+    m_file.close();
+    m_file.setFileName(m_fileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&m_file);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic, format, count;
+    in >> magic >> format >> count;
+    if (in.status() != QDataStream::Ok || magic != snapshotMagic || format != snapshotFormat) {
+        m_file.close();
+        return false;
+    }
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        Entry entry;
+        in >> entry.key >> entry.offset >> entry.length;
+        m_index << entry;
+    }
+    if (in.status() != QDataStream::Ok) {
+        m_index.clear();
+        m_file.close();
+        return false;
+    }
+
+    m_dataStart = m_file.pos();
+    return true;
+}
+
+
+int SnapshotStore::find(QString key) const {
+    for (int i = 0; i < m_index.size(); i++)
+        if (m_index[i].key == key)
+            return i;
+    return -1;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+class SnapshotStore {
+
+public:
+    SnapshotStore(QString fileName, int maxPages, qint64 maxBytes);
+
+    ~SnapshotStore();
+
+    bool contains(QString key) const;
+
+    QByteArray page(QString key);
+
+    void store(QString key, QByteArray page);
+
+private:
+    struct Entry {
+        QString key;
+        qint64 offset; // Relative to the start of the page data section.
+        qint32 length;
+    };
+
+    void write(QString key, QByteArray page);
+    bool loadIndex();
+    int find(QString key) const;
+
+    Q_DISABLE_COPY(SnapshotStore)
+
+    QString m_fileName;
+    int m_maxPages;
+    qint64 m_maxBytes;
+
+    mutable QMutex m_mutex;               // Guards the members below, shared with the writer thread.
+    QVector<Entry> m_index;               // Pages in the file, most recently stored first.
+    qint64 m_dataStart;                   // File position of the page data section.
+    QFile m_file;                         // Kept open for reading pages lazily.
+    QHash<QString, QByteArray> m_pending; // Pages stored but not yet written to the file.
+
+    QThreadPool m_writer;                 // One thread, so writes never run at the same time.
+};
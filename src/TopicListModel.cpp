@@ -0,0 +1,263 @@
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <QDataStream>
+#include <QDebug>
+
+#include "TopicListModel.h"
+#include "SnapshotStore.h"
+
+
+/**
+ * @brief List model of the content topics found for a search term, one row per topic.
+ * @details Unlike ContentDatabase::content(), which renders all topics into one document before
+ *   anything can be shown, this model makes topics available one by one. The topics are fetched in
+ *   the background and appear as rows in section priority order, at first without content. Each
+ *   topic is then rendered in the background when render() is called for it, which views do for
+ *   the rows about to become visible, and becomes available through dataChanged(). So the time to
+ *   first content depends on the size of one topic, not on the size of the whole result, and
+ *   topics never scrolled to are never rendered.
+ *
+ *   A new search() supersedes all background work of the previous one, whose results are discarded.
+ */
+TopicListModel::TopicListModel(ContentDatabase* database, QObject* parent) : QAbstractListModel(parent),
+    m_database(database), m_snapshots(nullptr), m_snapshotChanged(false), m_generation(0), m_loading(false) { }
+
+
+/** @brief Store the topics shown as a snapshot, so they are available right away on the next start. */
+TopicListModel::~TopicListModel() {
+    saveSnapshot();
+}
+
+
+/**
+ * @brief Use the given store to keep snapshots of the pages shown, and to show them again without
+ *   querying and rendering them.
+ * @param snapshots  The snapshot store, or nullptr to not use snapshots.
+ */
+void TopicListModel::setSnapshotStore(SnapshotStore* snapshots) {
+    m_snapshots = snapshots;
+}
+
+
+int TopicListModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+
+QVariant TopicListModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= m_rows.size())
+        return QVariant();
+
+    const Row& row = m_rows.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case TitleRole:
+        return row.topic.title;
+    case SectionRole:
+        return row.topic.section;
+    case HtmlRole:
+        return row.html;
+    case ReadyRole:
+        return row.ready;
+    default:
+        return QVariant();
+    }
+}
+
+
+QHash<int, QByteArray> TopicListModel::roleNames() const {
+    QHash<int, QByteArray> roles = QAbstractListModel::roleNames();
+    roles[SectionRole] = "section";
+    roles[TitleRole] = "title";
+    roles[HtmlRole] = "html";
+    roles[ReadyRole] = "ready";
+    return roles;
+}
+
+
+/** @brief Number of topics found by the last search. */
+int TopicListModel::count() const {
+    return m_rows.size();
+}
+
+
+/** @brief If a search is still fetching its topics. */
+bool TopicListModel::loading() const {
+    return m_loading;
+}
+
+
+/**
+ * @brief Start searching for the topics of a barcode or category name in the background.
+ * @details Emits searchFinished() when the topics are available as rows, even if none were found.
+ *   The first topic is rendered right away, as it is always visible.
+ * @param searchTerm  A barcode or category name, in normalized format (see ContentDatabase::normalize()).
+ * @param language  The language of the topics, given as a two-letter language code.
+ */
+void TopicListModel::search(QString searchTerm, QString language) {
+    saveSnapshot();
+    clear();
+
+    // Show a snapshot of the same search in the same database content, if there is one.
+    m_snapshotKey = m_database->snapshotKey(searchTerm, language);
+    if (restoreSnapshot(m_snapshotKey)) {
+        searchFinished(searchTerm, m_rows.size());
+        render(0);
+        return;
+    }
+
+    int generation = m_generation;
+    m_loading = true;
+    loadingChanged();
+
+    QFutureWatcher<QVector<ContentTopic>>* watcher = new QFutureWatcher<QVector<ContentTopic>>(this);
+
+    QObject::connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation, searchTerm]() {
+        watcher->deleteLater();
+        if (generation != m_generation)
+            return;
+
+        QVector<ContentTopic> topics = watcher->result();
+        ContentDatabase::sortTopics(topics);
+
+        if (!topics.isEmpty()) {
+            beginInsertRows(QModelIndex(), 0, topics.size() - 1);
+            for (int i = 0; i < topics.size(); i++) {
+                Row row;
+                row.topic = topics[i];
+                row.sectionHeader = i == 0 || topics[i].section != topics[i - 1].section;
+                m_rows << row;
+            }
+            endInsertRows();
+            countChanged();
+        }
+
+        m_loading = false;
+        loadingChanged();
+        searchFinished(searchTerm, m_rows.size());
+
+        render(0);
+    });
+
+    ContentDatabase* database = m_database;
+    watcher->setFuture(QtConcurrent::run([database, searchTerm, language]() {
+        return database->topics(searchTerm, language);
+    }));
+}
+
+
+/**
+ * @brief Render the topic in the given row in the background, if not yet done or requested.
+ *   Emits dataChanged() for the row when done.
+ */
+void TopicListModel::render(int row) {
+    if (row < 0 || row >= m_rows.size() || m_rows[row].renderRequested)
+        return;
+
+    m_rows[row].renderRequested = true;
+    int generation = m_generation;
+    ContentTopic topic = m_rows[row].topic;
+    bool sectionHeader = m_rows[row].sectionHeader;
+    ContentDatabase* database = m_database;
+
+    QFutureWatcher<QString>* watcher = new QFutureWatcher<QString>(this);
+
+    QObject::connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation, row]() {
+        watcher->deleteLater();
+        if (generation != m_generation)
+            return;
+
+        m_rows[row].html = watcher->result();
+        m_rows[row].ready = true;
+        m_snapshotChanged = true;
+        QModelIndex changed = index(row);
+        dataChanged(changed, changed, {HtmlRole, ReadyRole});
+    });
+
+    watcher->setFuture(QtConcurrent::run([database, topic, sectionHeader, row]() {
+        QElapsedTimer timer;
+        timer.start();
+        QString html = database->renderTopic(topic, sectionHeader);
+        qDebug() << "TopicListModel::render: Rendered row" << row << "in" << timer.elapsed() << "ms.";
+        return html;
+    }));
+}
+
+
+/** @brief Remove all topics and discard the results of all running background work. */
+void TopicListModel::clear() {
+    m_generation++;
+    m_snapshotChanged = false;
+
+    if (m_loading) {
+        m_loading = false;
+        loadingChanged();
+    }
+
+    if (!m_rows.isEmpty()) {
+        beginResetModel();
+        m_rows.clear();
+        endResetModel();
+        countChanged();
+    }
+}
+
+
+/**
+ * @brief Store the rows of the current search in the snapshot store, including their rendered content.
+ * @details Nothing is stored unless rows were rendered since the search was shown, such as when the
+ *   search was still running, or when it was shown from a snapshot and not scrolled any further. So
+ *   navigating back and forth between searches does not write the snapshot file again and again.
+ */
+void TopicListModel::saveSnapshot() {
+    if (!m_snapshots || m_snapshotKey.isEmpty() || !m_snapshotChanged)
+        return;
+    m_snapshotChanged = false;
+
+    QByteArray page;
+    QDataStream out(&page, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << qint32(m_rows.size());
+    for (const Row& row : m_rows)
+        out << row.topic.id << row.topic.title << row.topic.section << row.topic.version << row.topic.content
+            << row.sectionHeader << row.ready << row.html;
+
+    m_snapshots->store(m_snapshotKey, qCompress(page));
+}
+
+
+/**
+ * @brief Show the rows of a snapshot. Rows that were not rendered when the snapshot was taken are
+ *   rendered when requested, as usual.
+ * @return true if a snapshot was shown, false if there is no usable snapshot for the key.
+ */
+bool TopicListModel::restoreSnapshot(QString key) {
+    if (!m_snapshots || !m_snapshots->contains(key))
+        return false;
+
+    QByteArray page = qUncompress(m_snapshots->page(key));
+    QDataStream in(page);
+    in.setVersion(QDataStream::Qt_5_12);
+
+    qint32 count;
+    in >> count;
+    QVector<Row> rows;
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        Row row;
+        in >> row.topic.id >> row.topic.title >> row.topic.section >> row.topic.version >> row.topic.content
+           >> row.sectionHeader >> row.ready >> row.html;
+        row.renderRequested = row.ready;
+        rows << row;
+    }
+    if (in.status() != QDataStream::Ok || rows.isEmpty())
+        return false;
+
+    beginInsertRows(QModelIndex(), 0, rows.size() - 1);
+    m_rows = rows;
+    endInsertRows();
+    countChanged();
+
+    qDebug() << "TopicListModel::restoreSnapshot: Showing" << rows.size() << "topics from snapshot.";
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QVector>
+
+#include "ContentDatabase.h"
+
+class SnapshotStore;
+
+class TopicListModel : public QAbstractListModel {
+
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
+
+public:
+    enum Roles {
+        SectionRole = Qt::UserRole + 1,
+        TitleRole,
+        HtmlRole,
+        ReadyRole
+    };
+
+    explicit TopicListModel(ContentDatabase* database, QObject* parent = 0);
+
+    ~TopicListModel();
+
+    void setSnapshotStore(SnapshotStore* snapshots);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    QHash<int, QByteArray> roleNames() const override;
+
+    int count() const;
+
+    bool loading() const;
+
+    Q_INVOKABLE // Allows to invoke this method from QML.
+    void search(QString searchTerm, QString language);
+
+    Q_INVOKABLE
+    void render(int row);
+
+    Q_INVOKABLE
+    void clear();
+
+signals:
+    void countChanged();
+    void loadingChanged();
+    void searchFinished(QString searchTerm, int count);
+
+private:
+    struct Row {
+        ContentTopic topic;
+        bool sectionHeader = true;  // If this is the first topic of its section.
+        bool renderRequested = false;
+        bool ready = false;
+        QString html;
+    };
+
+    void saveSnapshot();
+    bool restoreSnapshot(QString key);
+
+    ContentDatabase* m_database;
+    SnapshotStore* m_snapshots;
+    QString m_snapshotKey; // Identifies the search shown, for storing it as a snapshot.
+    bool m_snapshotChanged; // If rows were rendered since the search was shown or stored as a snapshot.
+    QVector<Row> m_rows;
+    int m_generation;
+    bool m_loading;
+};
@@ -18,16 +18,29 @@
 #include <ZXing/ReadBarcode.h>
 
 #include <QImage>
+#include <QPainter>
 #include <QDebug>
 #include <QMetaType>
 
 #ifdef QT_MULTIMEDIA_LIB
 #include <QAbstractVideoFilter>
 #include <QElapsedTimer>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+
+#include "FrameRecorder.h"
+#include "MemoryBudget.h"
+#include "MultiScanner.h"
+#include "ScanStatistics.h"
+#include "ScanlineEanReader.h"
 #endif
 
 // This is a verbatim copy of some sample code from zxing-cpp. This is likely going to be part
-// of the official zxing-cpp installation at some point.
+// of the official zxing-cpp installation at some point. Changes for this application are kept to
+// hooks here; the scanner's own classes (ScanlineEanReader, MultiScanner, ScanStatistics,
+// FrameRecorder) are in their own files.
 
 namespace ZXingQt {
 
@@ -134,12 +147,38 @@ public:
 	const QByteArray& rawBytes() const { return _rawBytes; }
 	const Position& position() const { return _position; }
 
+	// Move the position, such as when the barcode was found in a part of a larger image.
+	void translate(int dx, int dy)
+	{
+		QPoint d(dx, dy);
+		_position = {_position.topLeft() + d, _position.topRight() + d, _position.bottomRight() + d,
+					 _position.bottomLeft() + d};
+	}
+
 	// For debugging/development
 	int runTime = 0;
 	Q_PROPERTY(int runTime MEMBER runTime)
+
+	// If found by ScanlineEanReader instead of the full zxing decode.
+	bool fastPath = false;
+	Q_PROPERTY(bool fastPath MEMBER fastPath)
 };
 
-inline Result ReadBarcode(const QImage& img, const DecodeHints& hints = {})
+// Convert an image into buffer in RGBX format, which zxing can read. The buffer is reused as long as
+// the image size stays the same.
+inline void ConvertToRGBX(const QImage& img, QImage& buffer)
+{
+	if (buffer.size() != img.size() || buffer.format() != QImage::Format_RGBX8888)
+		buffer = QImage(img.size(), QImage::Format_RGBX8888);
+	QPainter painter(&buffer);
+	painter.setCompositionMode(QPainter::CompositionMode_Source);
+	painter.drawImage(0, 0, img);
+	painter.end();
+}
+
+// If given, images in formats not supported by zxing are converted into *conversionBuffer, which is
+// reused as long as the image size stays the same. Otherwise, a new image is allocated per call.
+inline Result ReadBarcode(const QImage& img, const DecodeHints& hints = {}, QImage* conversionBuffer = nullptr)
 {
 	using namespace ZXing;
 
@@ -164,26 +203,28 @@ inline Result ReadBarcode(const QImage& img, const DecodeHints& hints = {})
 		return Result(ZXing::ReadBarcode({img.bits(), img.width(), img.height(), ImgFmtFromQImg(img)}, hints));
 	};
 
-	return ImgFmtFromQImg(img) == ImageFormat::None ? exec(img.convertToFormat(QImage::Format_RGBX8888)) : exec(img);
+	if (ImgFmtFromQImg(img) != ImageFormat::None)
+		return exec(img);
+	if (!conversionBuffer)
+		return exec(img.convertToFormat(QImage::Format_RGBX8888));
+
+	ConvertToRGBX(img, *conversionBuffer);
+	return exec(*conversionBuffer);
 }
 
 #ifdef QT_MULTIMEDIA_LIB
-inline Result ReadBarcode(const QVideoFrame& frame, const DecodeHints& hints = {})
+// Determine how zxing can read the pixels of a video frame in place. fmt is ImageFormat::None if the
+// pixel format has to be converted first.
+inline void ImageFormatFromVideoFrame(QVideoFrame::PixelFormat pixelFormat, ZXing::ImageFormat& fmt, int& pixStride,
+									  int& pixOffset)
 {
 	using namespace ZXing;
 
-	auto img = frame; // shallow copy just get access to non-const map() function
-	if (!frame.isValid() || !img.map(QAbstractVideoBuffer::ReadOnly)){
-		qWarning() << "invalid QVideoFrame: could not map memory";
-		return {};
-	}
-	//TODO c++17:	SCOPE_EXIT([&] { img.unmap(); });
-
-	ImageFormat fmt = ImageFormat::None;
-	int pixStride = 0;
-	int pixOffset = 0;
+	fmt = ImageFormat::None;
+	pixStride = 0;
+	pixOffset = 0;
 
-	switch (img.pixelFormat()) {
+	switch (pixelFormat) {
 	case QVideoFrame::Format_ARGB32:
 	case QVideoFrame::Format_ARGB32_Premultiplied:
 	case QVideoFrame::Format_RGB32:
@@ -244,16 +285,49 @@ inline Result ReadBarcode(const QVideoFrame& frame, const DecodeHints& hints = {
 #endif
 	default: break;
 	}
+}
+
+// If given, *dropped is set to whether the frame could not be searched for a barcode at all, because
+// it could not be mapped into memory or its pixel format is not supported. For conversionBuffer, see above.
+inline Result ReadBarcode(const QVideoFrame& frame, const DecodeHints& hints = {}, bool* dropped = nullptr,
+						  QImage* conversionBuffer = nullptr)
+{
+	using namespace ZXing;
+
+	if (dropped)
+		*dropped = true;
+
+	auto img = frame; // shallow copy just get access to non-const map() function
+	if (!frame.isValid() || !img.map(QAbstractVideoBuffer::ReadOnly)){
+		qWarning() << "invalid QVideoFrame: could not map memory";
+		return {};
+	}
+	//TODO c++17:	SCOPE_EXIT([&] { img.unmap(); });
+
+	ImageFormat fmt = ImageFormat::None;
+	int pixStride = 0;
+	int pixOffset = 0;
+	ImageFormatFromVideoFrame(img.pixelFormat(), fmt, pixStride, pixOffset);
 
 	Result res;
 	if (fmt != ImageFormat::None) {
-		res = Result(
-			ZXing::ReadBarcode({img.bits() + pixOffset, img.width(), img.height(), fmt, img.bytesPerLine(), pixStride},
-							   hints));
+		if (fmt == ImageFormat::Lum && ScanlineEanReader::supports(hints)) {
+			res = Result(ScanlineEanReader::read(img.bits() + pixOffset, img.width(), img.height(),
+												 img.bytesPerLine(), pixStride, hints));
+			res.fastPath = res.isValid();
+		}
+		if (!res.isValid())
+			res = Result(ZXing::ReadBarcode(
+				{img.bits() + pixOffset, img.width(), img.height(), fmt, img.bytesPerLine(), pixStride}, hints));
+		if (dropped)
+			*dropped = false;
 	} else {
 		auto qfmt = QVideoFrame::imageFormatFromPixelFormat(img.pixelFormat());
-		if (qfmt != QImage::Format_Invalid)
-			res = ReadBarcode(QImage(img.bits(), img.width(), img.height(), qfmt), hints);
+		if (qfmt != QImage::Format_Invalid) {
+			res = ReadBarcode(QImage(img.bits(), img.width(), img.height(), qfmt), hints, conversionBuffer);
+			if (dropped)
+				*dropped = false;
+		}
 	}
 
 	img.unmap();
@@ -279,7 +353,15 @@ class VideoFilter : public QAbstractVideoFilter, private DecodeHints
 	Q_OBJECT
 
 public:
-	VideoFilter(QObject* parent = nullptr) : QAbstractVideoFilter(parent) {}
+	VideoFilter(QObject* parent = nullptr) : QAbstractVideoFilter(parent)
+	{
+		// The conversion buffer is only needed for some pixel formats. It is counted in the budget, but not
+		// evictable: every frame would allocate it again at the same size, so evicting it frees nothing.
+		_budgetId = MemoryBudget::instance()->registerCache("VideoFilter", "conversionBuffer", 1,
+															MemoryBudget::Evictor());
+	}
+
+	~VideoFilter() override { MemoryBudget::instance()->unregisterCache(_budgetId); }
 
 	QVideoFilterRunnable* createFilterRunnable() override;
 
@@ -304,25 +386,104 @@ public:
 	ZQ_PROPERTY(bool, tryRotate, setTryRotate)
 	ZQ_PROPERTY(bool, tryHarder, setTryHarder)
 
+	// Performance statistics of all frames processed since the last statistics.reset().
+	Q_PROPERTY(ScanStatistics* statistics READ statistics CONSTANT)
+	ScanStatistics* statistics() const noexcept { return _statistics; }
+
+	// Continuous scanning of multiple barcodes per frame, see MultiScanner. Barcodes are then reported
+	// in batches by foundBarcodes(), each barcode once while it stays in view, and foundBarcode() is
+	// not emitted.
+	Q_PROPERTY(bool multiScan READ multiScan WRITE setMultiScan NOTIFY multiScanChanged)
+	bool multiScan() const noexcept { return _multiScan.load(); }
+	Q_SLOT void setMultiScan(bool newVal)
+	{
+		if (multiScan() != newVal) {
+			_multiScan.store(newVal);
+			emit multiScanChanged();
+		}
+	}
+	Q_SIGNAL void multiScanChanged();
+
+	// File to record all frames to, for replaying them later. Empty to not record. See FrameRecorder.
+	Q_PROPERTY(QString recordFile READ recordFile WRITE setRecordFile NOTIFY recordFileChanged)
+	QString recordFile() const { QMutexLocker l(&_recordMutex); return _recordFile; }
+	Q_SLOT void setRecordFile(const QString& newVal)
+	{
+		{
+			QMutexLocker l(&_recordMutex);
+			if (_recordFile == newVal)
+				return;
+			_recordFile = newVal;
+		}
+		emit recordFileChanged();
+	}
+	Q_SIGNAL void recordFileChanged();
+
 public slots:
 	Result process(const QVideoFrame& image)
 	{
+		// Recording is not part of the decode time. The file is opened here, by the video thread recording
+		// to it. Outside of the lock, as closing waits for the frames still pending to be written.
+		QString recordFile = this->recordFile();
+		if (recordFile != _recordingFile) {
+			_recordingFile = recordFile;
+			_recorder.close();
+			if (!recordFile.isEmpty())
+				_recorder.open(recordFile);
+		}
+		if (_recorder.isOpen())
+			_recorder.record(image);
+
 		QElapsedTimer t;
 		t.start();
 
-		auto res = ReadBarcode(image, *this);
+		bool dropped = false;
+		const bool multiScan = _multiScan.load();
+		auto res = multiScan ? _multiScanner.scan(image, *this, &dropped, &_conversionBuffer)
+							 : ReadBarcode(image, *this, &dropped, &_conversionBuffer);
 
 		res.runTime = t.elapsed();
 
+		if (_conversionBuffer.sizeInBytes() != _bufferBytes) {
+			_bufferBytes = _conversionBuffer.sizeInBytes();
+			MemoryBudget::instance()->report(_budgetId, _bufferBytes);
+		}
+
+		if (dropped)
+			_statistics->recordDroppedFrame();
+		else
+			_statistics->recordFrame(res, image.pixelFormat());
+
 		emit newResult(res);
-		if (res.isValid())
+		if (res.isValid() && !multiScan)
 			emit foundBarcode(res);
+		if (multiScan) {
+			QStringList batch = _multiScanner.takeBatch();
+			if (!batch.isEmpty())
+				emit foundBarcodes(batch);
+		}
 		return res;
 	}
 
 signals:
 	void newResult(Result result);
 	void foundBarcode(Result result);
+	void foundBarcodes(QStringList codes);
+
+private:
+	ScanStatistics* _statistics = new ScanStatistics(this);
+
+	QAtomicInt _multiScan;
+	MultiScanner _multiScanner; // Only accessed by the video thread.
+
+	mutable QMutex _recordMutex;
+	QString _recordFile;
+	QString _recordingFile;  // The recordFile last acted on. Only accessed by the video thread.
+	FrameRecorder _recorder; // Only accessed by the video thread.
+
+	QImage _conversionBuffer; // Only accessed by the video thread.
+	qint64 _bufferBytes = 0;  // Size of _conversionBuffer as last reported. Only accessed by the video thread.
+	int _budgetId = 0;
 };
 
 #undef ZX_PROPERTY
@@ -374,6 +535,9 @@ inline void registerQmlAndMetaTypes()
         	ZXingQt::staticMetaObject, "ZXing", 1, 0, "ZXing", "Access to enums & flags only"
 	);
 	qmlRegisterType<ZXingQt::VideoFilter>("ZXing", 1, 0, "VideoFilter");
+	qmlRegisterUncreatableType<ScanStatistics>(
+		"ZXing", 1, 0, "ScanStatistics", "Available as VideoFilter.statistics only"
+	);
 }
 
 } // namespace ZXingQt
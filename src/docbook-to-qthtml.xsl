@@ -229,16 +229,22 @@
 
         <xsl:if test="./db:topic[@type = $topictype]" >
 
-            <!-- Create a gap to the previous content.
-                This is automatically rendered with zero height at the start of the document due to
-                a Qt bug, but in this case this is an advantage over table { margin-top: 56px; }.
-            -->
-            <div class="spacer-40">.</div>
-
-            <!-- Render the section title. -->
-            <table class="h1" width="100%">
-                <tr><td><h1><xsl:value-of select="$header" /></h1></td></tr>
-            </table>
+            <!-- Render the section header unless the caller suppressed it, which is done when rendering
+                topics one by one (see TopicListModel) for all but the first topic of a section. -->
+            <xsl:if test="$section-header = 'yes'">
+
+                <!-- Create a gap to the previous content.
+                    This is automatically rendered with zero height at the start of the document due to
+                    a Qt bug, but in this case this is an advantage over table { margin-top: 56px; }.
+                -->
+                <div class="spacer-40">.</div>
+
+                <!-- Render the section title. -->
+                <table class="h1" width="100%">
+                    <tr><td><h1><xsl:value-of select="$header" /></h1></td></tr>
+                </table>
+
+            </xsl:if>
 
             <!-- Render the topics within the section. -->
             <xsl:for-each select="./db:topic[@type = $topictype]" >
@@ -8,11 +8,26 @@
 #include <QQmlApplicationEngine>
 #include <QtQml>
 #include <QDebug>
+#include <QCommandLineParser>
+#include <QStandardPaths>
+#include <QDir>
+#include <QThread>
+#include <QTextStream>
 
 #include "ZXingQtReader.h"
 #include "ContentDatabase.h"
+#include "BatchDecoder.h"
+#include "FrameReplay.h"
+#include "ContentUpdater.h"
+#include "ContentPack.h"
+#include "DatabaseValidator.h"
+#include "TopicListModel.h"
+#include "CategoryBrowserModel.h"
+#include "SnapshotStore.h"
 #include "History.h"
 #include "LocaleChanger.h"
+#include "MemoryBudget.h"
+#include "QueryServer.h"
 
 // Export main() as part of a library interface. Needed on Android.
 //   Q_DECL_EXPORT is a Qt MOC macro that exposes main() as part of the interface of a
@@ -38,29 +53,180 @@ int main(int argc, char *argv[]) {
 
 	ZXingQt::registerQmlAndMetaTypes();
 
-    // Create and initialize the Food Rescue SQLite3 database connection.
+    // Create the memory budget of all caches, indexes and buffers, before anything registers with it.
+    //   It evicts from the main thread, and is owned by the application object.
+    MemoryBudget::create(&app);
+
+    // Create the Food Rescue SQLite3 database object.
+    //   It is connected below, only in the modes that use it, as connecting validates the database
+    //   file and builds in-memory indexes.
     ContentDatabase db;
+
+    // Evaluate the application's own command line options.
+    //   Using parse() instead of process() so that unknown options (as possibly given by a platform
+    //   launcher) do not prevent the application from starting.
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Food Rescue App");
+    QCommandLineOption helpOption = parser.addHelpOption();
+    QCommandLineOption batchDecodeOption(
+        "batch-decode", "Decode the barcodes in all images in <directory> and exit.", "directory");
+    QCommandLineOption outputOption(
+        "output", "Write batch decoding results to <file> instead of standard output.", "file", "-");
+    QCommandLineOption outputFormatOption(
+        "output-format", "Batch decoding output format: csv or json.", "format", "csv");
+    QCommandLineOption resolveOption(
+        "resolve", "Resolve decoded barcodes to their category names in <language>.", "language");
+    QCommandLineOption recordFramesOption(
+        "record-frames", "Record all camera frames seen by the barcode scanner to <file>.", "file");
+    QCommandLineOption replayOption(
+        "replay", "Replay the camera frames recorded in <file> through the barcode scanner, report its performance and exit.", "file");
+    QCommandLineOption maxSpeedOption(
+        "max-speed", "Replay frames as fast as possible instead of at their recorded times.");
+    QCommandLineOption createChangesetOption(
+        "create-changeset", "Write the changes from database --from to database --to into <file> and exit.", "file");
+    QCommandLineOption fromOption(
+        "from", "The old database to create a changeset for.", "database");
+    QCommandLineOption toOption(
+        "to", "The new database to create a changeset for.", "database");
+    QCommandLineOption applyChangesetOption(
+        "apply-changeset", "Update the content database with the changeset in <file>.", "file");
+    QCommandLineOption createPackOption(
+        "create-pack", "Compile <database> into a content pack next to it and exit.", "database");
+    QCommandLineOption checkQueryPlansOption(
+        "check-query-plans", "Check the query plans and times of all SQL statements on <database> and exit.", "database");
+    QCommandLineOption memoryLimitOption(
+        "memory-limit", "Maximum MiB of memory used by all caches, indexes and image buffers together.", "mebibytes", "64");
+    QCommandLineOption serveOption(
+        "serve", "Serve lookups to local clients on socket <name> instead of showing the user interface.", "name");
+    QCommandLineOption serveWorkersOption(
+        "serve-workers", "Number of threads executing lookups for local clients.", "count",
+        QString::number(QThread::idealThreadCount()));
+    parser.addOptions({batchDecodeOption, outputOption, outputFormatOption, resolveOption,
+                       recordFramesOption, replayOption, maxSpeedOption, createChangesetOption, fromOption, toOption, applyChangesetOption, createPackOption,
+                       checkQueryPlansOption, memoryLimitOption, serveOption, serveWorkersOption});
+    if (!parser.parse(app.arguments()))
+        qWarning() << "Ignoring command line:" << parser.errorText();
+    if (parser.isSet(helpOption))
+        parser.showHelp();
+
+    // One memory limit for all caches, indexes and buffers, so it can be adapted to the device.
+    MemoryBudget::instance()->setLimit(qint64(parser.value(memoryLimitOption).toInt()) * 1024 * 1024);
+
+    // Batch decoding mode: runs without user interface.
+    if (parser.isSet(batchDecodeOption)) {
+        BatchDecoder decoder;
+        if (parser.isSet(resolveOption)) {
+            db.connect();
+            decoder.setResolver(&db, parser.value(resolveOption));
+        }
+
+        BatchDecoder::OutputFormat format =
+            parser.value(outputFormatOption) == "json" ? BatchDecoder::JSON : BatchDecoder::CSV;
+        bool success = decoder.run(parser.value(batchDecodeOption), parser.value(outputOption), format);
+
+        return success ? 0 : 1;
+    }
+
+    // Frame replay mode, for measuring the barcode scanner without a camera: runs without user interface.
+    if (parser.isSet(replayOption)) {
+        FrameReplay replay;
+        replay.setMaxSpeed(parser.isSet(maxSpeedOption));
+        QTextStream out(stdout);
+        return replay.run(parser.value(replayOption), out) ? 0 : 1;
+    }
+
+    // Changeset creation mode, used when publishing content updates: runs without user interface.
+    if (parser.isSet(createChangesetOption)) {
+        bool success = ContentUpdater::createChangeset(
+            parser.value(fromOption), parser.value(toOption), parser.value(createChangesetOption)
+        );
+        return success ? 0 : 1;
+    }
+
+    // Content pack creation mode, used when building the content database: runs without user interface.
+    if (parser.isSet(createPackOption)) {
+        QString database = parser.value(createPackOption);
+        return ContentPack::create(database, ContentPack::packFile(database)) ? 0 : 1;
+    }
+
+    // Query plan check mode, used when building the content database: runs without user interface.
+    //   Exits with 1 if a statement lost an index or is too slow, so a broken build can be caught.
+    if (parser.isSet(checkQueryPlansOption)) {
+        QTextStream out(stdout);
+        return DatabaseValidator::checkQueryPlans(parser.value(checkQueryPlansOption), out) ? 0 : 1;
+    }
+
+    // Query server mode, for other processes on the same device: runs without user interface.
+    if (parser.isSet(serveOption)) {
+        db.connect();
+        QueryServer server(&db);
+        db.setLanguage(QLocale().name());
+        if (!server.listen(parser.value(serveOption), parser.value(serveWorkersOption).toInt()))
+            return 1;
+        return app.exec();
+    }
+
+    // Interactive mode from here on.
     db.connect();
 
-    // Make the Food Rescue database available for use in QML.
-    // TODO: Better than registering the type to be instantiated as a singleton object in QML, provide
-    //   the above "db" object as a context property that is accessible in QML. For that, use
-    //   engine.rootContext()->setContextProperty
-    qmlRegisterType<ContentDatabase>("local", 1, 0, "ContentDatabase");
+    // Make the Food Rescue database type known to QML.
+    //   It is not instantiable from QML, because the in-memory indexes built by db.connect() should
+    //   exist only once. The "db" object is provided as context property "database" below instead.
+    qmlRegisterUncreatableType<ContentDatabase>(
+        "local", 1, 0, "ContentDatabase", "Use the context property \"database\" instead."
+    );
+    qmlRegisterUncreatableType<CompletionModel>(
+        "local", 1, 0, "CompletionModel", "Use property \"completionModel\" of \"database\" instead."
+    );
 
     QQmlApplicationEngine engine;
 
+    // Make the Food Rescue database available for use in QML.
+    engine.rootContext()->setContextProperty("database", &db);
+
+    // Tell the barcode scanner where to record camera frames to, if at all. See FrameReplay.
+    engine.rootContext()->setContextProperty("frameRecordFile", parser.value(recordFramesOption));
+
+    // Provide the topics of the current search as a model, so QML can show them as they become ready.
+    qmlRegisterUncreatableType<TopicListModel>(
+        "local", 1, 0, "TopicListModel", "Use the context property \"topicModel\" instead."
+    );
+    //   The last pages shown are kept as snapshots, so they can be shown again instantly, even after
+    //   a restart.
+    QString appDataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(appDataDir);
+    SnapshotStore snapshots(appDataDir + "/snapshots.dat", 5, 4 * 1024 * 1024);
+    TopicListModel topicModel(&db);
+    topicModel.setSnapshotStore(&snapshots);
+    engine.rootContext()->setContextProperty("topicModel", &topicModel);
+
+    // Provide the category hierarchy as a model that fetches its rows page by page, for browsing it.
+    qmlRegisterUncreatableType<CategoryBrowserModel>(
+        "local", 1, 0, "CategoryBrowserModel", "Use the context property \"categoryModel\" instead."
+    );
+    CategoryBrowserModel categoryModel(&db);
+    engine.rootContext()->setContextProperty("categoryModel", &categoryModel);
+
     // Set up the language switcher and make it available to QML.
+    //   The database keeps its in-memory indexes for the UI language only, so it follows all changes.
     LocaleChanger localeChanger(&engine, QString("/i18n"), QString("foodrescue_"));
     engine.rootContext()->setContextProperty("localeChanger", &localeChanger);
+    QObject::connect(&localeChanger, &LocaleChanger::localeChanged, &db, &ContentDatabase::setLanguage);
 
     // Set up the global history object and make it available to QML.
     //   TODO: Insteaf of "", use a different homepage identifier, so that navigating back there
     //   will indeed bring one back to the start screen. For that, a search term of "home:" could
     //   be used, similar to the "config:" special URL in Firefox.
     History browserHistory("");
+    browserHistory.setStorage(appDataDir + "/history.dat", 200, 64 * 1024);
     engine.rootContext()->setContextProperty("browserHistory", &browserHistory);
 
+    // Make the memory usage of caches available to QML, for diagnostics.
+    qmlRegisterUncreatableType<MemoryBudget>(
+        "local", 1, 0, "MemoryBudget", "Use the context property \"memoryBudget\" instead."
+    );
+    engine.rootContext()->setContextProperty("memoryBudget", MemoryBudget::instance());
+
     // Use different main files on desktop vs. mobile platform.
     // TODO: Switch to the "qrc:/something" URLs if possible. So far not working.
     const QUrl desktopQML(QStringLiteral("qrc:///qml/App.qml"));
@@ -78,6 +244,18 @@ int main(int argc, char *argv[]) {
         QCoreApplication::exit(-1);
     }
 
+    // Apply content updates in the background and switch to the updated database when ready.
+    //   Changesets given earlier but not applied yet (such as when the application was closed before)
+    //   are applied as well.
+    ContentUpdater updater;
+    QObject::connect(&updater, &ContentUpdater::updated, &db, &ContentDatabase::switchDatabase);
+    if (!ContentDatabase::databaseFile().isEmpty()) {
+        QStringList changesets;
+        if (parser.isSet(applyChangesetOption))
+            changesets << parser.value(applyChangesetOption);
+        updater.apply(changesets, ContentDatabase::databaseFile());
+    }
+
     // i18n management
 
     // Determine the target language to switch to.
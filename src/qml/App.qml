@@ -39,6 +39,18 @@ Kirigami.ApplicationWindow {
         root.pageStack.currentItem.forceActiveFocus()
     }
 
+    // Tell the user when the content database is damaged, as content may then be missing.
+    //   The damage may be found before this window exists, or later by a background check.
+    function reportDatabaseDamage() {
+        if (database.damage !== "")
+            showPassiveNotification(qsTr("The content database is damaged. Please reinstall the app."), "long")
+    }
+
+    Connections {
+        target: database
+        onDamageChanged: root.reportDatabaseDamage()
+    }
+
     Component.onCompleted: {
 
         // Replace the initial window size bindings with static values, preventing messups on language changes.
@@ -70,6 +82,8 @@ Kirigami.ApplicationWindow {
         //   In addition, the same line has to be in addressBar.Component.onCompleted in MainPage.qml
         //   for some reason.
         root.pageStack.currentItem.forceActiveFocus()
+
+        reportDatabaseDamage()
     }
 
     // Left sidebar drawer with the main menu.
@@ -88,6 +102,17 @@ Kirigami.ApplicationWindow {
 //              icon.name: "star-shape"
 //              onTriggered: pageStack.layers.push(Qt.resolvedUrl("qrc:///qml/StarsPage.qml"))
 //          },
+            Kirigami.Action {
+                text: qsTr("Browse Categories")
+                icon.name: "view-list-tree"
+                onTriggered: {
+                    var categoriesPage = pageStack.layers.push(Qt.resolvedUrl("qrc:///qml/CategoriesPage.qml"))
+                    categoriesPage.categorySelected.connect(function(name) {
+                        pageStack.layers.pop()
+                        browserPage.displayContent(name)
+                    })
+                }
+            },
             Kirigami.Action {
                 text: qsTr("Settings")
                 icon.name: "configure"
@@ -45,13 +45,10 @@ FocusScope {
     height: field.height
 
     // Data source containing the current autocomplete suggestions.
-    //   This property must be set when instantiating this QML component. Acceptable models are string
-    //   list models only. In JavaScript, these are a string array, so access it with [index], not the usual
-    //   .get(index). To implement such a model in C++, use QStringList.
-    //
-    //   TODO: Allow client code of this component to set this property to any type of model accepted by a
-    //   Repeater. See: https://doc.qt.io/qt-5/qml-qtquick-repeater.html#model-prop . Right now, only a
-    //   QStringList is accepted.
+    //   This property must be set when instantiating this QML component. Acceptable models are list
+    //   models with the roles "display" (the completion) and "highlightedText" (the completion as
+    //   HTML, with the completed parts highlighted), plus a method text(index) to access the
+    //   completion in a row from JavaScript. See CompletionModel in C++.
     property alias model: completions.model
 
     // The currently active, in-use user input that is the basis for the current completions.
@@ -86,6 +83,10 @@ FocusScope {
     // it is selected.
     signal accepted()
 
+    // This signal is emitted when a completion gets selected, such as by navigating through the
+    // completions with the arrow keys. It is a hint that this completion might be accepted next.
+    signal highlighted(string text)
+
     // React to our own auto-provided signal for a change in the "input" property.
     //   When client code also implements onInputChanged when instantiating an AutoComplete, it
     //   will not overwrite this handler but add to it. So no caveats when reacting to own signals.
@@ -102,62 +103,6 @@ FocusScope {
     //   by the model used.
     function normalize(input) { return input }
 
-    // Highlight the auto-completed parts of a multi-substring search term using HTML.
-    //
-    // This implementation uses <b> tags to highlight the completed portions. Client code can
-    // overwrite this to implement a different type of completion.
-    //
-    // @param fragmentsString  The part to not render in bold, when matched case-insensitively against the
-    //   completion.
-    //
-    // TODO: Document the parameters.
-    // TODO: Make sure original contains no HTML tags by sanitizing these. Otherwise searching
-    //   for parts of original below may match "word</b>" etc. and mess up the result.
-    // TODO: Add a parameter to make it configurable which HTML tag (incl. attributes) to use for the
-    //   highlighting.
-    // TODO: Maybe add a parameter to de-highlight the original parts with configurable HTML.
-    // TODO: It seems better to do this in C++, as it will be much faster in regex processing etc..
-    //   And it seems to be the responsibility of the model, and all models of this application are
-    //   done in C++ as a convention.
-    function highlightCompletion(completion, fragmentsString) {
-        var fragments = fragmentsString.trim().split(" ")
-
-        // Tracks the current processing position in "completion".
-        //   This ensures that fragments are found in their given sequence. It also prevents
-        //   modifying the <b> HTML tags themselves by matching against a "b" fragment. We'll simply
-        //   work only on the part that has not yet had any insertions of HTML tags.
-        var searchPos = 0
-
-        // De-bold the sequential first occurrences of the fragments.
-        for (var i = 0; i < fragments.length; i++) {
-            var iCompletion = completion.toLowerCase() // "i" as in "case-Insensitive"
-            var fragment = fragments[i]
-            var fragmentStart = iCompletion.indexOf(fragment.toLowerCase(), searchPos)
-
-            // Nothing to de-bolden if fragment was not found.
-            //   TODO: This is an error condition that should generate a warning.
-            if (fragmentStart === -1)
-                continue
-
-            var fragmentEnd = fragmentStart + fragment.length
-            var completionBefore = completion.substr(0, fragmentStart)
-            var completionDebold = completion.substr(fragmentStart, fragment.length)
-            var completionAfter = completion.substr(fragmentEnd)
-
-            completion = completionBefore + "</b>" + completionDebold + "<b>" + completionAfter
-
-            // The search for the next fragment may start with completionAfter. That's after all HTML
-            // tags inserted so far, which prevents messing them up when a "b" fragment matches against them.
-            searchPos = completion.length - completionAfter.length - 1
-        }
-
-        // Wrap everything in bold to provide the proper "context" for the de-boldening above.
-        //   This could not be done before to prevent matches of a "b" fragment against </b>".
-        completion = "<b>" + completion + "</b>"
-
-        return completion
-    }
-
     // The text field where a user enters to-be-completed text.
     TextField {
         id: field
@@ -198,7 +143,7 @@ FocusScope {
             //   TODO: Probably better implement this reactively via onModelChanged, if there is such a thing.
             completions.currentIndex = -1
 
-            completionsVisible = completions.model.length > 0 ? true : false;
+            completionsVisible = completions.count > 0 ? true : false;
         }
 
         // Handle the "text accepted" event, which sets the input from the text.
@@ -229,8 +174,8 @@ FocusScope {
         }
 
         onActiveFocusChanged: {
-            if (activeFocus && completions.model.length > 0)
-                completionsVisible = (text == "" || text.match("^[0-9 ]+$")) ? false : true
+            if (activeFocus && completions.count > 0)
+                completionsVisible = text == "" ? false : true
                 // TODO: Probably better use "input" instead of "text" in the line above.
                 // TODO: Perhaps initialize the completions with suggestions based on the current
                 // text. If the reason for not having the focus before was a previous
@@ -260,14 +205,14 @@ FocusScope {
 
                     // When moving prior the first item, cycle through completions from the end again.
                     if (completions.currentIndex < 0)
-                        completions.currentIndex = completions.model.length - 1
+                        completions.currentIndex = completions.count - 1
 
                     console.log(
-                        "completions.model[" + completions.currentIndex + "]: " +
-                        JSON.stringify(completions.model[completions.currentIndex])
+                        "completions.model.text(" + completions.currentIndex + "): " +
+                        JSON.stringify(completions.model.text(completions.currentIndex))
                     )
 
-                    field.text = completions.model[completions.currentIndex]
+                    field.text = completions.model.text(completions.currentIndex)
                     event.accepted = true
                     break
 
@@ -275,10 +220,10 @@ FocusScope {
                     completions.currentIndex++
 
                     // When moving past the last item, cycle through completions from the start again.
-                    if (completions.currentIndex > completions.model.length - 1)
+                    if (completions.currentIndex > completions.count - 1)
                         completions.currentIndex = 0
 
-                    field.text = completions.model[completions.currentIndex]
+                    field.text = completions.model.text(completions.currentIndex)
                     event.accepted = true
                     break
 
@@ -301,7 +246,7 @@ FocusScope {
                     break
 
                 case Qt.Key_Down:
-                    completionsVisible = completions.model.length > 0 ? true : false
+                    completionsVisible = completions.count > 0 ? true : false
 
                     event.accepted = true
                     break
@@ -347,7 +292,7 @@ FocusScope {
 //
 //          onClicked: {
 //              console.log("AutoComplete: field: clicked() received")
-//              completionsVisible = completions.model.length > 0 ? true : false
+//              completionsVisible = completions.count > 0 ? true : false
 //              mouse.accepted = false
 //          }
 //          // onPressed:         mouse.accepted = false
@@ -384,13 +329,21 @@ FocusScope {
                     // Repeater lacks ListView's currentIndex, so we'll add it.
                     property int currentIndex: -1 // No element highlighted initially.
 
+                    onCurrentIndexChanged: {
+                        if (currentIndex >= 0)
+                            autocomplete.highlighted(model.text(currentIndex))
+                    }
+
                     // A delegate renders one list item.
+                    //   Delegates are kept when the model changes, except for the rows that the model
+                    //   reports as removed or inserted.
                     //   TODO: Use a basic QML component to not tie AutoComplete to Kirigami. Or
                     //   document what can be used here when wanting to use it independent of Kirigami.
                     delegate: Kirigami.BasicListItem {
                         id: listItem
 
-                        label: highlightCompletion(modelData, autocomplete.input)
+                        // Highlighting is precomputed by the model, based on the current input.
+                        label: model.highlightedText
                         width: completionsBox.width
                         reserveSpaceForIcon: false
 
@@ -399,9 +352,9 @@ FocusScope {
                         highlighted: index == completions.currentIndex
 
                         onClicked: {
-                            console.log("modelData = " + JSON.stringify(modelData))
+                            console.log("model.display = " + JSON.stringify(model.display))
                             completions.currentIndex = index
-                            field.text = modelData
+                            field.text = model.display
                             field.accepted()
                         }
                     }
@@ -92,6 +92,22 @@ Kirigami.ScrollablePage {
         // console.log("BrowserPage.qml: browserPage: heightChanged() received")
     }
 
+    // Continue where the last session ended. Thanks to the snapshots kept by topicModel, the page
+    // is shown without querying and rendering it again.
+    Component.onCompleted: {
+        if (browserHistory.current() !== "")
+            displayContent(browserHistory.current(), false)
+    }
+
+    // Show the current search result again after the content database was updated in the background.
+    Connections {
+        target: database
+        onContentChanged: {
+            if (browserHistory.current() !== "")
+                displayContent(browserHistory.current(), false)
+        }
+    }
+
     // Utility function to display content for a certain search string in the browser.
     // @param searchTerm string  The barcode or category name to display the content for.
     // @param addToHistory boolean  If this call to display content should be appended as a new item
@@ -106,13 +122,22 @@ Kirigami.ScrollablePage {
         // TODO: Set browserPage.title as a property binding, not imperatively like below.
         browserPage.title = searchTerm === "" ? "My Food Rescue" : searchTerm
 
+        // Topics appear one by one in topicList as they become ready. See TopicListModel.h.
         var uiLanguage = Qt.locale().name.substring(0,2)
-        var content = database.content(searchTerm, uiLanguage)
-        browserContent.text = contentOrMessage(content, searchTerm)
+        browserContent.text = ""
+        topicModel.search(searchTerm, uiLanguage)
+    }
+
+    Connections {
+        target: topicModel
+        onSearchFinished: {
+            if (count > 0)
+                return
 
-        // If nothing was found, the user wants to search again instead of scroll. So we take the
-        // focus back, which was givev up in the AutoComplete onAccepted event handler.
-        if (content === "") {
+            browserContent.text = contentOrMessage("", searchTerm)
+
+            // If nothing was found, the user wants to search again instead of scroll. So we take the
+            // focus back, which was givev up in the AutoComplete onAccepted event handler.
             autocomplete.focus = true;
             autocomplete.completionsVisible = false;
         }
@@ -133,19 +158,12 @@ Kirigami.ScrollablePage {
     }
 
     // Clean up a search string a user entered into the browser's "address bar".
+    //   "database" is the interface to the food rescue content, a ContentDatabase object (see
+    //   ContentDatabase.h) provided as a context property in main.cpp.
     function normalize(searchString) {
         return database.normalize(searchString)
     }
 
-    // Interface to the food rescue content.
-    //   This is a C++ defined QML type, see ContentDatabase.h. Interface: method content(string).
-    //   Note that this is is a different ContentDatabase object from that created in main.cpp. It still
-    //   works because we rely on the QSqlDatabase default connection; see ContentDatabase.cpp for
-    //   details.
-    Local.ContentDatabase {
-        id: database
-    }
-
     SystemPalette {
         id: activeColors
         colorGroup: SystemPalette.Active
@@ -206,7 +224,7 @@ Kirigami.ScrollablePage {
             //   Note that F2 is a typical shortcut for "go to edit mode".
             case Qt.Key_F2:
                 autocomplete.focus = true;
-                if (database.completionModel.length > 0)
+                if (database.completionModel.count > 0)
                     autocomplete.completionsVisible = true;
                 event.accepted = true;
                 break
@@ -243,10 +261,10 @@ Kirigami.ScrollablePage {
                     onInputChanged: {
                         console.log("BrowserPage: autocomplete: 'inputChanged()' signal received")
 
-                        // Don't auto-complete nothing or barcode numbers.
-                        if (input == "" || input.match("^[0-9 ]+$"))
+                        // Don't auto-complete nothing.
+                        if (input == "")
                             database.clearCompletions()
-                        // Auto-complete a category name fragment.
+                        // Auto-complete a category name fragment, or the start of a barcode number.
                         else {
                             // Can't be made into a custom property "uiLanguage" since Qt.locale()
                             // does not have a change notification signal connected to it.
@@ -259,9 +277,21 @@ Kirigami.ScrollablePage {
                             //   https://github.com/retifrav/translating-qml/blob/1a97871/trans.h#L25
                             var uiLanguage = Qt.locale().name.substring(0,2)
                             database.updateCompletions(input, uiLanguage, 10)
+
+                            // The top completion is the most likely next search, so prepare its content.
+                            database.prefetch([database.completionModel.text(0)], uiLanguage)
                         }
                     }
 
+                    // Prepare the content of the selected completion, so it shows without delay when
+                    // accepted. The top completion stays a hint, as the user may navigate back to it.
+                    onHighlighted: {
+                        var uiLanguage = Qt.locale().name.substring(0,2)
+                        database.prefetch(
+                            [database.normalize(text), database.completionModel.text(0)], uiLanguage
+                        )
+                    }
+
                     onAccepted: displayContent(input)
 
                     // Clean up a search string a user entered into the browser's "address bar".
@@ -414,6 +444,39 @@ Kirigami.ScrollablePage {
                 }
             }
 
+            // The topics found by the last search, shown as soon as each one is rendered.
+            //   Topics are rendered when they come near the visible area. Until then they take a
+            //   placeholder height, so that topics further down stay out of view and are not rendered.
+            Column {
+                id: topicList
+
+                anchors.left: parent.left
+                anchors.right: parent.right
+
+                Repeater {
+                    model: topicModel
+
+                    delegate: Text {
+                        property bool nearViewport: topicList.y + y < browser.contentY + 2 * browser.height
+
+                        width: topicList.width
+                        height: model.ready ? implicitHeight : 400
+
+                        text: model.html
+                        textFormat: Text.RichText
+                        wrapMode: Text.Wrap
+
+                        onNearViewportChanged: if (nearViewport) topicModel.render(index)
+                        Component.onCompleted: if (nearViewport) topicModel.render(index)
+
+                        onLinkActivated: {
+                            autocomplete.focus = false
+                            Qt.openUrlExternally(link)
+                        }
+                    }
+                }
+            }
+
             // Component to fill the empty space at the bottom of the page so that clicking there will
             // remove the focus from the autocomplete field. Also contains startup screen images.
             //
@@ -447,7 +510,8 @@ Kirigami.ScrollablePage {
                     var flickableVerticalBorder = 20 // TODO: Determine this value dynamically.
                     var columnItemSpacing = 20 // TODO: Determine this value dynamically.
                     var heightToFill = browserPage.height - kirigamiHeaderHeight - flickableVerticalBorder
-                        - headerBar.height - columnItemSpacing - browserContent.height - flickableVerticalBorder
+                        - headerBar.height - columnItemSpacing - browserContent.height - topicList.height
+                        - flickableVerticalBorder
 
                     return (heightToFill > 0) ? heightToFill : 0
                 }
@@ -469,7 +533,7 @@ Kirigami.ScrollablePage {
                     // and if only "No content found.").
                     //   TODO: Better destroy the instance, or remove the image source, as it probably eats
                     //   CPU time and memory even while invisible.
-                    visible: browserContent.text == ""
+                    visible: browserContent.text == "" && topicModel.count == 0 && !topicModel.loading
 
                     // The app logo, shown large and centrally on the home screen.
                     topImage: "qrc:///images/applogo-2_minified.svg"
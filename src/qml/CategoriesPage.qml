@@ -0,0 +1,77 @@
+import QtQuick 2.12
+import QtQuick.Controls 2.12
+import QtQuick.Layouts 1.2
+import org.kde.kirigami 2.10 as Kirigami
+
+// Page for "☰ → Browse Categories".
+//   Shows the child categories of one category at a time, fetched page by page by categoryModel
+//   while scrolling. See CategoryBrowserModel.h.
+Kirigami.ScrollablePage {
+    id: page
+    title: path.length > 0 ? path[path.length - 1].name : qsTr("Browse Categories")
+
+    // Emitted when the user chooses a category to show its content.
+    signal categorySelected(string name)
+
+    // The categories from the root to the one shown, as maps with keys "id" and "name".
+    property var path: []
+
+    property string uiLanguage: Qt.locale().name.substring(0,2)
+
+    // Let's use the same background as in BrowserPage.qml.
+    background: Rectangle { color: "white" }
+
+    mainAction: Kirigami.Action {
+        iconName: "go-up"
+        text: qsTr("Up")
+        enabled: path.length > 0
+        onTriggered: {
+            var upper = path.slice(0, -1)
+            show(upper)
+        }
+    }
+
+    // Show the content of the category shown, including the topics of its ancestors.
+    rightAction: Kirigami.Action {
+        iconName: "go-next"
+        text: qsTr("Show content")
+        enabled: path.length > 0
+        onTriggered: categorySelected(path[path.length - 1].name)
+    }
+
+    ListView {
+        id: categoryList
+        model: categoryModel
+
+        delegate: Kirigami.BasicListItem {
+            width: categoryList.width
+            label: model.name
+            subtitle: model.childCount > 0 ?
+                qsTr("%1 subcategories, %2 topics").arg(model.childCount).arg(model.topicCount) :
+                qsTr("%1 topics").arg(model.topicCount)
+            reserveSpaceForIcon: false
+
+            // Descend into categories with children, show the content of the others.
+            onClicked: {
+                if (model.childCount > 0)
+                    show(path.concat([{ "id": model.categoryId, "name": model.name }]))
+                else
+                    categorySelected(model.name)
+            }
+        }
+
+        footer: BusyIndicator {
+            width: categoryList.width
+            running: categoryModel.loading
+            visible: running
+        }
+    }
+
+    // Show the children of the last category in the given path, or the root categories for an empty path.
+    function show(newPath) {
+        path = newPath
+        categoryModel.browse(path.length > 0 ? path[path.length - 1].id : -1, uiLanguage)
+    }
+
+    Component.onCompleted: show([])
+}
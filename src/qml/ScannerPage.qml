@@ -32,15 +32,25 @@ Kirigami.ScrollablePage {
     property string lastTag: ""
     signal barcodeFound(string code)
 
+    // Continuous scanning mode, for checking a crate or shelf of products.
+    //   The camera stays on, all barcodes in view are recognized, and the recognized products are
+    //   listed below the camera image. Selecting one shows its content, like a single scan does.
+    property bool continuous: false
+
     // Activate the camera only while visible.
     //   Else it would consume energy and have its LED on permanently. This page is dynamically
     //   created, so it is not visible before "onCompleted".
     Component.onCompleted: {
         tagsFound = 0
         lastTag = ""
+        zxingFilter.statistics.reset() // Every opening of the scanner page is a new scan session.
         camera.start()
     }
 
+    // Log the scanner performance statistics of this scan session, to tune camera resolution
+    // and decoder hints based on real usage.
+    Component.onDestruction: zxingFilter.statistics.logDump()
+
     // Barcode search algorithm, provided by ZXing-C++. Invisible.
     ZXing.VideoFilter {
         id: zxingFilter
@@ -49,8 +59,28 @@ Kirigami.ScrollablePage {
         tryRotate: true // Also search for barcodes with horizontal bars, in addition to vertical.
         tryHarder: true // Spend more effort on barcode recognition. Not really needed, as this is the default now.
 
+        multiScan: scannerPage.continuous
+
+        // Camera frames are recorded for replaying them with "--replay" when started with "--record-frames".
+        recordFile: frameRecordFile
+
         // onNewResult: console.log(result) // Good for debugging, also showing no-recognition results.
 
+        // Barcodes recognized in continuous mode, each once while in view, in batches.
+        //   Resolved with one database query per batch. Newest products are listed first.
+        onFoundBarcodes: {
+            var uiLanguage = Qt.locale().name.substring(0,2)
+            var products = database.lookupBatch(codes, uiLanguage)
+            for (var i = 0; i < products.length; i++) {
+                scannedProducts.insert(0, {
+                    "code": products[i].barcode,
+                    "categories": products[i].categories.join(", ")
+                })
+            }
+            tagsFound += codes.length
+            lastTag = codes[codes.length - 1]
+        }
+
         onFoundBarcode: {
             tagsFound++
             // Stop the camera manually to prevent finding more barcodes.
@@ -150,6 +180,7 @@ Kirigami.ScrollablePage {
             case Camera.ActiveState:
                 console.debug("New camera state: Camera.ActiveState");
                 printViewfinderResolutions()
+                zxingFilter.statistics.markCameraStarted()
                 break;
             }
         }
@@ -197,6 +228,38 @@ Kirigami.ScrollablePage {
             focus: visible // Captures key events only while visible.
         }
 
+        // Switch between scanning one barcode and scanning continuously.
+        Switch {
+            text: qsTr("Scan continuously")
+            checked: scannerPage.continuous
+            onToggled: scannerPage.continuous = checked
+        }
+
+        // Products recognized in continuous mode.
+        ListModel { id: scannedProducts }
+
+        Column {
+            Layout.fillWidth: true
+            visible: scannerPage.continuous
+
+            Repeater {
+                model: scannedProducts
+
+                delegate: Kirigami.BasicListItem {
+                    width: parent.width
+                    label: model.categories !== "" ? model.categories : qsTr("Unknown product")
+                    subtitle: model.code
+                    reserveSpaceForIcon: false
+
+                    onClicked: {
+                        camera.stop()
+                        pageStack.layers.pop()
+                        scannerPage.barcodeFound(model.code)
+                    }
+                }
+            }
+        }
+
         // Camera chooser widget. Shown only when multiple cameras exist.
         RowLayout {
             Layout.fillWidth: true
@@ -223,7 +286,8 @@ Kirigami.ScrollablePage {
             // TODO: Enable when in debugging mode.
             visible: false
             text: qsTr("Barcodes found:)") + " " + tagsFound + " " +
-                (lastTag ? qsTr("Last barcode:") + " " + lastTag : "")
+                (lastTag ? qsTr("Last barcode:") + " " + lastTag : "") + " " +
+                qsTr("Frames:") + " " + zxingFilter.statistics.framesSeen
         }
     }
 }
@@ -0,0 +1,234 @@
+#include <QtTest>
+#include <QCoreApplication>
+#include <QFile>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QtEndian>
+
+// Must match the limit in QueryServer.cpp.
+static const int maxRequestBytes = 1024 * 1024;
+
+// Time to wait for the server to start, resp. for one response, in milliseconds.
+static const int startTimeout = 30000;
+static const int responseTimeout = 10000;
+
+
+/**
+ * @brief Client side test of the query server of "foodrescue --serve", over its local socket.
+ * @details Starts the application as a server on a copy of the fixture database, which it finds in
+ *   its local data directory, and checks the protocol described at QueryServer: pipelined requests,
+ *   and that malformed requests neither crash the server nor block other requests.
+ */
+class QueryServerTest : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void pipelinedRequests();
+    void invalidJson();
+    void oversizedRequest();
+    void cleanupTestCase();
+
+private:
+    bool connectClient(QLocalSocket& socket);
+    static QByteArray frame(const QByteArray& payload);
+    static QByteArray request(int id, QString method, QJsonObject params);
+    static QList<QJsonObject> readResponses(QLocalSocket& socket, int count);
+    static QStringList sorted(const QJsonValue& names);
+
+    QTemporaryDir m_dataDir;
+    QProcess m_server;
+    QString m_socketName;
+};
+
+
+void QueryServerTest::initTestCase() {
+    QVERIFY(m_dataDir.isValid());
+
+    // Where the application finds its database: its local data directory, see ContentDatabase::connect().
+    QString appDataDir = m_dataDir.path() + "/data/foodrescue";
+    QVERIFY(QDir().mkpath(appDataDir));
+    QVERIFY(QFile::copy(FIXTURE_DATABASE, appDataDir + "/foodrescue-content.sqlite3"));
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert("QT_QPA_PLATFORM", "offscreen");
+    environment.insert("XDG_DATA_HOME", m_dataDir.path() + "/data");
+    environment.insert("XDG_CACHE_HOME", m_dataDir.path() + "/cache");
+
+    m_socketName = QString("foodrescue-test-%1").arg(QCoreApplication::applicationPid());
+    m_server.setProcessEnvironment(environment);
+    m_server.setProcessChannelMode(QProcess::ForwardedChannels);
+    m_server.start(FOODRESCUE_EXECUTABLE, {"--serve", m_socketName, "--serve-workers", "4"});
+    QVERIFY(m_server.waitForStarted());
+}
+
+
+/**
+ * @brief Send many requests without waiting for responses, more than the server executes at a time
+ *   per client, and match the responses by id.
+ */
+void QueryServerTest::pipelinedRequests() {
+    QLocalSocket socket;
+    QVERIFY(connectClient(socket));
+
+    const int rounds = 10;
+    QByteArray requests;
+    for (int round = 0; round < rounds; round++) {
+        int id = round * 4;
+        requests += frame(request(id, "complete", {{"fragments", "chee"}, {"language", "en"}}));
+        requests += frame(request(id + 1, "lookup", {
+            {"barcodes", QJsonArray {"4000417025005", "5000112637922", "123"}}, {"language", "en"}
+        }));
+        requests += frame(request(id + 2, "complete", {{"fragments", "käse"}, {"language", "de"}, {"limit", 1}}));
+        requests += frame(request(id + 3, "lookup", {{"barcodes", QJsonArray {"4311 5014 90437"}}, {"language", "de"}}));
+    }
+    socket.write(requests);
+
+    QHash<int, QJsonObject> responses;
+    for (const QJsonObject& response : readResponses(socket, rounds * 4))
+        responses.insert(response["id"].toInt(), response);
+    QCOMPARE(responses.size(), rounds * 4);
+
+    for (int round = 0; round < rounds; round++) {
+        int id = round * 4;
+        QCOMPARE(responses[id]["result"].toArray(), (QJsonArray {"Cheeses", "Hard cheeses"}));
+
+        QJsonObject products = responses[id + 1]["result"].toObject();
+        QCOMPARE(sorted(products["4000417025005"]), (QStringList {"Cheeses", "Hard cheeses"}));
+        QCOMPARE(sorted(products["5000112637922"]), QStringList {"Beverages"});
+        QCOMPARE(sorted(products["123"]), QStringList());
+
+        QCOMPARE(responses[id + 2]["result"].toArray(), QJsonArray {"Käse"});
+        QCOMPARE(sorted(responses[id + 3]["result"].toObject()["4311501490437"]), QStringList {"Säfte"});
+    }
+}
+
+
+/**
+ * @brief A request that is no JSON gets an error response, and the following requests are still served.
+ */
+void QueryServerTest::invalidJson() {
+    QLocalSocket socket;
+    QVERIFY(connectClient(socket));
+
+    socket.write(frame("{\"id\": 1, \"method\": \"complete\""));
+    socket.write(frame(request(2, "complete", {{"fragments", "juic"}, {"language", "en"}})));
+
+    QList<QJsonObject> responses = readResponses(socket, 2);
+    QCOMPARE(responses.size(), 2);
+    for (const QJsonObject& response : responses) {
+        if (response["id"].isNull())
+            QVERIFY(response["error"].toString().startsWith("Invalid JSON"));
+        else
+            QCOMPARE(response["result"].toArray(), QJsonArray {"Juices"});
+    }
+    QCOMPARE(socket.state(), QLocalSocket::ConnectedState);
+}
+
+
+/**
+ * @brief A client announcing a request larger than the limit is disconnected, without affecting other clients.
+ */
+void QueryServerTest::oversizedRequest() {
+    QLocalSocket socket;
+    QVERIFY(connectClient(socket));
+
+    QByteArray header(4, '\0');
+    qToBigEndian<quint32>(quint32(maxRequestBytes + 1), reinterpret_cast<uchar*>(header.data()));
+    socket.write(header + QByteArray(1024, ' '));
+    socket.flush();
+    QVERIFY(socket.state() == QLocalSocket::UnconnectedState || socket.waitForDisconnected(responseTimeout));
+
+    QLocalSocket other;
+    QVERIFY(connectClient(other));
+    other.write(frame(request(1, "lookup", {{"barcodes", QJsonArray {"5000112637922"}}, {"language", "en"}})));
+    QList<QJsonObject> responses = readResponses(other, 1);
+    QCOMPARE(responses.size(), 1);
+    QCOMPARE(sorted(responses[0]["result"].toObject()["5000112637922"]), QStringList {"Beverages"});
+}
+
+
+void QueryServerTest::cleanupTestCase() {
+    m_server.terminate();
+    if (!m_server.waitForFinished())
+        m_server.kill();
+}
+
+
+/**
+ * @brief Connect to the server, waiting for it to listen while it opens the database at startup.
+ */
+bool QueryServerTest::connectClient(QLocalSocket& socket) {
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < startTimeout && m_server.state() == QProcess::Running) {
+        socket.connectToServer(m_socketName);
+        if (socket.waitForConnected(1000))
+            return true;
+        QTest::qWait(100);
+    }
+    return false;
+}
+
+
+/** @brief A frame of the protocol: the length of the payload as 4 byte big-endian integer, then the payload. */
+QByteArray QueryServerTest::frame(const QByteArray& payload) {
+    QByteArray header(4, '\0');
+    qToBigEndian<quint32>(quint32(payload.size()), reinterpret_cast<uchar*>(header.data()));
+    return header + payload;
+}
+
+
+QByteArray QueryServerTest::request(int id, QString method, QJsonObject params) {
+    QJsonObject request {{"id", id}, {"method", method}, {"params", params}};
+    return QJsonDocument(request).toJson(QJsonDocument::Compact);
+}
+
+
+/**
+ * @brief Read the given number of response frames.
+ * @return The responses, in the order received. Fewer than count if the server stopped responding.
+ */
+QList<QJsonObject> QueryServerTest::readResponses(QLocalSocket& socket, int count) {
+    QList<QJsonObject> responses;
+    QByteArray buffer;
+
+    while (responses.size() < count) {
+        if (buffer.size() >= 4) {
+            quint32 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(buffer.constData()));
+            if (quint32(buffer.size()) >= 4 + length) {
+                responses << QJsonDocument::fromJson(buffer.mid(4, length)).object();
+                buffer.remove(0, 4 + length);
+                continue;
+            }
+        }
+        if (socket.bytesAvailable() == 0 && !socket.waitForReadyRead(responseTimeout))
+            break;
+        buffer.append(socket.readAll());
+    }
+
+    return responses;
+}
+
+
+/** @brief Category names of a lookup result, sorted, as their order is not specified. */
+QStringList QueryServerTest::sorted(const QJsonValue& names) {
+    QStringList list;
+    for (const QJsonValue& name : names.toArray())
+        list << name.toString();
+    list.sort();
+    return list;
+}
+
+
+QTEST_GUILESS_MAIN(QueryServerTest)
+
+#include "QueryServerTest.moc"
@@ -0,0 +1,41 @@
+-- A small content database for the tests, with the tables and indexes of a full content database
+-- build (see DatabaseValidator) and a few rows. Regenerate the binary fixture after changing this:
+--   rm fixture-content.sqlite3 && sqlite3 fixture-content.sqlite3 < fixture-content.sql
+
+PRAGMA user_version = 1;
+
+CREATE TABLE products (id INTEGER PRIMARY KEY, code INTEGER);
+CREATE TABLE product_categories (product_id INTEGER, category_id INTEGER);
+CREATE TABLE category_structure (category_id INTEGER, parent_id INTEGER);
+CREATE TABLE category_names (category_id INTEGER, lang TEXT, name TEXT);
+CREATE TABLE topics (id INTEGER PRIMARY KEY, section TEXT, version TEXT);
+CREATE TABLE topic_categories (topic_id INTEGER, category_id INTEGER);
+CREATE TABLE topic_contents (topic_id INTEGER, lang TEXT, title TEXT, content TEXT);
+
+CREATE INDEX products_code ON products (code);
+CREATE INDEX product_categories_product_id ON product_categories (product_id);
+CREATE INDEX category_structure_category_id ON category_structure (category_id);
+CREATE INDEX category_structure_parent_id ON category_structure (parent_id);
+CREATE INDEX category_names_category_id_lang ON category_names (category_id, lang);
+CREATE INDEX category_names_lang_name ON category_names (lang, name, category_id);
+CREATE INDEX topic_categories_category_id ON topic_categories (category_id);
+CREATE INDEX topic_contents_topic_id_lang ON topic_contents (topic_id, lang);
+
+-- Categories: 1 Dairies > 2 Cheeses > 3 Hard cheeses, and 4 Beverages > 5 Juices.
+INSERT INTO category_names VALUES
+    (1, 'en', 'Dairies'), (2, 'en', 'Cheeses'), (3, 'en', 'Hard cheeses'),
+    (4, 'en', 'Beverages'), (5, 'en', 'Juices'),
+    (1, 'de', 'Milchprodukte'), (2, 'de', 'Käse'), (3, 'de', 'Hartkäse'),
+    (4, 'de', 'Getränke'), (5, 'de', 'Säfte');
+INSERT INTO category_structure VALUES (2, 1), (3, 2), (5, 4);
+
+INSERT INTO products VALUES (1, 4000417025005), (2, 4311501490437), (3, 5000112637922);
+INSERT INTO product_categories VALUES (1, 2), (1, 3), (2, 5), (3, 4);
+
+INSERT INTO topics VALUES (1, 'storage', '1'), (2, 'edibility', '1');
+INSERT INTO topic_categories VALUES (1, 2), (2, 4);
+INSERT INTO topic_contents VALUES
+    (1, 'en', 'Storing cheese', '<section><para>Keep cheese cool and wrapped.</para></section>'),
+    (1, 'de', 'Käse lagern', '<section><para>Käse kühl und eingepackt lagern.</para></section>'),
+    (2, 'en', 'Beverages after the date', '<section><para>Unopened beverages keep long.</para></section>'),
+    (2, 'de', 'Getränke nach dem Datum', '<section><para>Ungeöffnete Getränke halten lange.</para></section>');